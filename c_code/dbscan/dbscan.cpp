@@ -4,9 +4,14 @@
 #include <boost/numeric/ublas/io.hpp>
 #include <boost/algorithm/minmax.hpp>
 #include <vector>
+#include <algorithm>
 #include <omp.h>
 
 #include "dbscan.h"
+#include "l1_distance.h"
+#include "kdtree.h"
+#include "l1_tiles.h"
+#include "l1_quantized.h"
 
 namespace clustering {
 DBSCAN::ClusterData DBSCAN::gen_cluster_data( size_t features_num, size_t elements_num )
@@ -35,6 +40,9 @@ DBSCAN::FeaturesWeights DBSCAN::std_weights( size_t s )
 }
 
 DBSCAN::DBSCAN()
+    : m_count_neighbors( false )
+    , m_deadline( 0.0 )
+    , m_timed_out( false )
 {
 }
 
@@ -59,6 +67,9 @@ DBSCAN::DBSCAN( double eps, size_t min_elems, int num_threads )
     , m_num_threads( num_threads_or_default( num_threads ) )
     , m_dmin( 0.0 )
     , m_dmax( 0.0 )
+    , m_count_neighbors( false )
+    , m_deadline( 0.0 )
+    , m_timed_out( false )
 {
     reset();
 }
@@ -70,10 +81,48 @@ DBSCAN::~DBSCAN()
 void DBSCAN::reset()
 {
     m_labels.clear();
+    m_neighbor_counts.clear();
+}
+
+void DBSCAN::count_neighbors( bool enabled )
+{
+    m_count_neighbors = enabled;
+}
+
+void DBSCAN::set_deadline( double deadline )
+{
+    m_deadline = deadline;
+}
+
+bool DBSCAN::timed_out() const
+{
+    return m_timed_out;
+}
+
+// Checked by the neighbour searches for every point pid; the clock is read every 64 points
+bool DBSCAN::past_deadline( uint32_t pid )
+{
+    if ( !m_timed_out && m_deadline > 0.0 && !( pid & 63 ) && omp_get_wtime() > m_deadline ) {
+        m_timed_out = true;
+    }
+    return m_timed_out;
+}
+
+// After a timeout, every point is noise
+void DBSCAN::abort_fit()
+{
+    m_neighbor_offsets.clear();
+    m_neighbor_ids.clear();
+    m_neighbor_counts.clear();
+
+    for ( auto& l : m_labels ) {
+        l = -1;
+    }
 }
 
 void DBSCAN::prepare_labels( size_t s )
 {
+    m_timed_out = false;
     m_labels.resize( s );
 
     for ( auto& l : m_labels ) {
@@ -81,13 +130,9 @@ void DBSCAN::prepare_labels( size_t s )
     }
 }
 
-const DBSCAN::DistanceMatrix DBSCAN::calc_dist_matrix( const DBSCAN::ClusterData& C, const DBSCAN::FeaturesWeights& W )
+void DBSCAN::normalize( DBSCAN::ClusterData& cl_d )
 {
-    DBSCAN::ClusterData cl_d = C;
-
-    omp_set_dynamic( 0 );
-    omp_set_num_threads( m_num_threads );
-#pragma omp parallel for
+#pragma omp parallel for num_threads( m_num_threads )
     for ( size_t i = 0; i < cl_d.size2(); ++i ) {
         ublas::matrix_column< DBSCAN::ClusterData > col( cl_d, i );
 
@@ -106,45 +151,67 @@ const DBSCAN::DistanceMatrix DBSCAN::calc_dist_matrix( const DBSCAN::ClusterData
         col *= scale;
         col.plus_assign( ublas::scalar_vector< typename ublas::matrix_column< DBSCAN::ClusterData >::value_type >( col.size(), min ) );
     }
+}
 
-    // rows x rows
-    DBSCAN::DistanceMatrix d_m( cl_d.size1(), cl_d.size1() );
-    ublas::vector< double > d_max( cl_d.size1() );
-    ublas::vector< double > d_min( cl_d.size1() );
+// Largest pairwise distance, without the distance matrix. For weighted L1,
+// max |u - v|_w = max over sign vectors s of ( max_i s.x_i - min_i s.x_i ) with s_k = +-w_k,
+// so 2^(features_num - 1) linear scans find the farthest pair, whose distance is then computed
+// with l1_distance like any other distance. Beyond max_sign_features features the
+// pairs are scanned directly, which is quadratic in time but not in memory.
+double DBSCAN::calc_max_dist( const DBSCAN::ClusterData& cl_d, const DBSCAN::FeaturesWeights& W )
+{
+    const size_t max_sign_features = 12;
+    const size_t elements_num = cl_d.size1();
+    const size_t features_num = cl_d.size2();
+    const double* data = &cl_d.data()[0];
+    const double* weights = &W.data()[0];
+
+    if ( elements_num < 2 || !features_num ) {
+        return 0.0;
+    }
+
+    double d_max = 0.0;
+
+    if ( features_num <= max_sign_features ) {
+        const uint32_t signs_num = 1u << ( features_num - 1 );
 
-    omp_set_dynamic( 0 );
-    omp_set_num_threads( m_num_threads );
-#pragma omp parallel for
-    for ( size_t i = 0; i < cl_d.size1(); ++i ) {
-        for ( size_t j = i; j < cl_d.size1(); ++j ) {
-            d_m( i, j ) = 0.0;
+        for ( uint32_t s = 0; s < signs_num; ++s ) {
+            uint32_t i_min = 0;
+            uint32_t i_max = 0;
+            double p_min = 0.0;
+            double p_max = 0.0;
 
-            if ( i != j ) {
-                ublas::matrix_row< DBSCAN::ClusterData > U( cl_d, i );
-                ublas::matrix_row< DBSCAN::ClusterData > V( cl_d, j );
+            for ( uint32_t i = 0; i < elements_num; ++i ) {
+                const double* u = data + i * features_num;
+                double p = u[0] * weights[0];
 
-                int k = 0;
-                for ( const auto e : ( U - V ) ) {
-                    d_m( i, j ) += fabs( e ) * W[k++];
+                for ( size_t k = 1; k < features_num; ++k ) {
+                    p += ( ( s >> ( k - 1 ) ) & 1 ) ? -u[k] * weights[k] : u[k] * weights[k];
                 }
 
-                d_m( j, i ) = d_m( i, j );
+                if ( !i || p < p_min ) {
+                    p_min = p;
+                    i_min = i;
+                }
+                if ( !i || p > p_max ) {
+                    p_max = p;
+                    i_max = i;
+                }
             }
-        }
 
-        const auto cur_row = ublas::matrix_row< DBSCAN::DistanceMatrix >( d_m, i );
-        const auto mm = minmax_element( cur_row.begin(), cur_row.end() );
-
-        d_max( i ) = *mm.second;
-        d_min( i ) = *mm.first;
+            const double d = l1_distance< 0 >( data + i_min * features_num, data + i_max * features_num, weights, features_num );
+            d_max = std::max( d_max, d );
+        }
+    } else {
+#pragma omp parallel for num_threads( m_num_threads ) reduction( max : d_max )
+        for ( size_t i = 0; i < elements_num; ++i ) {
+            for ( size_t j = i + 1; j < elements_num; ++j ) {
+                d_max = std::max( d_max, l1_distance< 0 >( data + i * features_num, data + j * features_num, weights, features_num ) );
+            }
+        }
     }
 
-    m_dmin = *( min_element( d_min.begin(), d_min.end() ) );
-    m_dmax = *( max_element( d_max.begin(), d_max.end() ) );
-
-    m_eps = ( m_dmax - m_dmin ) * m_eps + m_dmin;
-
-    return d_m;
+    return d_max;
 }
 
 DBSCAN::Neighbors DBSCAN::find_neighbors( const DBSCAN::DistanceMatrix& D, uint32_t pid )
@@ -159,45 +226,154 @@ DBSCAN::Neighbors DBSCAN::find_neighbors( const DBSCAN::DistanceMatrix& D, uint3
     return ne;
 }
 
-void DBSCAN::dbscan( const DBSCAN::DistanceMatrix& dm )
+// Expansion over the neighbour lists, which are computed once. A core point is queued at most once,
+// so each list is scanned once and the cost is linear in the number of neighbour pairs.
+void DBSCAN::dbscan_csr()
 {
-    std::vector< uint8_t > visited( dm.size1() );
+    const size_t elements_num = m_neighbor_offsets.size() - 1;
+
+    m_neighbor_counts.resize( elements_num );
+    for ( uint32_t pid = 0; pid < elements_num; ++pid ) {
+        m_neighbor_counts[pid] = m_neighbor_offsets[pid + 1] - m_neighbor_offsets[pid];
+    }
+
+    std::vector< uint8_t > queued( elements_num );
+    std::vector< uint32_t > queue;
+
+    int32_t cluster_id = 0;
+
+    for ( uint32_t pid = 0; pid < elements_num; ++pid ) {
+        if ( queued[pid] || m_labels[pid] != -1 || m_neighbor_counts[pid] < m_min_elems ) {
+            continue;
+        }
+
+        queue.clear();
+        queue.push_back( pid );
+        queued[pid] = 1;
+        m_labels[pid] = cluster_id;
 
-    uint32_t cluster_id = 0;
+        for ( size_t head = 0; head < queue.size(); ++head ) {
+            const uint32_t p = queue[head];
+
+            for ( size_t k = m_neighbor_offsets[p]; k < m_neighbor_offsets[p + 1]; ++k ) {
+                const uint32_t nPid = m_neighbor_ids[k];
+
+                if ( m_labels[nPid] == -1 ) {
+                    m_labels[nPid] = cluster_id;
+                }
+                if ( !queued[nPid] && m_neighbor_counts[nPid] >= m_min_elems ) {
+                    queued[nPid] = 1;
+                    queue.push_back( nPid );
+                }
+            }
+        }
+
+        ++cluster_id;
+    }
+
+    m_neighbor_offsets.clear();
+    m_neighbor_ids.clear();
+    m_neighbor_ids.shrink_to_fit();
+}
+
+void DBSCAN::dbscan( const DBSCAN::DistanceMatrix& dm )
+{
+    m_neighbor_offsets.assign( 1, 0 );
+    m_neighbor_ids.clear();
 
     for ( uint32_t pid = 0; pid < dm.size1(); ++pid ) {
-        if ( !visited[pid] ) {
-            visited[pid] = 1;
+        if ( past_deadline( pid ) ) {
+            return abort_fit();
+        }
+        const Neighbors ne = find_neighbors( dm, pid );
+        m_neighbor_ids.insert( m_neighbor_ids.end(), ne.begin(), ne.end() );
+        m_neighbor_offsets.push_back( m_neighbor_ids.size() );
+    }
 
-            Neighbors ne = find_neighbors( dm, pid );
+    dbscan_csr();
+}
 
-            if ( ne.size() >= m_min_elems ) {
-                m_labels[pid] = cluster_id;
+// Neighbour lists from the pairs within eps found by the tiled kernels, which only compute the upper
+// triangle: the row of i is its lower neighbours, i itself, then its upper neighbours.
+void DBSCAN::dbscan_upper( std::vector< Neighbors >& upper )
+{
+    const size_t elements_num = upper.size();
 
-                for ( uint32_t i = 0; i < ne.size(); ++i ) {
-                    uint32_t nPid = ne[i];
+    m_neighbor_offsets.assign( elements_num + 1, 0 );
+    for ( uint32_t i = 0; i < elements_num; ++i ) {
+        m_neighbor_offsets[i + 1] += 1 + upper[i].size();
+        for ( const auto j : upper[i] ) {
+            m_neighbor_offsets[j + 1] += 1;
+        }
+    }
+    for ( uint32_t i = 0; i < elements_num; ++i ) {
+        m_neighbor_offsets[i + 1] += m_neighbor_offsets[i];
+    }
 
-                    if ( !visited[nPid] ) {
-                        visited[nPid] = 1;
+    // rows below i are complete when i is reached, so every row is written in increasing order
+    std::vector< size_t > cursor( m_neighbor_offsets.begin(), m_neighbor_offsets.end() - 1 );
+    m_neighbor_ids.resize( m_neighbor_offsets[elements_num] );
 
-                        Neighbors ne1 = find_neighbors( dm, nPid );
+    for ( uint32_t i = 0; i < elements_num; ++i ) {
+        m_neighbor_ids[cursor[i]++] = i;
+        for ( const auto j : upper[i] ) {
+            m_neighbor_ids[cursor[i]++] = j;
+            m_neighbor_ids[cursor[j]++] = i;
+        }
+        Neighbors().swap( upper[i] );
+    }
 
-                        if ( ne1.size() >= m_min_elems ) {
-                            for ( const auto& n1 : ne1 ) {
-                                ne.push_back( n1 );
-                            }
-                        }
-                    }
+    dbscan_csr();
+}
 
-                    if ( m_labels[nPid] == -1 ) {
-                        m_labels[nPid] = cluster_id;
-                    }
-                }
+void DBSCAN::dbscan_tiles( const DBSCAN::ClusterData& cl_d, const DBSCAN::FeaturesWeights& W )
+{
+    std::vector< Neighbors > upper;
 
-                ++cluster_id;
-            }
+    // the tiled kernel checks the deadline before each tile of rows, on every thread
+    if ( !l1_upper_neighbors( &cl_d.data()[0], cl_d.size1(), cl_d.size2(), &W.data()[0], m_eps, m_num_threads,
+                              m_deadline, upper ) ) {
+        m_timed_out = true;
+        return abort_fit();
+    }
+    dbscan_upper( upper );
+}
+
+// eps is scaled like the quantized distances, which are compared to its integer part
+void DBSCAN::dbscan_quantized( const DBSCAN::ClusterData& cl_d, const DBSCAN::FeaturesWeights& W )
+{
+    std::vector< uint16_t > soa;
+    std::vector< Neighbors > upper;
+
+    const double scale = quantize_feature_major( &cl_d.data()[0], cl_d.size1(), cl_d.size2(), &W.data()[0], m_eps, soa );
+    const uint32_t eps = uint32_t( std::floor( m_eps * scale ) );
+
+    if ( !l1_upper_neighbors_quantized( &soa[0], cl_d.size1(), cl_d.size2(), eps, m_num_threads, m_deadline, upper ) ) {
+        m_timed_out = true;
+        return abort_fit();
+    }
+    std::vector< uint16_t >().swap( soa );
+    dbscan_upper( upper );
+}
+
+void DBSCAN::dbscan( const KDTree& tree, const DBSCAN::FeaturesWeights& W )
+{
+    const double* weights = &W.data()[0];
+    Neighbors ne;
+
+    m_neighbor_offsets.assign( 1, 0 );
+    m_neighbor_ids.clear();
+
+    for ( uint32_t pid = 0; pid < tree.size(); ++pid ) {
+        if ( past_deadline( pid ) ) {
+            return abort_fit();
         }
+        tree.range_query( pid, m_eps, weights, ne );
+        m_neighbor_ids.insert( m_neighbor_ids.end(), ne.begin(), ne.end() );
+        m_neighbor_offsets.push_back( m_neighbor_ids.size() );
     }
+
+    dbscan_csr();
 }
 
 void DBSCAN::fit( const DBSCAN::ClusterData& C )
@@ -214,8 +390,57 @@ void DBSCAN::fit_precomputed( const DBSCAN::DistanceMatrix& D )
 void DBSCAN::wfit( const DBSCAN::ClusterData& C, const DBSCAN::FeaturesWeights& W )
 {
     prepare_labels( C.size1() );
-    const DBSCAN::DistanceMatrix D = calc_dist_matrix( C, W );
-    dbscan( D );
+
+    DBSCAN::ClusterData cl_d = C;
+    normalize( cl_d );
+
+    m_dmin = 0.0;
+    m_dmax = calc_max_dist( cl_d, W );
+    m_eps = ( m_dmax - m_dmin ) * m_eps + m_dmin;
+
+    dbscan_tiles( cl_d, W );
+}
+
+void DBSCAN::fit_quantized( const DBSCAN::ClusterData& C )
+{
+    const DBSCAN::FeaturesWeights W = DBSCAN::std_weights( C.size2() );
+    wfit_quantized( C, W );
+}
+
+void DBSCAN::wfit_quantized( const DBSCAN::ClusterData& C, const DBSCAN::FeaturesWeights& W )
+{
+    prepare_labels( C.size1() );
+
+    DBSCAN::ClusterData cl_d = C;
+    normalize( cl_d );
+
+    m_dmin = 0.0;
+    m_dmax = calc_max_dist( cl_d, W );
+    m_eps = ( m_dmax - m_dmin ) * m_eps + m_dmin;
+
+    dbscan_quantized( cl_d, W );
+}
+
+void DBSCAN::fit_indexed( const DBSCAN::ClusterData& C )
+{
+    const DBSCAN::FeaturesWeights W = DBSCAN::std_weights( C.size2() );
+    wfit_indexed( C, W );
+}
+
+void DBSCAN::wfit_indexed( const DBSCAN::ClusterData& C, const DBSCAN::FeaturesWeights& W )
+{
+    prepare_labels( C.size1() );
+
+    DBSCAN::ClusterData cl_d = C;
+    normalize( cl_d );
+
+    // the distance matrix has a zero diagonal, so its minimum is always 0
+    m_dmin = 0.0;
+    m_dmax = calc_max_dist( cl_d, W );
+    m_eps = ( m_dmax - m_dmin ) * m_eps + m_dmin;
+
+    const KDTree tree( &cl_d.data()[0], cl_d.size1(), cl_d.size2() );
+    dbscan( tree, W );
 }
 
 const DBSCAN::Labels& DBSCAN::get_labels() const
@@ -223,6 +448,11 @@ const DBSCAN::Labels& DBSCAN::get_labels() const
     return m_labels;
 }
 
+const DBSCAN::Neighbors& DBSCAN::get_neighbor_counts() const
+{
+    return m_neighbor_counts;
+}
+
 std::ostream& operator<<( std::ostream& o, DBSCAN& d )
 {
     o << "[ ";
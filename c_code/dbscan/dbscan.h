@@ -4,6 +4,8 @@
 using namespace boost::numeric;
 
 namespace clustering {
+class KDTree;
+
 class DBSCAN {
 public:
     typedef ublas::vector< double > FeaturesWeights;
@@ -23,23 +25,74 @@ public:
     void fit( const ClusterData& C );
     void fit_precomputed( const DistanceMatrix& D );
     void wfit( const ClusterData& C, const FeaturesWeights& W );
+    // Labels of fit/wfit on the normalized data rounded to 16-bit fixed point: only the pairs whose distance is
+    // within ( features_num + 1 ) / 65535 of eps can be neighbors for one and not the other (but such a pair can
+    // split or merge clusters)
+    void fit_quantized( const ClusterData& C );
+    void wfit_quantized( const ClusterData& C, const FeaturesWeights& W );
+    // Same labels as fit/wfit, but eps-range queries are answered by a k-d tree instead of a distance matrix
+    void fit_indexed( const ClusterData& C );
+    void wfit_indexed( const ClusterData& C, const FeaturesWeights& W );
+    // Same labels as fit/wfit for 2 features in O(n log n) on a uniform grid (k-d tree otherwise)
+    void fit_grid( const ClusterData& C );
+    void wfit_grid( const ClusterData& C, const FeaturesWeights& W );
+    // Same labels as fit/wfit in O(n) memory plus memory_budget bytes, by recomputing the distances
+    void fit_streaming( const ClusterData& C, size_t memory_budget );
+    void wfit_streaming( const ClusterData& C, const FeaturesWeights& W, size_t memory_budget );
+    // Same labels as fit/wfit, with the k-d tree and a concurrent union-find on num_threads threads
+    void fit_parallel( const ClusterData& C );
+    void wfit_parallel( const ClusterData& C, const FeaturesWeights& W );
+    // rho-approximate DBSCAN: pairs within eps are neighbours, pairs beyond ( 1 + rho ) * eps are not
+    void fit_approximate( const ClusterData& C, double rho );
+    void wfit_approximate( const ClusterData& C, const FeaturesWeights& W, double rho );
+    // Labels for each eps of eps_list, from a single neighbourhood computation at the largest one
+    void fit_eps_sweep( const ClusterData& C, const std::vector< double >& eps_list, std::vector< Labels >& labels_list );
+    void wfit_eps_sweep( const ClusterData& C, const FeaturesWeights& W, const std::vector< double >& eps_list, std::vector< Labels >& labels_list );
     void reset();
+    // Also report the number of eps-neighbours of each point (the grid engine skips it otherwise)
+    void count_neighbors( bool enabled );
+    // Stop the neighbour searches once omp_get_wtime() passes deadline ( 0: never ). A fit that timed out
+    // labels every point as noise.
+    void set_deadline( double deadline );
+    bool timed_out() const;
 
     const Labels& get_labels() const;
+    // Number of eps-neighbours of each point of the last fit, the point included
+    const Neighbors& get_neighbor_counts() const;
 
 private:
     void prepare_labels( size_t s );
-    const DistanceMatrix calc_dist_matrix( const ClusterData& C, const FeaturesWeights& W );
+    void normalize( ClusterData& cl_d );
+    double calc_max_dist( const ClusterData& cl_d, const FeaturesWeights& W );
     Neighbors find_neighbors( const DistanceMatrix& D, uint32_t pid );
+    void dbscan_csr();
     void dbscan( const DistanceMatrix& dm );
+    void dbscan_upper( std::vector< Neighbors >& upper );
+    void dbscan_tiles( const ClusterData& cl_d, const FeaturesWeights& W );
+    void dbscan_quantized( const ClusterData& cl_d, const FeaturesWeights& W );
+    void dbscan( const KDTree& tree, const FeaturesWeights& W );
+    void dbscan_grid( const ClusterData& cl_d, const FeaturesWeights& W );
+    void dbscan_approximate( const ClusterData& cl_d, const FeaturesWeights& W, double rho );
+    void dbscan_parallel( const KDTree& tree, const FeaturesWeights& W );
+    void dbscan_streaming( const ClusterData& cl_d, const FeaturesWeights& W, size_t memory_budget );
+    bool past_deadline( uint32_t pid );
+    void abort_fit();
 
     double m_eps;
     size_t m_min_elems;
     int m_num_threads;
     double m_dmin;
     double m_dmax;
+    bool m_count_neighbors;
+    double m_deadline;
+    bool m_timed_out;
 
     Labels m_labels;
+    // eps-neighbour lists of all points, in CSR form: neighbours of i are
+    // m_neighbor_ids[m_neighbor_offsets[i]..m_neighbor_offsets[i + 1]), in increasing order
+    std::vector< size_t > m_neighbor_offsets;
+    Neighbors m_neighbor_ids;
+    Neighbors m_neighbor_counts;
 };
 
 std::ostream& operator<<( std::ostream& o, DBSCAN& d );
@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "dbscan.h"
+#include "kdtree.h"
+
+// rho-approximate DBSCAN. Every point is snapped to the center of a cell of side rho * eps / ( 2 d ) (in
+// weighted units), so that it moves by at most rho * eps / 4 in weighted L1, and the points of a cell are
+// merged into one representative whose weight is their number. DBSCAN then runs on the representatives,
+// with weighted neighbour counts and the threshold ( 1 + rho / 2 ) * eps. Two points within eps are thus
+// always neighbours and two points further than ( 1 + rho ) * eps never are, which is the rho-approximate
+// DBSCAN of Gan and Tao. Points of the same cell get the same label, and clusters are numbered by their
+// first core point as in the exact engines. When many points fall into the same cells, only the
+// representatives are clustered.
+
+namespace clustering {
+// below this cell side, the cell coordinates may overflow
+static const double approx_min_side = 1e-12;
+
+void DBSCAN::dbscan_approximate( const DBSCAN::ClusterData& cl_d, const DBSCAN::FeaturesWeights& W, double rho )
+{
+    const size_t elements_num = cl_d.size1();
+    const size_t features_num = cl_d.size2();
+    const double* data = &cl_d.data()[0];
+    const double* weights = &W.data()[0];
+    const double side = rho * m_eps / ( 2.0 * features_num );
+
+    // cell of each point
+    std::vector< int64_t > cells( elements_num * features_num );
+
+    for ( size_t i = 0; i < elements_num; ++i ) {
+        for ( size_t k = 0; k < features_num; ++k ) {
+            cells[i * features_num + k] = weights[k] > 0.0 ? static_cast< int64_t >( std::floor( data[i * features_num + k] * weights[k] / side ) ) : 0;
+        }
+    }
+
+    // points sorted by cell, and by index within a cell, so that each cell starts with its first point
+    std::vector< uint32_t > order( elements_num );
+
+    for ( uint32_t i = 0; i < elements_num; ++i ) {
+        order[i] = i;
+    }
+
+    const int64_t* c = &cells[0];
+    std::stable_sort( order.begin(), order.end(), [c, features_num]( uint32_t a, uint32_t b ) {
+        return std::lexicographical_compare( c + a * features_num, c + ( a + 1 ) * features_num, c + b * features_num, c + ( b + 1 ) * features_num );
+    } );
+
+    // representatives, numbered by their first point
+    std::vector< uint32_t > first_points;
+    std::vector< uint32_t > rep_of( elements_num );
+
+    for ( size_t i = 0; i < elements_num; ++i ) {
+        const uint32_t p = order[i];
+
+        if ( !i || !std::equal( c + p * features_num, c + ( p + 1 ) * features_num, c + order[i - 1] * features_num ) ) {
+            first_points.push_back( p );
+        }
+        rep_of[p] = first_points.size() - 1;
+    }
+
+    const size_t reps_num = first_points.size();
+    std::vector< uint32_t > rep_rank( reps_num );
+    std::vector< uint32_t > rep_by_rank( reps_num );
+
+    for ( uint32_t r = 0; r < reps_num; ++r ) {
+        rep_by_rank[r] = r;
+    }
+    std::sort( rep_by_rank.begin(), rep_by_rank.end(), [&first_points]( uint32_t a, uint32_t b ) { return first_points[a] < first_points[b]; } );
+    for ( uint32_t r = 0; r < reps_num; ++r ) {
+        rep_rank[rep_by_rank[r]] = r;
+    }
+
+    std::vector< uint32_t > rep_weight( reps_num );
+    std::vector< double > rep_data( reps_num * features_num );
+
+    for ( uint32_t p = 0; p < elements_num; ++p ) {
+        rep_of[p] = rep_rank[rep_of[p]];
+        ++rep_weight[rep_of[p]];
+    }
+    for ( uint32_t r = 0; r < reps_num; ++r ) {
+        const int64_t* cell = c + first_points[rep_by_rank[r]] * features_num;
+
+        for ( size_t k = 0; k < features_num; ++k ) {
+            rep_data[r * features_num + k] = weights[k] > 0.0 ? ( cell[k] + 0.5 ) * side / weights[k] : 0.0;
+        }
+    }
+
+    // neighbour lists of the representatives and weighted counts
+    const KDTree tree( &rep_data[0], reps_num, features_num );
+    const double eps = m_eps * ( 1.0 + rho / 2.0 );
+    std::vector< size_t > offsets( 1, 0 );
+    Neighbors ids;
+    Neighbors ne;
+    std::vector< uint32_t > rep_count( reps_num );
+
+    for ( uint32_t r = 0; r < reps_num; ++r ) {
+        if ( past_deadline( r ) ) {
+            return abort_fit();
+        }
+        tree.range_query( r, eps, weights, ne );
+        for ( const auto q : ne ) {
+            rep_count[r] += rep_weight[q];
+        }
+        ids.insert( ids.end(), ne.begin(), ne.end() );
+        offsets.push_back( ids.size() );
+    }
+
+    // expansion over the representatives, as in dbscan_csr
+    std::vector< int32_t > rep_label( reps_num, -1 );
+    std::vector< uint8_t > queued( reps_num );
+    std::vector< uint32_t > queue;
+    int32_t cluster_id = 0;
+
+    for ( uint32_t r = 0; r < reps_num; ++r ) {
+        if ( queued[r] || rep_label[r] != -1 || rep_count[r] < m_min_elems ) {
+            continue;
+        }
+
+        queue.assign( 1, r );
+        queued[r] = 1;
+        rep_label[r] = cluster_id;
+
+        for ( size_t head = 0; head < queue.size(); ++head ) {
+            const uint32_t s = queue[head];
+
+            for ( size_t k = offsets[s]; k < offsets[s + 1]; ++k ) {
+                const uint32_t q = ids[k];
+
+                if ( rep_label[q] == -1 ) {
+                    rep_label[q] = cluster_id;
+                }
+                if ( !queued[q] && rep_count[q] >= m_min_elems ) {
+                    queued[q] = 1;
+                    queue.push_back( q );
+                }
+            }
+        }
+
+        ++cluster_id;
+    }
+
+    m_neighbor_counts.resize( elements_num );
+    for ( uint32_t p = 0; p < elements_num; ++p ) {
+        m_labels[p] = rep_label[rep_of[p]];
+        m_neighbor_counts[p] = rep_count[rep_of[p]];
+    }
+}
+
+void DBSCAN::fit_approximate( const DBSCAN::ClusterData& C, double rho )
+{
+    const DBSCAN::FeaturesWeights W = DBSCAN::std_weights( C.size2() );
+    wfit_approximate( C, W, rho );
+}
+
+void DBSCAN::wfit_approximate( const DBSCAN::ClusterData& C, const DBSCAN::FeaturesWeights& W, double rho )
+{
+    prepare_labels( C.size1() );
+    m_neighbor_counts.clear();
+
+    DBSCAN::ClusterData cl_d = C;
+    normalize( cl_d );
+
+    m_dmin = 0.0;
+    m_dmax = calc_max_dist( cl_d, W );
+    m_eps = ( m_dmax - m_dmin ) * m_eps + m_dmin;
+
+    if ( C.size1() && C.size2() && rho * m_eps / ( 2.0 * C.size2() ) >= approx_min_side ) {
+        dbscan_approximate( cl_d, W, rho );
+    } else {
+        const KDTree tree( &cl_d.data()[0], cl_d.size1(), cl_d.size2() );
+        dbscan( tree, W );
+    }
+}
+}
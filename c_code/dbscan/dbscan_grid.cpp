@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "dbscan.h"
+#include "l1_distance.h"
+#include "kdtree.h"
+#include "union_find.h"
+
+// Exact DBSCAN for 2-dimensional data on a uniform grid.
+// With weighted L1 distances, the cells have side eps / ( 2 w_k ) along feature k, so that two points
+// of the same cell are always within eps and the points within eps of a cell lie in a fixed stencil
+// of neighbouring cells. Cells with at least min_elems points only contain core points, which are
+// all connected; the other cells are small. Clusters are then the connected components of the core
+// points, numbered in the order of their first core point, and border points join the cluster of
+// smallest id among their core neighbours, which are exactly the labels of DBSCAN::dbscan.
+
+namespace clustering {
+typedef std::pair< int64_t, int64_t > GridCell;
+
+// The cells are shrunk by this relative margin so that the rounding of the cell coordinates and of
+// the distances cannot put two points of the same cell beyond eps. Below grid_min_eps, the margin is
+// no longer larger than the rounding errors and the cells are not assumed to be within eps.
+static const double grid_side_margin = 1e-6;
+static const double grid_min_eps = 1e-6;
+
+static int64_t find_cell( const std::vector< GridCell >& cells, const GridCell& cell )
+{
+    const auto it = std::lower_bound( cells.begin(), cells.end(), cell );
+
+    if ( it == cells.end() || *it != cell ) {
+        return -1;
+    }
+    return it - cells.begin();
+}
+
+void DBSCAN::dbscan_grid( const DBSCAN::ClusterData& cl_d, const DBSCAN::FeaturesWeights& W )
+{
+    const size_t elements_num = cl_d.size1();
+    const double* data = &cl_d.data()[0];
+    const double* weights = &W.data()[0];
+    const double eps = m_eps;
+
+    // stencil of the cells that may contain points within eps: a point at cell offset ( ox, oy )
+    // is at least ( max( |ox| - 1, 0 ) + max( |oy| - 1, 0 ) ) * eps / 2 away
+    std::vector< GridCell > stencil;
+
+    for ( int64_t ox = -3; ox <= 3; ++ox ) {
+        for ( int64_t oy = -3; oy <= 3; ++oy ) {
+            if ( std::max< int64_t >( std::abs( ox ) - 1, 0 ) + std::max< int64_t >( std::abs( oy ) - 1, 0 ) <= 2 ) {
+                stencil.push_back( GridCell( ox, oy ) );
+            }
+        }
+    }
+
+    // points sorted by cell, and by index within a cell
+    const double side_eps = eps * ( 1.0 - grid_side_margin );
+    const double inv_side[2] = { 2.0 * weights[0] / side_eps, 2.0 * weights[1] / side_eps };
+    std::vector< GridCell > point_cell( elements_num );
+    std::vector< uint32_t > order( elements_num );
+
+    for ( uint32_t i = 0; i < elements_num; ++i ) {
+        const double* u = data + i * 2;
+        point_cell[i] = GridCell( static_cast< int64_t >( std::floor( u[0] * inv_side[0] ) ),
+                                  static_cast< int64_t >( std::floor( u[1] * inv_side[1] ) ) );
+        order[i] = i;
+    }
+
+    std::stable_sort( order.begin(), order.end(), [&point_cell]( uint32_t a, uint32_t b ) { return point_cell[a] < point_cell[b]; } );
+
+    std::vector< GridCell > cells;
+    std::vector< uint32_t > cell_start;
+
+    for ( uint32_t i = 0; i < elements_num; ++i ) {
+        if ( cells.empty() || cells.back() != point_cell[order[i]] ) {
+            cells.push_back( point_cell[order[i]] );
+            cell_start.push_back( i );
+        }
+    }
+    cell_start.push_back( elements_num );
+
+    const size_t cells_num = cells.size();
+    const bool dense_cells = eps >= grid_min_eps;
+
+    // cell neighbourhoods, as cell indices
+    std::vector< std::vector< uint32_t > > cell_neighbors( cells_num );
+
+    for ( uint32_t c = 0; c < cells_num; ++c ) {
+        for ( const auto& o : stencil ) {
+            const int64_t nc = find_cell( cells, GridCell( cells[c].first + o.first, cells[c].second + o.second ) );
+
+            if ( nc >= 0 ) {
+                cell_neighbors[c].push_back( nc );
+            }
+        }
+    }
+
+    // core points
+    std::vector< uint8_t > core( elements_num );
+
+    if ( m_count_neighbors ) {
+        m_neighbor_counts.resize( elements_num );
+    }
+
+    for ( uint32_t c = 0; c < cells_num; ++c ) {
+        const uint32_t cell_size = cell_start[c + 1] - cell_start[c];
+
+        for ( uint32_t i = cell_start[c]; i < cell_start[c + 1]; ++i ) {
+            const uint32_t p = order[i];
+
+            if ( past_deadline( i ) ) {
+                return abort_fit();
+            }
+            if ( dense_cells && cell_size >= m_min_elems && !m_count_neighbors ) {
+                core[p] = 1;
+                continue;
+            }
+
+            // without the exact counts, counting stops at min_elems
+            const size_t max_count = m_count_neighbors ? elements_num : m_min_elems;
+            size_t count = 0;
+
+            for ( const auto nc : cell_neighbors[c] ) {
+                for ( uint32_t j = cell_start[nc]; j < cell_start[nc + 1] && count < max_count; ++j ) {
+                    if ( l1_distance< 2 >( data + p * 2, data + order[j] * 2, weights, 2 ) <= eps ) {
+                        ++count;
+                    }
+                }
+            }
+
+            core[p] = count >= m_min_elems;
+            if ( m_count_neighbors ) {
+                m_neighbor_counts[p] = count;
+            }
+        }
+    }
+
+    // connected components of the core points
+    UnionFind components( elements_num );
+
+    for ( uint32_t c = 0; c < cells_num; ++c ) {
+        const bool dense_c = dense_cells && cell_start[c + 1] - cell_start[c] >= m_min_elems;
+
+        if ( dense_c ) {
+            for ( uint32_t i = cell_start[c] + 1; i < cell_start[c + 1]; ++i ) {
+                components.unite( order[cell_start[c]], order[i] );
+            }
+        }
+
+        for ( const auto nc : cell_neighbors[c] ) {
+            if ( nc < c || ( nc == c && dense_c ) ) {
+                continue;
+            }
+
+            const bool dense_nc = dense_cells && cell_start[nc + 1] - cell_start[nc] >= m_min_elems;
+
+            for ( uint32_t i = cell_start[c]; i < cell_start[c + 1]; ++i ) {
+                const uint32_t p = order[i];
+
+                if ( !core[p] ) {
+                    continue;
+                }
+
+                for ( uint32_t j = cell_start[nc]; j < cell_start[nc + 1]; ++j ) {
+                    const uint32_t q = order[j];
+
+                    if ( !core[q] || components.find( p ) == components.find( q ) ) {
+                        continue;
+                    }
+                    if ( l1_distance< 2 >( data + p * 2, data + q * 2, weights, 2 ) <= eps ) {
+                        components.unite( p, q );
+                        if ( dense_nc ) {
+                            break;
+                        }
+                    }
+                }
+
+                if ( dense_c && dense_nc && components.find( order[cell_start[c]] ) == components.find( order[cell_start[nc]] ) ) {
+                    break;
+                }
+            }
+        }
+    }
+
+    // canonical cluster ids, then border points
+    std::vector< int32_t > cluster_id( elements_num, -1 );
+    int32_t clusters_num = 0;
+
+    for ( uint32_t p = 0; p < elements_num; ++p ) {
+        if ( core[p] ) {
+            const uint32_t r = components.find( p );
+
+            if ( cluster_id[r] == -1 ) {
+                cluster_id[r] = clusters_num++;
+            }
+            m_labels[p] = cluster_id[r];
+        }
+    }
+
+    for ( uint32_t c = 0; c < cells_num; ++c ) {
+        for ( uint32_t i = cell_start[c]; i < cell_start[c + 1]; ++i ) {
+            const uint32_t p = order[i];
+
+            if ( core[p] ) {
+                continue;
+            }
+
+            for ( const auto nc : cell_neighbors[c] ) {
+                for ( uint32_t j = cell_start[nc]; j < cell_start[nc + 1]; ++j ) {
+                    const uint32_t q = order[j];
+
+                    if ( core[q] && ( m_labels[p] == -1 || m_labels[q] < m_labels[p] ) &&
+                         l1_distance< 2 >( data + p * 2, data + q * 2, weights, 2 ) <= eps ) {
+                        m_labels[p] = m_labels[q];
+                    }
+                }
+            }
+        }
+    }
+}
+
+void DBSCAN::fit_grid( const DBSCAN::ClusterData& C )
+{
+    const DBSCAN::FeaturesWeights W = DBSCAN::std_weights( C.size2() );
+    wfit_grid( C, W );
+}
+
+void DBSCAN::wfit_grid( const DBSCAN::ClusterData& C, const DBSCAN::FeaturesWeights& W )
+{
+    prepare_labels( C.size1() );
+    m_neighbor_counts.clear();
+
+    DBSCAN::ClusterData cl_d = C;
+    normalize( cl_d );
+
+    m_dmin = 0.0;
+    m_dmax = calc_max_dist( cl_d, W );
+    m_eps = ( m_dmax - m_dmin ) * m_eps + m_dmin;
+
+    // the grid needs a positive cell side
+    if ( cl_d.size2() == 2 && m_eps > 0.0 ) {
+        dbscan_grid( cl_d, W );
+    } else {
+        const KDTree tree( &cl_d.data()[0], cl_d.size1(), cl_d.size2() );
+        dbscan( tree, W );
+    }
+}
+}
@@ -0,0 +1,101 @@
+#include <vector>
+
+#include "dbscan.h"
+#include "kdtree.h"
+#include "union_find.h"
+
+// Parallel DBSCAN over the k-d tree, in three parallel phases separated by barriers: core detection,
+// concurrent union of the core points within eps, and border assignment. The components are numbered
+// by their smallest core point (the root of the union-find), and border points take the smallest
+// adjacent cluster id, so the labels are exactly those of DBSCAN::dbscan. The neighbour lists are
+// queried again in each phase rather than stored.
+
+namespace clustering {
+void DBSCAN::dbscan_parallel( const KDTree& tree, const DBSCAN::FeaturesWeights& W )
+{
+    const int64_t elements_num = tree.size();
+    const double* weights = &W.data()[0];
+    const double eps = m_eps;
+
+    m_neighbor_counts.resize( elements_num );
+    ConcurrentUnionFind components( elements_num );
+    std::vector< int32_t > cluster_id( elements_num, -1 );
+
+#pragma omp parallel num_threads( m_num_threads )
+    {
+        Neighbors ne;
+
+#pragma omp for schedule( dynamic, 256 )
+        for ( int64_t pid = 0; pid < elements_num; ++pid ) {
+            tree.range_query( pid, eps, weights, ne );
+            m_neighbor_counts[pid] = ne.size();
+        }
+
+#pragma omp for schedule( dynamic, 256 )
+        for ( int64_t pid = 0; pid < elements_num; ++pid ) {
+            if ( m_neighbor_counts[pid] < m_min_elems ) {
+                continue;
+            }
+            tree.range_query( pid, eps, weights, ne );
+            for ( const auto q : ne ) {
+                if ( q > pid && m_neighbor_counts[q] >= m_min_elems ) {
+                    components.unite( pid, q );
+                }
+            }
+        }
+
+        // canonical numbering of the components, in the order of their roots
+#pragma omp single
+        {
+            int32_t clusters_num = 0;
+
+            for ( int64_t pid = 0; pid < elements_num; ++pid ) {
+                if ( m_neighbor_counts[pid] >= m_min_elems && components.find( pid ) == pid ) {
+                    cluster_id[pid] = clusters_num++;
+                }
+            }
+        }
+
+#pragma omp for schedule( static )
+        for ( int64_t pid = 0; pid < elements_num; ++pid ) {
+            if ( m_neighbor_counts[pid] >= m_min_elems ) {
+                m_labels[pid] = cluster_id[components.find( pid )];
+            }
+        }
+
+#pragma omp for schedule( dynamic, 256 )
+        for ( int64_t pid = 0; pid < elements_num; ++pid ) {
+            if ( m_neighbor_counts[pid] >= m_min_elems ) {
+                continue;
+            }
+            tree.range_query( pid, eps, weights, ne );
+            for ( const auto q : ne ) {
+                if ( m_neighbor_counts[q] >= m_min_elems && ( m_labels[pid] == -1 || m_labels[q] < m_labels[pid] ) ) {
+                    m_labels[pid] = m_labels[q];
+                }
+            }
+        }
+    }
+}
+
+void DBSCAN::fit_parallel( const DBSCAN::ClusterData& C )
+{
+    const DBSCAN::FeaturesWeights W = DBSCAN::std_weights( C.size2() );
+    wfit_parallel( C, W );
+}
+
+void DBSCAN::wfit_parallel( const DBSCAN::ClusterData& C, const DBSCAN::FeaturesWeights& W )
+{
+    prepare_labels( C.size1() );
+
+    DBSCAN::ClusterData cl_d = C;
+    normalize( cl_d );
+
+    m_dmin = 0.0;
+    m_dmax = calc_max_dist( cl_d, W );
+    m_eps = ( m_dmax - m_dmin ) * m_eps + m_dmin;
+
+    const KDTree tree( &cl_d.data()[0], cl_d.size1(), cl_d.size2() );
+    dbscan_parallel( tree, W );
+}
+}
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <vector>
+
+#include "dbscan.h"
+#include "l1_tiles.h"
+#include "union_find.h"
+
+// Memory-bounded DBSCAN. The distances are never stored: they are recomputed block by block with the
+// tiled kernel, and only O(n) state is kept besides a block of distances whose size is set by the memory
+// budget. The first sweep counts the eps-neighbours of every point, the second one joins the core points
+// within eps in a union-find, and the third one gives each border point the smallest cluster id among its
+// core neighbours. The labels are those of DBSCAN::dbscan.
+
+namespace clustering {
+// Points per column block, so that the feature-major block and its distances fit in the budget
+static size_t block_size( size_t memory_budget, size_t features_num )
+{
+    const size_t min_block = 64;
+    return std::max( min_block, memory_budget / ( sizeof( double ) * ( features_num + 1 ) ) );
+}
+
+// Calls visit( i, j ) for the pairs within eps of rows x columns, both given row-major. With
+// upper_only, rows and columns are the same points and only the pairs i < j are visited.
+// Stops as soon as stop( i ) is true for a row i.
+template < typename Visit, typename Stop >
+static void for_each_pair( const double* rows, size_t rows_num, const double* cols, size_t cols_num, size_t features_num,
+                           const double* weights, double eps, bool upper_only, size_t block, Visit visit, Stop stop )
+{
+    std::vector< double > soa;
+    to_feature_major( cols, cols_num, features_num, soa );
+
+    std::vector< double > dist( std::min( block, cols_num ) );
+
+    for ( size_t c0 = 0; c0 < cols_num; c0 += block ) {
+        const size_t c1 = std::min( c0 + block, cols_num );
+        const size_t i1 = upper_only ? std::min( c1, rows_num ) : rows_num;
+
+        for ( size_t i = 0; i < i1; ++i ) {
+            const size_t j0 = upper_only ? std::max( c0, i + 1 ) : c0;
+
+            if ( j0 >= c1 ) {
+                continue;
+            }
+            if ( stop( i ) ) {
+                return;
+            }
+
+            l1_distances( rows + i * features_num, &soa[0], cols_num, features_num, weights, j0, c1, &dist[0] );
+
+            for ( size_t j = j0; j < c1; ++j ) {
+                if ( dist[j - j0] <= eps ) {
+                    visit( i, j );
+                }
+            }
+        }
+    }
+}
+
+void DBSCAN::dbscan_streaming( const DBSCAN::ClusterData& cl_d, const DBSCAN::FeaturesWeights& W, size_t memory_budget )
+{
+    const size_t elements_num = cl_d.size1();
+    const size_t features_num = cl_d.size2();
+    const double* data = &cl_d.data()[0];
+    const double* weights = &W.data()[0];
+    const size_t block = block_size( memory_budget, features_num );
+    auto stop = [this]( size_t i ) { return past_deadline( i ); };
+
+    // eps-neighbour counts, the point included
+    m_neighbor_counts.assign( elements_num, 1 );
+
+    for_each_pair( data, elements_num, data, elements_num, features_num, weights, m_eps, true, block,
+                   [this]( size_t i, size_t j ) {
+                       ++m_neighbor_counts[i];
+                       ++m_neighbor_counts[j];
+                   }, stop );
+
+    if ( m_timed_out ) {
+        return abort_fit();
+    }
+
+    // core points, and their features
+    std::vector< uint32_t > cores;
+    std::vector< uint32_t > borders;
+
+    for ( uint32_t pid = 0; pid < elements_num; ++pid ) {
+        if ( m_neighbor_counts[pid] >= m_min_elems ) {
+            cores.push_back( pid );
+        } else {
+            borders.push_back( pid );
+        }
+    }
+
+    std::vector< double > core_data( cores.size() * features_num );
+    std::vector< double > border_data( borders.size() * features_num );
+
+    for ( size_t c = 0; c < cores.size(); ++c ) {
+        std::copy( data + cores[c] * features_num, data + ( cores[c] + 1 ) * features_num, &core_data[c * features_num] );
+    }
+    for ( size_t b = 0; b < borders.size(); ++b ) {
+        std::copy( data + borders[b] * features_num, data + ( borders[b] + 1 ) * features_num, &border_data[b * features_num] );
+    }
+
+    if ( cores.empty() ) {
+        return;
+    }
+
+    // connected components of the core points, indexed by rank in cores, so that
+    // the root of a component is its first core point
+    UnionFind components( cores.size() );
+
+    for_each_pair( &core_data[0], cores.size(), &core_data[0], cores.size(), features_num, weights, m_eps, true, block,
+                   [&components]( size_t i, size_t j ) { components.unite( i, j ); }, stop );
+
+    if ( m_timed_out ) {
+        return abort_fit();
+    }
+
+    std::vector< int32_t > cluster_id( cores.size(), -1 );
+    int32_t clusters_num = 0;
+
+    for ( uint32_t c = 0; c < cores.size(); ++c ) {
+        const uint32_t r = components.find( c );
+
+        if ( cluster_id[r] == -1 ) {
+            cluster_id[r] = clusters_num++;
+        }
+        cluster_id[c] = cluster_id[r];
+        m_labels[cores[c]] = cluster_id[c];
+    }
+
+    if ( borders.empty() ) {
+        return;
+    }
+
+    for_each_pair( &border_data[0], borders.size(), &core_data[0], cores.size(), features_num, weights, m_eps, false, block,
+                   [this, &borders, &cluster_id]( size_t b, size_t c ) {
+                       int32_t& label = m_labels[borders[b]];
+
+                       if ( label == -1 || cluster_id[c] < label ) {
+                           label = cluster_id[c];
+                       }
+                   }, stop );
+
+    if ( m_timed_out ) {
+        return abort_fit();
+    }
+}
+
+void DBSCAN::fit_streaming( const DBSCAN::ClusterData& C, size_t memory_budget )
+{
+    const DBSCAN::FeaturesWeights W = DBSCAN::std_weights( C.size2() );
+    wfit_streaming( C, W, memory_budget );
+}
+
+void DBSCAN::wfit_streaming( const DBSCAN::ClusterData& C, const DBSCAN::FeaturesWeights& W, size_t memory_budget )
+{
+    prepare_labels( C.size1() );
+    m_neighbor_counts.clear();
+
+    DBSCAN::ClusterData cl_d = C;
+    normalize( cl_d );
+
+    // the range of the distances only needs O(n) scans, see calc_max_dist
+    m_dmin = 0.0;
+    m_dmax = calc_max_dist( cl_d, W );
+    m_eps = ( m_dmax - m_dmin ) * m_eps + m_dmin;
+
+    dbscan_streaming( cl_d, W, memory_budget );
+}
+}
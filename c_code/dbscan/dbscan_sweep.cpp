@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "dbscan.h"
+#include "kdtree.h"
+#include "l1_distance.h"
+#include "union_find.h"
+
+// DBSCAN for a list of eps values from a single neighbourhood computation at the largest eps.
+// A point is core at eps if its core distance, the distance to its min_elems-th nearest point (itself
+// included), is within eps, and two core points are in the same cluster at eps if they are linked by
+// edges (p, q) of weight max( d(p, q), core( p ), core( q ) ) <= eps. The edges are sorted by weight and
+// added to a union-find while the eps values are processed in increasing order, as in a single-linkage
+// tree over the core distances. Border points then take the smallest cluster id among their core
+// neighbours. Each labelling is exactly the one of DBSCAN::dbscan at that eps.
+
+namespace clustering {
+struct WeightedEdge {
+    double weight;
+    uint32_t p;
+    uint32_t q;
+    bool operator<( const WeightedEdge& e ) const { return weight < e.weight; }
+};
+
+void DBSCAN::fit_eps_sweep( const DBSCAN::ClusterData& C, const std::vector< double >& eps_list, std::vector< DBSCAN::Labels >& labels_list )
+{
+    const DBSCAN::FeaturesWeights W = DBSCAN::std_weights( C.size2() );
+    wfit_eps_sweep( C, W, eps_list, labels_list );
+}
+
+void DBSCAN::wfit_eps_sweep( const DBSCAN::ClusterData& C, const DBSCAN::FeaturesWeights& W, const std::vector< double >& eps_list, std::vector< DBSCAN::Labels >& labels_list )
+{
+    const size_t elements_num = C.size1();
+    const size_t features_num = C.size2();
+    const double infinity = std::numeric_limits< double >::infinity();
+
+    labels_list.assign( eps_list.size(), Labels( elements_num, -1 ) );
+    if ( eps_list.empty() || !elements_num ) {
+        return;
+    }
+
+    DBSCAN::ClusterData cl_d = C;
+    normalize( cl_d );
+
+    m_dmin = 0.0;
+    m_dmax = calc_max_dist( cl_d, W );
+
+    std::vector< double > eps_abs( eps_list.size() );
+    std::vector< uint32_t > eps_order( eps_list.size() );
+
+    for ( uint32_t e = 0; e < eps_list.size(); ++e ) {
+        eps_abs[e] = ( m_dmax - m_dmin ) * eps_list[e] + m_dmin;
+        eps_order[e] = e;
+    }
+    std::sort( eps_order.begin(), eps_order.end(), [&eps_abs]( uint32_t a, uint32_t b ) { return eps_abs[a] < eps_abs[b]; } );
+    m_eps = eps_abs[eps_order.back()];
+
+    // neighbourhoods at the largest eps, with their distances
+    const double* data = &cl_d.data()[0];
+    const double* weights = &W.data()[0];
+    const KDTree tree( data, elements_num, features_num );
+    std::vector< size_t > offsets( 1, 0 );
+    Neighbors ids;
+    std::vector< double > dists;
+    Neighbors ne;
+
+    for ( uint32_t pid = 0; pid < elements_num; ++pid ) {
+        tree.range_query( pid, m_eps, weights, ne );
+        for ( const auto q : ne ) {
+            ids.push_back( q );
+            dists.push_back( l1_distance< 0 >( data + pid * features_num, data + q * features_num, weights, features_num ) );
+        }
+        offsets.push_back( ids.size() );
+    }
+
+    // core distances, infinite for the points that are not core at the largest eps
+    std::vector< double > core_dist( elements_num, infinity );
+    std::vector< double > sorted;
+
+    for ( uint32_t pid = 0; pid < elements_num; ++pid ) {
+        if ( m_min_elems && offsets[pid + 1] - offsets[pid] >= m_min_elems ) {
+            sorted.assign( dists.begin() + offsets[pid], dists.begin() + offsets[pid + 1] );
+            std::nth_element( sorted.begin(), sorted.begin() + m_min_elems - 1, sorted.end() );
+            core_dist[pid] = sorted[m_min_elems - 1];
+        } else if ( !m_min_elems ) {
+            core_dist[pid] = 0.0;
+        }
+    }
+
+    std::vector< WeightedEdge > edges;
+
+    for ( uint32_t pid = 0; pid < elements_num; ++pid ) {
+        for ( size_t k = offsets[pid]; k < offsets[pid + 1]; ++k ) {
+            const uint32_t q = ids[k];
+
+            if ( q > pid && core_dist[pid] < infinity && core_dist[q] < infinity ) {
+                edges.push_back( WeightedEdge{ std::max( dists[k], std::max( core_dist[pid], core_dist[q] ) ), pid, q } );
+            }
+        }
+    }
+    std::sort( edges.begin(), edges.end() );
+
+    UnionFind components( elements_num );
+    std::vector< int32_t > cluster_id( elements_num );
+    size_t next_edge = 0;
+
+    for ( const auto e : eps_order ) {
+        const double eps = eps_abs[e];
+        Labels& labels = labels_list[e];
+
+        for ( ; next_edge < edges.size() && edges[next_edge].weight <= eps; ++next_edge ) {
+            components.unite( edges[next_edge].p, edges[next_edge].q );
+        }
+
+        // clusters numbered by their first core point, which is the root of their component
+        int32_t clusters_num = 0;
+
+        for ( uint32_t pid = 0; pid < elements_num; ++pid ) {
+            if ( core_dist[pid] <= eps ) {
+                const uint32_t r = components.find( pid );
+
+                if ( r == pid ) {
+                    cluster_id[pid] = clusters_num++;
+                }
+                labels[pid] = cluster_id[r];
+            }
+        }
+
+        for ( uint32_t pid = 0; pid < elements_num; ++pid ) {
+            if ( core_dist[pid] <= eps ) {
+                continue;
+            }
+            for ( size_t k = offsets[pid]; k < offsets[pid + 1]; ++k ) {
+                const uint32_t q = ids[k];
+
+                if ( dists[k] <= eps && core_dist[q] <= eps && ( labels[pid] == -1 || labels[q] < labels[pid] ) ) {
+                    labels[pid] = labels[q];
+                }
+            }
+        }
+    }
+
+    m_labels = labels_list[eps_order.back()];
+}
+}
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <cmath>
+
+#include "kdtree.h"
+#include "l1_distance.h"
+
+namespace clustering {
+KDTree::KDTree( const double* data, size_t elements_num, size_t features_num, size_t leaf_size )
+    : m_data( data )
+    , m_elements_num( elements_num )
+    , m_features_num( features_num )
+    , m_leaf_size( leaf_size ? leaf_size : 1 )
+    , m_index( elements_num )
+{
+    for ( uint32_t i = 0; i < elements_num; ++i ) {
+        m_index[i] = i;
+    }
+
+    if ( elements_num ) {
+        build( 0, elements_num );
+    }
+}
+
+size_t KDTree::size() const
+{
+    return m_elements_num;
+}
+
+int32_t KDTree::build( uint32_t begin, uint32_t end )
+{
+    const int32_t id = m_nodes.size();
+    const size_t d = m_features_num;
+
+    m_nodes.push_back( Node{ begin, end, -1, -1 } );
+    m_bounds.resize( m_bounds.size() + 2 * d );
+
+    double* lo = &m_bounds[2 * d * id];
+    double* hi = lo + d;
+
+    for ( size_t k = 0; k < d; ++k ) {
+        lo[k] = hi[k] = m_data[m_index[begin] * d + k];
+    }
+
+    for ( uint32_t i = begin + 1; i < end; ++i ) {
+        const double* p = m_data + m_index[i] * d;
+
+        for ( size_t k = 0; k < d; ++k ) {
+            lo[k] = std::min( lo[k], p[k] );
+            hi[k] = std::max( hi[k], p[k] );
+        }
+    }
+
+    // split along the dimension of largest spread, unless the node is small or all its points coincide
+    size_t split_dim = 0;
+    double spread = 0.0;
+
+    for ( size_t k = 0; k < d; ++k ) {
+        if ( hi[k] - lo[k] > spread ) {
+            spread = hi[k] - lo[k];
+            split_dim = k;
+        }
+    }
+
+    if ( end - begin <= m_leaf_size || spread == 0.0 ) {
+        return id;
+    }
+
+    const uint32_t mid = begin + ( end - begin ) / 2;
+    const double* data = m_data;
+
+    std::nth_element( m_index.begin() + begin, m_index.begin() + mid, m_index.begin() + end,
+                      [data, d, split_dim]( uint32_t a, uint32_t b ) { return data[a * d + split_dim] < data[b * d + split_dim]; } );
+
+    // m_nodes and m_bounds may be reallocated by the recursive calls
+    const int32_t left = build( begin, mid );
+    const int32_t right = build( mid, end );
+
+    m_nodes[id].left = left;
+    m_nodes[id].right = right;
+
+    return id;
+}
+
+template < size_t N >
+void KDTree::range_query_impl( uint32_t pid, double eps, const double* weights, Neighbors& ne ) const
+{
+    const size_t d = N ? N : m_features_num;
+    const double* q = m_data + pid * d;
+
+    std::vector< int32_t > stack( 1, 0 );
+
+    while ( !stack.empty() ) {
+        const Node& node = m_nodes[stack.back()];
+        const double* lo = &m_bounds[2 * d * stack.back()];
+        const double* hi = lo + d;
+        stack.pop_back();
+
+        // lower bound of the distance to the box, summed in the same order as l1_distance so that
+        // it never exceeds the computed distance of a point of the box
+        double box_dist = 0.0;
+
+        for ( size_t k = 0; k < d; ++k ) {
+            if ( q[k] < lo[k] ) {
+                box_dist += ( lo[k] - q[k] ) * weights[k];
+            } else if ( q[k] > hi[k] ) {
+                box_dist += ( q[k] - hi[k] ) * weights[k];
+            }
+        }
+
+        if ( box_dist > eps ) {
+            continue;
+        }
+
+        if ( node.left < 0 ) {
+            for ( uint32_t i = node.begin; i < node.end; ++i ) {
+                const uint32_t j = m_index[i];
+
+                if ( l1_distance< N >( q, m_data + j * d, weights, d ) <= eps ) {
+                    ne.push_back( j );
+                }
+            }
+        } else {
+            stack.push_back( node.right );
+            stack.push_back( node.left );
+        }
+    }
+}
+
+void KDTree::range_query( uint32_t pid, double eps, const double* weights, Neighbors& ne ) const
+{
+    ne.clear();
+
+    if ( !m_elements_num ) {
+        return;
+    }
+
+    switch ( m_features_num ) {
+    case 2:
+        range_query_impl< 2 >( pid, eps, weights, ne );
+        break;
+    case 3:
+        range_query_impl< 3 >( pid, eps, weights, ne );
+        break;
+    case 4:
+        range_query_impl< 4 >( pid, eps, weights, ne );
+        break;
+    default:
+        range_query_impl< 0 >( pid, eps, weights, ne );
+    }
+
+    std::sort( ne.begin(), ne.end() );
+}
+}
@@ -0,0 +1,47 @@
+#ifndef DBSCAN_KDTREE_H
+#define DBSCAN_KDTREE_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+namespace clustering {
+// k-d tree over the rows of a row-major elements_num x features_num array.
+// It answers weighted L1 eps-range queries, which is all DBSCAN needs, in place of a dense distance matrix.
+// The array is not copied and must outlive the tree.
+class KDTree {
+public:
+    typedef std::vector< uint32_t > Neighbors;
+
+    KDTree( const double* data, size_t elements_num, size_t features_num, size_t leaf_size = 16 );
+
+    // Indices of the points within distance eps of point pid (pid included), in increasing order
+    void range_query( uint32_t pid, double eps, const double* weights, Neighbors& ne ) const;
+
+    size_t size() const;
+
+private:
+    struct Node {
+        uint32_t begin;
+        uint32_t end;
+        int32_t left;
+        int32_t right;
+    };
+
+    int32_t build( uint32_t begin, uint32_t end );
+    template < size_t N >
+    void range_query_impl( uint32_t pid, double eps, const double* weights, Neighbors& ne ) const;
+
+    const double* m_data;
+    size_t m_elements_num;
+    size_t m_features_num;
+    size_t m_leaf_size;
+
+    std::vector< uint32_t > m_index;
+    std::vector< Node > m_nodes;
+    // bounding box of each node: features_num lower bounds followed by features_num upper bounds
+    std::vector< double > m_bounds;
+};
+}
+
+#endif
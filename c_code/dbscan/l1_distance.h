@@ -0,0 +1,25 @@
+#ifndef DBSCAN_L1_DISTANCE_H
+#define DBSCAN_L1_DISTANCE_H
+
+#include <cmath>
+#include <cstddef>
+
+namespace clustering {
+// Weighted L1 distance between two rows. N > 0 fixes the number of features at compile time
+// so that the loop is unrolled, N = 0 is the generic version.
+// Every DBSCAN engine goes through this kernel so that they all compute bitwise identical distances.
+template < size_t N >
+inline double l1_distance( const double* u, const double* v, const double* w, size_t features_num )
+{
+    const size_t n = N ? N : features_num;
+    double d = 0.0;
+
+    for ( size_t k = 0; k < n; ++k ) {
+        d += std::fabs( u[k] - v[k] ) * w[k];
+    }
+
+    return d;
+}
+}
+
+#endif
@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <omp.h>
+
+#include "l1_quantized.h"
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define DBSCAN_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace clustering {
+// same tiles as the double kernels, the columns of a block take 4 times less cache
+static const size_t row_tile = 64;
+static const size_t col_tile = 1024;
+static const uint32_t quantized_max = 65535;
+
+// Quantized distances from u to the points j0..j1-1 of the feature-major array soa (n points), in dist[0..j1-j0),
+// saturated at 65535. The sums are exact below 65535, so the result does not depend on the kernel.
+typedef void ( *L1QuantizedKernel )( const uint16_t* u, const uint16_t* soa, size_t n, size_t features_num,
+                                     size_t j0, size_t j1, uint16_t* dist );
+
+static void l1_quantized_scalar( const uint16_t* u, const uint16_t* soa, size_t n, size_t features_num,
+                                 size_t j0, size_t j1, uint16_t* dist )
+{
+    for ( size_t j = j0; j < j1; ++j ) {
+        uint32_t d = 0;
+
+        for ( size_t k = 0; k < features_num; ++k ) {
+            const int32_t diff = int32_t( u[k] ) - int32_t( soa[k * n + j] );
+            d += diff < 0 ? -diff : diff;
+        }
+        dist[j - j0] = uint16_t( std::min( d, quantized_max ) );
+    }
+}
+
+#ifdef DBSCAN_X86_KERNELS
+// |a - b| of unsigned 16-bit lanes is ( a -sat b ) | ( b -sat a ), and the sum over the features saturates
+__attribute__( ( target( "avx2" ) ) )
+static void l1_quantized_avx2( const uint16_t* u, const uint16_t* soa, size_t n, size_t features_num,
+                               size_t j0, size_t j1, uint16_t* dist )
+{
+    size_t j = j0;
+
+    for ( ; j + 16 <= j1; j += 16 ) {
+        __m256i acc = _mm256_setzero_si256();
+
+        for ( size_t k = 0; k < features_num; ++k ) {
+            const __m256i a = _mm256_set1_epi16( short( u[k] ) );
+            const __m256i b = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( soa + k * n + j ) );
+            acc = _mm256_adds_epu16( acc, _mm256_or_si256( _mm256_subs_epu16( a, b ), _mm256_subs_epu16( b, a ) ) );
+        }
+        _mm256_storeu_si256( reinterpret_cast< __m256i* >( dist + j - j0 ), acc );
+    }
+
+    l1_quantized_scalar( u, soa, n, features_num, j, j1, dist + j - j0 );
+}
+
+__attribute__( ( target( "avx512bw" ) ) )
+static void l1_quantized_avx512( const uint16_t* u, const uint16_t* soa, size_t n, size_t features_num,
+                                 size_t j0, size_t j1, uint16_t* dist )
+{
+    size_t j = j0;
+
+    for ( ; j + 32 <= j1; j += 32 ) {
+        __m512i acc = _mm512_setzero_si512();
+
+        for ( size_t k = 0; k < features_num; ++k ) {
+            const __m512i a = _mm512_set1_epi16( short( u[k] ) );
+            const __m512i b = _mm512_loadu_si512( soa + k * n + j );
+            acc = _mm512_adds_epu16( acc, _mm512_or_si512( _mm512_subs_epu16( a, b ), _mm512_subs_epu16( b, a ) ) );
+        }
+        _mm512_storeu_si512( dist + j - j0, acc );
+    }
+
+    l1_quantized_scalar( u, soa, n, features_num, j, j1, dist + j - j0 );
+}
+#endif
+
+static L1QuantizedKernel select_kernel( const char** name )
+{
+#ifdef DBSCAN_X86_KERNELS
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports( "avx512bw" ) ) {
+        *name = "avx512bw";
+        return l1_quantized_avx512;
+    }
+    if ( __builtin_cpu_supports( "avx2" ) ) {
+        *name = "avx2";
+        return l1_quantized_avx2;
+    }
+#endif
+    *name = "scalar";
+    return l1_quantized_scalar;
+}
+
+static const char* kernel_name = "scalar";
+static const L1QuantizedKernel l1_quantized = select_kernel( &kernel_name );
+
+const char* l1_quantized_kernel_name()
+{
+    return kernel_name;
+}
+
+double quantize_feature_major( const double* data, size_t elements_num, size_t features_num, const double* weights,
+                               double eps, std::vector< uint16_t >& soa )
+{
+    double w_max = 0.0;
+
+    for ( size_t k = 0; k < features_num; ++k ) {
+        w_max = std::max( w_max, weights[k] );
+    }
+
+    double scale = w_max > 0.0 ? quantized_max / w_max : 1.0;
+
+    if ( eps * scale >= quantized_max ) {
+        scale = ( quantized_max - 1 ) / eps;
+    }
+
+    soa.resize( elements_num * features_num );
+
+    for ( size_t j = 0; j < elements_num; ++j ) {
+        for ( size_t k = 0; k < features_num; ++k ) {
+            const double q = std::floor( data[j * features_num + k] * weights[k] * scale + 0.5 );
+            soa[k * elements_num + j] = uint16_t( std::min( std::max( q, 0.0 ), double( quantized_max ) ) );
+        }
+    }
+
+    return scale;
+}
+
+bool l1_upper_neighbors_quantized( const uint16_t* soa, size_t elements_num, size_t features_num, uint32_t eps,
+                                   int num_threads, double deadline, std::vector< std::vector< uint32_t > >& upper )
+{
+    upper.assign( elements_num, std::vector< uint32_t >() );
+
+    const int64_t tiles_num = ( elements_num + row_tile - 1 ) / row_tile;
+    std::atomic< bool > timed_out( false );
+
+#pragma omp parallel num_threads( num_threads )
+    {
+        std::vector< uint16_t > dist( col_tile );
+        std::vector< uint16_t > u( features_num );
+
+#pragma omp for schedule( dynamic )
+        for ( int64_t tile = 0; tile < tiles_num; ++tile ) {
+            if ( timed_out.load( std::memory_order_relaxed ) ) {
+                continue;
+            }
+            if ( deadline > 0.0 && omp_get_wtime() > deadline ) {
+                timed_out.store( true, std::memory_order_relaxed );
+                continue;
+            }
+            const size_t i0 = tile * row_tile;
+            const size_t i1 = std::min( i0 + row_tile, elements_num );
+
+            for ( size_t c0 = i0; c0 < elements_num; c0 += col_tile ) {
+                const size_t c1 = std::min( c0 + col_tile, elements_num );
+
+                for ( size_t i = i0; i < i1; ++i ) {
+                    const size_t j0 = std::max( c0, i + 1 );
+
+                    if ( j0 >= c1 ) {
+                        continue;
+                    }
+
+                    for ( size_t k = 0; k < features_num; ++k ) {
+                        u[k] = soa[k * elements_num + i];
+                    }
+
+                    l1_quantized( &u[0], soa, elements_num, features_num, j0, c1, &dist[0] );
+
+                    for ( size_t j = j0; j < c1; ++j ) {
+                        if ( dist[j - j0] <= eps ) {
+                            upper[i].push_back( j );
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return !timed_out;
+}
+}
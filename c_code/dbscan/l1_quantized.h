@@ -0,0 +1,29 @@
+#ifndef DBSCAN_L1_QUANTIZED_H
+#define DBSCAN_L1_QUANTIZED_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+namespace clustering {
+// 16-bit fixed point version of l1_upper_neighbors. Each weighted feature w_k * x_k of the normalized data
+// is rounded to an integer in [0, 65535], so that the L1 distances are sums of integer differences and
+// SIMD lanes hold 16-bit values (4 times less memory than doubles, 4 times more lanes per register).
+
+// Feature-major quantized copy of a row-major elements_num x features_num array with values in [0, 1]:
+// feature k of point j is rounded( data[j][k] * weights[k] * scale ) at k * elements_num + j. The scale
+// is the largest one such that all values fit in 16 bits and eps * scale < 65535, so that a saturated
+// distance is always beyond eps. Returns the scale: quantized distances are about scale times the weighted ones.
+double quantize_feature_major( const double* data, size_t elements_num, size_t features_num, const double* weights,
+                               double eps, std::vector< uint16_t >& soa );
+
+// upper[i] receives the indices j > i such that the quantized distance between i and j is at most eps,
+// in increasing order. eps must be below 65535. Returns false if deadline passed (as l1_upper_neighbors).
+bool l1_upper_neighbors_quantized( const uint16_t* soa, size_t elements_num, size_t features_num, uint32_t eps,
+                                   int num_threads, double deadline, std::vector< std::vector< uint32_t > >& upper );
+
+// Name of the quantized distance kernel selected for this CPU ("avx512bw", "avx2" or "scalar")
+const char* l1_quantized_kernel_name();
+}
+
+#endif
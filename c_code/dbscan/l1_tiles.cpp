@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <omp.h>
+
+#include "l1_tiles.h"
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define DBSCAN_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace clustering {
+// rows of a tile, and points of a block of columns (features_num * col_tile doubles stay in cache)
+static const size_t row_tile = 64;
+static const size_t col_tile = 1024;
+
+// Distances from u to the points j0..j1-1 of the feature-major array soa (n points), in dist[0..j1-j0).
+// Each distance is accumulated over the features in order, with a separate multiply and add,
+// exactly like l1_distance. The SIMD kernels are compiled with fp-contract=off: their targets have FMA
+// (avx512f implies it), which would otherwise fuse the multiply and add and round differently with
+// non-unit weights.
+typedef void ( *L1BlockKernel )( const double* u, const double* soa, size_t n, size_t features_num,
+                                 const double* weights, size_t j0, size_t j1, double* dist );
+
+static void l1_block_scalar( const double* u, const double* soa, size_t n, size_t features_num,
+                             const double* weights, size_t j0, size_t j1, double* dist )
+{
+    for ( size_t j = j0; j < j1; ++j ) {
+        dist[j - j0] = 0.0;
+    }
+    for ( size_t k = 0; k < features_num; ++k ) {
+        const double* v = soa + k * n;
+
+        for ( size_t j = j0; j < j1; ++j ) {
+            dist[j - j0] += std::fabs( u[k] - v[j] ) * weights[k];
+        }
+    }
+}
+
+#ifdef DBSCAN_X86_KERNELS
+__attribute__( ( target( "avx2" ), optimize( "fp-contract=off" ) ) )
+static void l1_block_avx2( const double* u, const double* soa, size_t n, size_t features_num,
+                           const double* weights, size_t j0, size_t j1, double* dist )
+{
+    const __m256d sign = _mm256_set1_pd( -0.0 );
+    size_t j = j0;
+
+    for ( ; j + 4 <= j1; j += 4 ) {
+        __m256d acc = _mm256_setzero_pd();
+
+        for ( size_t k = 0; k < features_num; ++k ) {
+            const __m256d diff = _mm256_sub_pd( _mm256_set1_pd( u[k] ), _mm256_loadu_pd( soa + k * n + j ) );
+            acc = _mm256_add_pd( acc, _mm256_mul_pd( _mm256_andnot_pd( sign, diff ), _mm256_set1_pd( weights[k] ) ) );
+        }
+        _mm256_storeu_pd( dist + j - j0, acc );
+    }
+
+    l1_block_scalar( u, soa, n, features_num, weights, j, j1, dist + j - j0 );
+}
+
+__attribute__( ( target( "avx512f" ), optimize( "fp-contract=off" ) ) )
+static void l1_block_avx512( const double* u, const double* soa, size_t n, size_t features_num,
+                             const double* weights, size_t j0, size_t j1, double* dist )
+{
+    const __m512i abs_mask = _mm512_set1_epi64( 0x7fffffffffffffffLL );
+    size_t j = j0;
+
+    for ( ; j + 8 <= j1; j += 8 ) {
+        __m512d acc = _mm512_setzero_pd();
+
+        for ( size_t k = 0; k < features_num; ++k ) {
+            const __m512d diff = _mm512_sub_pd( _mm512_set1_pd( u[k] ), _mm512_loadu_pd( soa + k * n + j ) );
+            const __m512d abs_diff = _mm512_castsi512_pd( _mm512_and_epi64( _mm512_castpd_si512( diff ), abs_mask ) );
+            acc = _mm512_add_pd( acc, _mm512_mul_pd( abs_diff, _mm512_set1_pd( weights[k] ) ) );
+        }
+        _mm512_storeu_pd( dist + j - j0, acc );
+    }
+
+    l1_block_scalar( u, soa, n, features_num, weights, j, j1, dist + j - j0 );
+}
+#endif
+
+static L1BlockKernel select_kernel( const char** name )
+{
+#ifdef DBSCAN_X86_KERNELS
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports( "avx512f" ) ) {
+        *name = "avx512";
+        return l1_block_avx512;
+    }
+    if ( __builtin_cpu_supports( "avx2" ) ) {
+        *name = "avx2";
+        return l1_block_avx2;
+    }
+#endif
+    *name = "scalar";
+    return l1_block_scalar;
+}
+
+static const char* kernel_name = "scalar";
+static const L1BlockKernel l1_block = select_kernel( &kernel_name );
+
+const char* l1_kernel_name()
+{
+    return kernel_name;
+}
+
+void to_feature_major( const double* data, size_t elements_num, size_t features_num, std::vector< double >& soa )
+{
+    soa.resize( elements_num * features_num );
+
+    for ( size_t j = 0; j < elements_num; ++j ) {
+        for ( size_t k = 0; k < features_num; ++k ) {
+            soa[k * elements_num + j] = data[j * features_num + k];
+        }
+    }
+}
+
+void l1_distances( const double* u, const double* soa, size_t elements_num, size_t features_num,
+                   const double* weights, size_t j0, size_t j1, double* dist )
+{
+    l1_block( u, soa, elements_num, features_num, weights, j0, j1, dist );
+}
+
+bool l1_upper_neighbors( const double* data, size_t elements_num, size_t features_num, const double* weights,
+                         double eps, int num_threads, double deadline, std::vector< std::vector< uint32_t > >& upper )
+{
+    upper.assign( elements_num, std::vector< uint32_t >() );
+
+    std::vector< double > soa;
+    to_feature_major( data, elements_num, features_num, soa );
+
+    const int64_t tiles_num = ( elements_num + row_tile - 1 ) / row_tile;
+    std::atomic< bool > timed_out( false );
+
+#pragma omp parallel num_threads( num_threads )
+    {
+        std::vector< double > dist( col_tile );
+
+#pragma omp for schedule( dynamic )
+        for ( int64_t tile = 0; tile < tiles_num; ++tile ) {
+            if ( timed_out.load( std::memory_order_relaxed ) ) {
+                continue;
+            }
+            if ( deadline > 0.0 && omp_get_wtime() > deadline ) {
+                timed_out.store( true, std::memory_order_relaxed );
+                continue;
+            }
+            const size_t i0 = tile * row_tile;
+            const size_t i1 = std::min( i0 + row_tile, elements_num );
+
+            for ( size_t c0 = i0; c0 < elements_num; c0 += col_tile ) {
+                const size_t c1 = std::min( c0 + col_tile, elements_num );
+
+                for ( size_t i = i0; i < i1; ++i ) {
+                    const size_t j0 = std::max( c0, i + 1 );
+
+                    if ( j0 >= c1 ) {
+                        continue;
+                    }
+
+                    l1_block( data + i * features_num, &soa[0], elements_num, features_num, weights, j0, c1, &dist[0] );
+
+                    for ( size_t j = j0; j < c1; ++j ) {
+                        if ( dist[j - j0] <= eps ) {
+                            upper[i].push_back( j );
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return !timed_out;
+}
+}
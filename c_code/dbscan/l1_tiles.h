@@ -0,0 +1,31 @@
+#ifndef DBSCAN_L1_TILES_H
+#define DBSCAN_L1_TILES_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+namespace clustering {
+// All pairs of points within eps, without a distance matrix. The rows of the row-major
+// elements_num x features_num array are copied feature-major, so that the distances from one point to
+// a block of consecutive points are computed with SIMD (AVX-512 or AVX2, chosen at run time) over
+// cache-sized tiles, and only the pairs within eps are kept. The distances are bitwise identical to
+// l1_distance. upper[i] receives the indices j > i within eps of i, in increasing order.
+// The clock is read before each tile of rows: once omp_get_wtime() passes deadline ( 0: never ), the remaining
+// tiles are skipped and the function returns false (upper is then incomplete).
+bool l1_upper_neighbors( const double* data, size_t elements_num, size_t features_num, const double* weights,
+                         double eps, int num_threads, double deadline, std::vector< std::vector< uint32_t > >& upper );
+
+// Feature-major copy of a row-major elements_num x features_num array: feature k of point j is at k * elements_num + j
+void to_feature_major( const double* data, size_t elements_num, size_t features_num, std::vector< double >& soa );
+
+// Distances from the point u to the points j0..j1-1 of the feature-major array soa of elements_num points,
+// in dist[0..j1-j0), with the SIMD kernel
+void l1_distances( const double* u, const double* soa, size_t elements_num, size_t features_num,
+                   const double* weights, size_t j0, size_t j1, double* dist );
+
+// Name of the distance kernel selected for this CPU ("avx512", "avx2" or "scalar")
+const char* l1_kernel_name();
+}
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef DBSCAN_UNION_FIND_H
+#define DBSCAN_UNION_FIND_H
+
+#include <atomic>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+namespace clustering {
+// Disjoint sets over 0..n-1 with path halving. The root of a set is its smallest element,
+// which is what the canonical DBSCAN labelling (clusters ordered by their first core point) needs.
+class UnionFind {
+public:
+    explicit UnionFind( size_t n )
+        : m_parent( n )
+    {
+        for ( uint32_t i = 0; i < n; ++i ) {
+            m_parent[i] = i;
+        }
+    }
+
+    uint32_t find( uint32_t x )
+    {
+        while ( m_parent[x] != x ) {
+            m_parent[x] = m_parent[m_parent[x]];
+            x = m_parent[x];
+        }
+        return x;
+    }
+
+    // returns true if a and b were in different sets
+    bool unite( uint32_t a, uint32_t b )
+    {
+        a = find( a );
+        b = find( b );
+
+        if ( a == b ) {
+            return false;
+        }
+        if ( a < b ) {
+            m_parent[b] = a;
+        } else {
+            m_parent[a] = b;
+        }
+        return true;
+    }
+
+private:
+    std::vector< uint32_t > m_parent;
+};
+
+// Lock-free version for concurrent unions: a root is only ever linked below a smaller root, with a
+// compare-and-swap, so the sets never form cycles and the root of a set is still its smallest element.
+class ConcurrentUnionFind {
+public:
+    explicit ConcurrentUnionFind( size_t n )
+        : m_parent( n )
+    {
+        for ( uint32_t i = 0; i < n; ++i ) {
+            m_parent[i].store( i, std::memory_order_relaxed );
+        }
+    }
+
+    uint32_t find( uint32_t x )
+    {
+        uint32_t p = m_parent[x].load();
+
+        while ( p != x ) {
+            const uint32_t gp = m_parent[p].load();
+
+            // path halving; losing the race only means the path is not shortened
+            if ( gp != p ) {
+                m_parent[x].compare_exchange_weak( p, gp );
+            }
+            x = gp;
+            p = m_parent[x].load();
+        }
+        return x;
+    }
+
+    void unite( uint32_t a, uint32_t b )
+    {
+        while ( true ) {
+            a = find( a );
+            b = find( b );
+
+            if ( a == b ) {
+                return;
+            }
+            if ( a < b ) {
+                std::swap( a, b );
+            }
+
+            uint32_t expected = a;
+            if ( m_parent[a].compare_exchange_strong( expected, b ) ) {
+                return;
+            }
+        }
+    }
+
+private:
+    std::vector< std::atomic< uint32_t > > m_parent;
+};
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef WALKSCAN_BINARY_COMMUNITIES_H
+#define WALKSCAN_BINARY_COMMUNITIES_H
+
+#include "../include/utils.h"
+
+// Binary community file (-communities.bin), indexed by seed set number. Little-endian, 8-byte aligned sections:
+//   header          BinaryCommunityHeader (32 bytes)
+//   offsets         uint64_t[nbCommunities + 1], community i is nodes[offsets[i]] to nodes[offsets[i + 1] - 1]
+//   nodes           uint32_t[nbNodes], increasing within a community, padded with zeros to a multiple of 8 bytes
+//   scores          double[nbCommunities], if flags has BINARY_COMMUNITIES_SCORES
+// The file is mapped as is by BinaryCommunities: the community of a seed set is found without reading the others
+// (only the offsets are checked when the file is opened). The files are written in host byte order, and the build
+// fails on big-endian hosts.
+
+#define BINARY_COMMUNITIES_MAGIC "WSCOMMS"
+#define BINARY_COMMUNITIES_VERSION 1
+#define BINARY_COMMUNITIES_SCORES 1
+
+struct BinaryCommunityHeader {
+    char magic[8];              // BINARY_COMMUNITIES_MAGIC
+    uint32_t version;           // BINARY_COMMUNITIES_VERSION
+    uint32_t flags;             // BINARY_COMMUNITIES_SCORES
+    uint64_t nbCommunities;
+    uint64_t nbNodes;           // Total size of the communities
+};
+
+// Writes the communities, with one score per community if scores is not NULL. Returns 1 if the write failed.
+int PrintBinaryPartition(const char* fileName, std::vector< NodeSet >& communities, const std::vector< double >* scores);
+// Whether the file starts with BINARY_COMMUNITIES_MAGIC
+bool IsBinaryCommunityFile(const char* fileName);
+
+// Read-only mapping of a binary community file
+class BinaryCommunities {
+public:
+    BinaryCommunities();
+    ~BinaryCommunities();
+    // Maps the file and checks its header and size, false (with a message) if it is not a valid community file
+    bool Open(const char* fileName);
+    void Close();
+
+    uint64_t GetNbCommunities() const { return header->nbCommunities; }
+    uint64_t GetNbNodes() const { return header->nbNodes; }
+    uint64_t GetSize(uint64_t index) const { return offsets[index + 1] - offsets[index]; }
+    const uint32_t* GetNodes(uint64_t index) const { return nodes + offsets[index]; }
+    bool HasScores() const { return scores != NULL; }
+    double GetScore(uint64_t index) const { return scores[index]; }
+    NodeSet GetCommunity(uint64_t index) const { return NodeSet(GetNodes(index), GetNodes(index) + GetSize(index)); }
+
+private:
+    BinaryCommunities(const BinaryCommunities&);
+    BinaryCommunities& operator=(const BinaryCommunities&);
+
+    void* data;
+    size_t dataSize;
+    const BinaryCommunityHeader* header;
+    const uint64_t* offsets;
+    const uint32_t* nodes;
+    const double* scores;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef WALKSCAN_BUDGET_H
+#define WALKSCAN_BUDGET_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <omp.h>
+
+// Limits on the work of one seed set, so that a seed set whose walk explodes cannot stall a batch
+struct QueryBudget {
+    uint32_t maxFrontierSize;   // Largest walk support, in nodes (0: no limit)
+    uint64_t maxPushedEdges;    // Largest number of edges traversed by the random walk (0: no limit)
+    double timeLimit;           // Seconds per seed set, from the start of its walk (0: no limit)
+    QueryBudget() : maxFrontierSize(0), maxPushedEdges(0), timeLimit(0.0) {}
+    bool IsLimited() const { return maxFrontierSize > 0 || maxPushedEdges > 0 || timeLimit > 0.0; }
+};
+
+// Work of one seed set against its budget. The random walks, the sweeps and DBSCAN check it in their loops and,
+// when it is exhausted, stop and return the result of the work done so far: the ranking or the embedding of the
+// last complete step, the best prefix swept so far, or no cluster. The seed set is then marked as truncated.
+// DBSCAN reads the clock in the neighbour searches of the engines that a budgeted seed set can use (tiled, quantized,
+// k-d tree, grid, streaming and rho-approximate), per point or per tile of 64 rows; the parallel engine and the
+// epsilon sweep, which run without a budget, do not check it.
+class QueryBudgetTracker {
+public:
+    explicit QueryBudgetTracker(const QueryBudget& budget)
+        : budget(budget),
+          deadline(budget.timeLimit > 0.0 ? omp_get_wtime() + budget.timeLimit : 0.0),
+          nbPushedEdges(0),
+          nbChecks(0),
+          expired(false),
+          truncated(false) {}
+
+    // Called by the walks before traversing the nbEdges edges of a node, frontierSize being the size of the
+    // support of the next step so far. Returns false if the step must be abandoned.
+    bool ChargeWalk(size_t frontierSize, uint64_t nbEdges) {
+        nbPushedEdges += nbEdges;
+        if ((budget.maxFrontierSize > 0 && frontierSize > budget.maxFrontierSize)
+            || (budget.maxPushedEdges > 0 && nbPushedEdges > budget.maxPushedEdges)) {
+            truncated = true;
+            return false;
+        }
+        return BeforeDeadline();
+    }
+
+    // Returns false once the deadline is passed (the clock is read every 256 calls)
+    bool BeforeDeadline() {
+        if (!expired && deadline > 0.0 && (nbChecks++ & 255) == 0 && omp_get_wtime() > deadline) {
+            expired = true;
+            truncated = true;
+        }
+        return !expired;
+    }
+
+    double GetDeadline() const { return deadline; }
+    void SetTruncated() { truncated = true; }
+    bool IsTruncated() const { return truncated; }
+
+private:
+    const QueryBudget budget;
+    const double deadline;      // omp_get_wtime() value, 0 if none
+    uint64_t nbPushedEdges;
+    uint32_t nbChecks;
+    bool expired;
+    bool truncated;
+};
+
+#endif
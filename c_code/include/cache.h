@@ -0,0 +1,45 @@
+#ifndef WALKSCAN_CACHE_H
+#define WALKSCAN_CACHE_H
+
+#include <list>
+#include <map>
+#include <omp.h>
+#include "../include/types.h"
+
+// Least recently used cache of communities, shared by the threads of the server or of the streaming mode.
+// The key is the sorted seed set with the algorithm and all the parameters that change its community (see
+// BuildCommunityCacheKey); it is hashed for the lookup and compared in full, so a hash collision is a miss.
+// Entries are evicted from the least recently used one to stay within memoryBudget bytes.
+class CommunityCache {
+public:
+    CommunityCache(uint64_t memoryBudget);
+    ~CommunityCache();
+    bool Lookup(const std::vector< uint32_t >& key, NodeSet& community, uint32_t& stopReason);
+    void Insert(const std::vector< uint32_t >& key, const NodeSet& community, uint32_t stopReason);
+    uint64_t GetNbHits();
+    uint64_t GetNbMisses();
+    uint64_t GetNbEntries();
+    uint64_t GetMemoryUsage();
+    void PrintStatistics();
+
+private:
+    struct Entry {
+        uint64_t hash;
+        std::vector< uint32_t > key;
+        std::vector< uint32_t > community;
+        uint32_t stopReason;
+        uint64_t size;
+    };
+    static uint64_t Hash(const std::vector< uint32_t >& key);
+    void Evict(uint64_t targetUsage);
+
+    uint64_t memoryBudget;
+    uint64_t memoryUsage;
+    uint64_t nbHits;
+    uint64_t nbMisses;
+    std::list< Entry > entries;    // from the most recently used
+    std::map< uint64_t, std::list< Entry >::iterator > entryIndex;
+    omp_lock_t lock;
+};
+
+#endif
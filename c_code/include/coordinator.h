@@ -0,0 +1,15 @@
+#ifndef WALKSCAN_COORDINATOR_H
+#define WALKSCAN_COORDINATOR_H
+
+#include "../include/query.h"
+
+int RunCoordinator(const char* seedSetFileName,
+                   const char* outputFileName,
+                   uint32_t algorithmId,
+                   std::vector< NodeSet >& nodeNeighbors,
+                   uint32_t maxNodeId,
+                   const QuerySettings& settings,
+                   uint32_t nbWorkers,
+                   uint32_t rangeSize);
+
+#endif
@@ -9,12 +9,29 @@
 #include <stdint.h>
 #include "../include/utils.h"
 #include "../include/scores.h"
+#include "../include/sweep.h"
+#include "../include/walk_buffers.h"
 
 int LexRank(std::vector< NodeSet >& nodeNeighbors,
             std::vector< NodeSet >& seedSets,
             uint32_t nbSteps,
             std::vector< std::vector< NodeLexRank > >& lexRankResult,
             uint32_t maxNodeId);
+uint32_t LexRankMinConductanceSeedSet(std::vector< NodeSet >& nodeNeighbors,
+                                      NodeSet& seedSet,
+                                      uint32_t nbSteps,
+                                      NodeSet& community,
+                                      WalkBuffers& walkBuffers,
+                                      const SweepLimits& limits,
+                                      uint64_t graphVolume,
+                                      QueryBudgetTracker* budgetTracker = NULL);
+int LexRankMinConductancePipeline(std::vector< NodeSet >& nodeNeighbors,
+                                  std::vector< NodeSet >& seedSets,
+                                  uint32_t nbSteps,
+                                  std::vector< NodeSet >& communities,
+                                  uint32_t maxNodeId,
+                                  const SweepLimits& limits,
+                                  std::vector< uint32_t >& stopReasons);
 bool nodeLexRankCompare(const NodeLexRank& node1, const NodeLexRank& node2);
 int LexRankMaxF1(std::vector< std::vector< NodeLexRank > >& lexRankResult,
                  std::vector< NodeSet >& groundTruthCommunities,
@@ -27,9 +44,17 @@ int LexRankMinConductance(std::vector< NodeSet >& nodeNeighbors,
                           std::vector< NodeSet >& seedSets,
                           std::vector< NodeSet >& communities,
                           std::vector< double >& f1Scores);
+int LexRankAllObjectives(std::vector< NodeSet >& nodeNeighbors,
+                         std::vector< std::vector< NodeLexRank > >& lexRankResult,
+                         std::vector< NodeSet >& groundTruthCommunities,
+                         std::vector< NodeSet >& seedSets,
+                         std::vector< std::vector< NodeSet > >& communities,
+                         std::vector< std::vector< double > >& f1Scores);
 int LexRankMinConductanceNoF1(std::vector< NodeSet >& nodeNeighbors,
                               std::vector< std::vector< NodeLexRank > >& lexRankResult,
                               std::vector< NodeSet >& seedSets,
-                              std::vector< NodeSet >& communities);
+                              std::vector< NodeSet >& communities,
+                              const SweepLimits& limits,
+                              std::vector< uint32_t >& stopReasons);
 
 #endif
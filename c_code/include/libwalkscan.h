@@ -0,0 +1,127 @@
+#ifndef WALKSCAN_LIBWALKSCAN_H
+#define WALKSCAN_LIBWALKSCAN_H
+
+// C API of the walkscan library (libwalkscan.so / libwalkscan.a). A graph is loaded once into an engine, then
+// PageRank, LexRank and WalkScan communities are queried against it, one seed set or a batch at a time. The results
+// are written in buffers owned by the caller, and the library keeps no global state: engines are independent, and
+// the queries of one engine can run concurrently from several threads (the engine is only read).
+//
+// Node sets (seed sets and communities) are given in CSR form: the nodes of set i are nodes[offsets[i]] to
+// nodes[offsets[i + 1] - 1]. The nodes of a community are in increasing order.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum walkscan_algorithm {
+    WALKSCAN_PAGERANK = 0,
+    WALKSCAN_LEXRANK = 1,
+    WALKSCAN_WALKSCAN = 2
+};
+
+enum walkscan_status {
+    WALKSCAN_OK = 0,
+    WALKSCAN_ERROR_INVALID_ARGUMENT = 1,    // NULL engine or buffer, unknown algorithm, empty seed set
+    WALKSCAN_ERROR_INVALID_NODE = 2,        // seed node not in the graph
+    WALKSCAN_ERROR_BUFFER_TOO_SMALL = 3,    // the sizes are set, call again with a larger buffer
+    WALKSCAN_ERROR_INTERNAL = 4             // the query failed (out of memory), the outputs are undefined
+};
+
+// Parameters of the queries, those of the walkscan command line (see walkscan_default_settings)
+typedef struct walkscan_settings {
+    uint32_t nb_steps;              // -t
+    double epsilon;                 // --epsilon (WalkScan)
+    uint32_t min_elems;             // --min-elems (WalkScan)
+    double max_volume_ratio;        // --max-volume (PageRank, LexRank)
+    uint32_t patience;              // --patience (PageRank, LexRank)
+    uint32_t max_frontier_size;     // --max-frontier (0: no limit)
+    uint64_t max_pushed_edges;      // --max-edges (0: no limit)
+    double time_limit;              // --deadline, in seconds (0: no limit)
+    double rho;                     // --rho (WalkScan)
+    int quantized;                  // --quantize (WalkScan)
+    uint64_t dbscan_memory_budget;  // --dbscan-memory, in bytes (WalkScan, 0: no limit)
+    uint32_t nb_threads;            // threads of a batch (0: all); each seed set, batched or not, runs on one thread
+} walkscan_settings;
+
+typedef struct walkscan_engine walkscan_engine;
+
+void walkscan_default_settings(walkscan_settings* settings);
+
+// Engines, NULL on failure (invalid arguments or out of memory). The graph is undirected: each edge (u, v) is also
+// an edge (v, u).
+// From a file of the -i flag (tab-separated list of edges)
+walkscan_engine* walkscan_engine_load(const char* graph_file_name);
+// From nb_edges edges (sources[i], targets[i])
+walkscan_engine* walkscan_engine_from_edges(const uint32_t* sources, const uint32_t* targets, uint64_t nb_edges);
+// From an adjacency list in CSR form: the neighbors of node u are neighbors[offsets[u]] to neighbors[offsets[u + 1] - 1].
+// offsets has nb_nodes + 1 entries: offsets[0] must be 0, the offsets must not decrease and offsets[nb_nodes] must
+// be at most nb_neighbors, the size of neighbors (whose entries must be below nb_nodes).
+walkscan_engine* walkscan_engine_from_csr(uint32_t nb_nodes,
+                                          const uint64_t* offsets,
+                                          const uint32_t* neighbors,
+                                          uint64_t nb_neighbors);
+void walkscan_engine_free(walkscan_engine* engine);
+uint32_t walkscan_engine_nb_nodes(const walkscan_engine* engine);
+uint64_t walkscan_engine_nb_edges(const walkscan_engine* engine);
+
+// Community of one seed set, on the calling thread only (settings->nb_threads is not used). The community
+// has *community_size nodes, written in community if it has room for them (capacity nodes), otherwise the call
+// returns WALKSCAN_ERROR_BUFFER_TOO_SMALL. stop_reason (PageRank and LexRank, may be NULL) is the reason why the
+// conductance sweep stopped, truncated (may be NULL) is 1 if the budget of the seed set was exhausted.
+int walkscan_query(const walkscan_engine* engine,
+                   int algorithm,
+                   const walkscan_settings* settings,
+                   const uint32_t* seeds,
+                   size_t nb_seeds,
+                   uint32_t* community,
+                   size_t capacity,
+                   size_t* community_size,
+                   uint32_t* stop_reason,
+                   uint8_t* truncated);
+
+// All the WalkScan communities of one seed set, ordered by decreasing center (the first one is that of walkscan_query,
+// before the seeds are added to it). The nodes of community i are nodes[cluster_offsets[i]] to
+// nodes[cluster_offsets[i + 1] - 1], cluster_offsets having room for max_clusters + 1 entries. *nb_clusters and
+// *nb_nodes are the number of communities and their total size; if they exceed max_clusters or capacity, the call
+// returns WALKSCAN_ERROR_BUFFER_TOO_SMALL. truncated (may be NULL) is 1 if the budget of the seed set was exhausted.
+// As walkscan_query, it runs on the calling thread only.
+int walkscan_query_clusters(const walkscan_engine* engine,
+                            const walkscan_settings* settings,
+                            const uint32_t* seeds,
+                            size_t nb_seeds,
+                            uint64_t* cluster_offsets,
+                            size_t max_clusters,
+                            size_t* nb_clusters,
+                            uint32_t* nodes,
+                            size_t capacity,
+                            size_t* nb_nodes,
+                            uint8_t* truncated);
+
+// Communities of nb_seed_sets seed sets (seed_offsets has nb_seed_sets + 1 entries), processed in parallel on
+// settings->nb_threads threads, the most expensive ones first. community_offsets (nb_seed_sets + 1 entries) is always
+// filled; if the communities do not fit in community_nodes (capacity nodes), the call returns
+// WALKSCAN_ERROR_BUFFER_TOO_SMALL and community_offsets[nb_seed_sets] is the capacity needed. stop_reasons and
+// truncated (nb_seed_sets entries each) may be NULL.
+int walkscan_query_batch(const walkscan_engine* engine,
+                         int algorithm,
+                         const walkscan_settings* settings,
+                         const uint64_t* seed_offsets,
+                         const uint32_t* seed_nodes,
+                         size_t nb_seed_sets,
+                         uint64_t* community_offsets,
+                         uint32_t* community_nodes,
+                         size_t capacity,
+                         uint32_t* stop_reasons,
+                         uint8_t* truncated);
+
+// Name of a stop reason of the conductance sweep, as in the -stop-reasons.txt files
+const char* walkscan_stop_reason_name(uint32_t stop_reason);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef WALKSCAN_METRICS_H
+#define WALKSCAN_METRICS_H
+
+#include "../include/utils.h"
+
+// Quality metrics of a community S
+struct CommunityMetrics {
+    uint32_t size;              // |S|
+    uint64_t volume;            // Sum of the degrees of the nodes of S
+    uint64_t cut;               // Number of edges between S and the rest of the graph
+    uint64_t internalEdges;     // Number of edges inside S
+    double conductance;         // cut / min(volume, graph volume - volume)
+    double density;             // internalEdges / (|S| (|S| - 1) / 2)
+};
+
+int ComputeCommunityMetrics(std::vector< NodeSet >& nodeNeighbors,
+                            std::vector< NodeSet >& communities,
+                            std::vector< CommunityMetrics >& metrics);
+int PrintCommunityMetrics(const char* fileName, std::vector< CommunityMetrics >& metrics);
+
+#endif
@@ -9,11 +9,28 @@
 #include <stdint.h>
 #include "../include/utils.h"
 #include "../include/scores.h"
+#include "../include/sweep.h"
+#include "../include/walk_buffers.h"
 
 int PageRank(std::vector< NodeSet >& nodeNeighbors, std::vector< NodeSet >& seeds,
              uint32_t nbSteps, double alpha,
              std::vector< std::vector< NodePageRank > >& pageRankResult,
              uint32_t maxNodeId);
+uint32_t PageRankMinConductanceSeedSet(std::vector< NodeSet >& nodeNeighbors,
+                                       NodeSet& seedSet,
+                                       uint32_t nbSteps, double alpha,
+                                       NodeSet& community,
+                                       WalkBuffers& walkBuffers,
+                                       const SweepLimits& limits,
+                                       uint64_t graphVolume,
+                                       QueryBudgetTracker* budgetTracker = NULL);
+int PageRankMinConductancePipeline(std::vector< NodeSet >& nodeNeighbors,
+                                   std::vector< NodeSet >& seedSets,
+                                   uint32_t nbSteps, double alpha,
+                                   std::vector< NodeSet >& communities,
+                                   uint32_t maxNodeId,
+                                   const SweepLimits& limits,
+                                   std::vector< uint32_t >& stopReasons);
 bool nodePageRankCompare(const NodePageRank& node1, const NodePageRank& node2);
 int PageRankMaxF1(std::vector< std::vector< NodePageRank > >& pageRankResult,
                   std::vector< NodeSet >& groundTruthCommunities,
@@ -37,8 +54,16 @@ int PageRankMinConductance(std::vector< NodeSet >& nodeNeighbors,
                            std::vector< NodeSet >& seeds,
                            std::vector< NodeSet >& communities,
                            std::vector< double >& f1Scores);
+int PageRankAllObjectives(std::vector< NodeSet >& nodeNeighbors,
+                          std::vector< std::vector< NodePageRank > >& pageRankResult,
+                          std::vector< NodeSet >& groundTruthCommunities,
+                          std::vector< NodeSet >& seedSets,
+                          std::vector< std::vector< NodeSet > >& communities,
+                          std::vector< std::vector< double > >& f1Scores);
 int PageRankMinConductanceNoF1(std::vector< NodeSet >& nodeNeighbors,
-                               std::vector <std::vector< NodePageRank > >& pageRankResult,
-                               std::vector< NodeSet >& seeds,
-                               std::vector< NodeSet >& communities);
+                               std::vector< std::vector< NodePageRank > >& pageRankResult,
+                               std::vector< NodeSet >& seedSets,
+                               std::vector< NodeSet >& communities,
+                               const SweepLimits& limits,
+                               std::vector< uint32_t >& stopReasons);
 #endif
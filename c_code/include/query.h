@@ -0,0 +1,51 @@
+#ifndef WALKSCAN_QUERY_H
+#define WALKSCAN_QUERY_H
+
+#include "../include/utils.h"
+#include "../include/pagerank.h"
+#include "../include/lexrank.h"
+#include "../include/walkscan.h"
+#include "../include/cache.h"
+
+// Parameters of the community of a seed set (those of the walkscan command line)
+struct QuerySettings {
+    uint32_t nbSteps;
+    double epsilon;
+    uint32_t minElems;
+    SweepLimits sweepLimits;
+    DbscanSettings dbscanSettings;
+    QueryBudget budget;
+    QuerySettings() : nbSteps(2), epsilon(0.01), minElems(2) {}
+};
+
+// Buffers of the queries of one thread (walk probabilities and WalkSCAN clusters), reused from one seed set to the
+// next: a query costs O(walk support) in memory, whatever the largest node id of the graph
+struct QueryBuffers {
+    WalkBuffers walk;
+    WalkScanClusterBuffers clusters;
+};
+
+void BuildCommunityCacheKey(uint32_t algorithmId,
+                            const NodeSet& seedSet,
+                            const QuerySettings& settings,
+                            std::vector< uint32_t >& key);
+uint32_t ComputeSeedSetCommunity(uint32_t algorithmId,
+                                 std::vector< NodeSet >& nodeNeighbors,
+                                 NodeSet& seedSet,
+                                 NodeSet& community,
+                                 QueryBuffers& buffers,
+                                 uint64_t graphVolume,
+                                 const QuerySettings& settings,
+                                 CommunityCache* cache = NULL,
+                                 bool* cacheHit = NULL,
+                                 bool* truncated = NULL);
+int ComputeCommunities(uint32_t algorithmId,
+                       std::vector< NodeSet >& nodeNeighbors,
+                       std::vector< NodeSet >& seeds,
+                       std::vector< NodeSet >& communities,
+                       uint32_t maxNodeId,
+                       const QuerySettings& settings,
+                       std::vector< uint32_t >& stopReasons,
+                       std::vector< uint8_t >& truncated);
+
+#endif
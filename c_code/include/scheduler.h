@@ -0,0 +1,48 @@
+#ifndef WALKSCAN_SCHEDULER_H
+#define WALKSCAN_SCHEDULER_H
+
+#include <deque>
+#include <omp.h>
+#include "../include/types.h"
+
+uint64_t EstimateSeedSetCost(std::vector< NodeSet >& nodeNeighbors, const NodeSet& seedSet);
+
+// Schedule of the seed sets of a batch over the threads of an OpenMP parallel region. The cost of each seed set is
+// estimated from cheap graph statistics (EstimateSeedSetCost), and the seed sets are dealt by decreasing cost to
+// per-thread deques, each one to the thread with the least estimated work so far. A thread takes the largest seed
+// set of its own deque and, once it is empty, steals the largest one of the deque with the most remaining work,
+// so that the small seed sets fill the gaps at the end of the batch. Usage:
+//     SeedSetScheduler scheduler(nodeNeighbors, seedSets);
+// #pragma omp parallel
+//     for (uint32_t i; scheduler.Next(i); ) { ... process seedSets[i] ... }
+//     scheduler.PrintUtilization();
+class SeedSetScheduler {
+public:
+    SeedSetScheduler(std::vector< NodeSet >& nodeNeighbors, std::vector< NodeSet >& seedSets);
+    ~SeedSetScheduler();
+    // Next seed set of the calling thread, false when all the seed sets are taken
+    bool Next(uint32_t& seedSetIndex);
+    // Fraction of the time the threads spent processing seed sets, between the first call to Next and the last
+    // thread running out of seed sets
+    double GetUtilization();
+    uint64_t GetNbSteals();
+    void PrintUtilization();
+
+private:
+    struct ThreadQueue {
+        std::deque< uint32_t > seedSets;    // by decreasing cost
+        uint64_t remainingCost;
+        omp_lock_t lock;
+        double taskStart;                   // omp_get_wtime() when the current seed set was taken, 0 if none
+        double busyTime;
+        double endTime;
+    };
+    bool PopFront(ThreadQueue& queue, uint32_t& seedSetIndex);
+
+    std::vector< uint64_t > costs;
+    std::vector< ThreadQueue > queues;
+    uint64_t nbSteals;
+    double startTime;
+};
+
+#endif
@@ -3,10 +3,19 @@
 
 #include "../include/utils.h"
 
-uint32_t ComputeIntersectionSize(NodeSet community1, NodeSet community2);
-double ComputeF1Score(NodeSet community1, NodeSet community2);
+// Objective functions of the sweep algorithm (values of the -f flag of the benchmarks)
+enum SweepObjective {
+    SWEEP_MAX_F1 = 0,
+    SWEEP_RANK_THRESHOLD = 1,
+    SWEEP_CONDUCTANCE = 2,
+    NB_SWEEP_OBJECTIVES = 3
+};
+
+uint32_t ComputeIntersectionSize(const NodeSet& community1, const NodeSet& community2);
+double ComputeF1Score(const NodeSet& community1, const NodeSet& community2);
 double ComputeF1Score(uint32_t sizeCommunity1, uint32_t sizeCommunity2, uint32_t sizeIntersection);
 double ComputeConductance(uint32_t degreeSum, uint32_t internalEdges);
+const char* GetSweepObjectiveName(uint32_t objectiveId);
 int ComputeF1ScorePerSeed(std::vector< NodeSet >& seedSets,
                           std::vector< NodeSet >& groundTruthCommunities,
                           std::vector< NodeSet >& nodeGroundTruthCommunities,
@@ -0,0 +1,13 @@
+#ifndef WALKSCAN_SERVER_H
+#define WALKSCAN_SERVER_H
+
+#include "../include/query.h"
+
+int RunServer(const char* socketPath,
+              std::vector< NodeSet >& nodeNeighbors,
+              uint32_t maxNodeId,
+              const QuerySettings& settings,
+              uint32_t nbWorkers = 0,
+              CommunityCache* cache = NULL);
+
+#endif
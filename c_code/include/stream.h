@@ -0,0 +1,15 @@
+#ifndef WALKSCAN_STREAM_H
+#define WALKSCAN_STREAM_H
+
+#include "../include/query.h"
+
+int RunStream(const char* seedSetFileName,
+              const char* outputFileName,
+              uint32_t algorithmId,
+              std::vector< NodeSet >& nodeNeighbors,
+              uint32_t maxNodeId,
+              const QuerySettings& settings,
+              uint32_t chunkSize,
+              CommunityCache* cache = NULL);
+
+#endif
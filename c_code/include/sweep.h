@@ -0,0 +1,37 @@
+#ifndef WALKSCAN_SWEEP_H
+#define WALKSCAN_SWEEP_H
+
+#include "../include/utils.h"
+#include "../include/scores.h"
+#include "../include/budget.h"
+
+// Stopping rules of the unsupervised conductance sweep
+struct SweepLimits {
+    double maxVolumeRatio;      // Stop when the volume of the community exceeds this fraction of the graph volume
+    uint32_t patience;          // Stop after this number of nodes without improvement (0: no limit)
+    bool useConductanceBound;   // Stop when the remaining volume cannot bring the conductance below the best one
+    SweepLimits() : maxVolumeRatio(1.0), patience(0), useConductanceBound(true) {}
+};
+
+enum SweepStopReason {
+    STOP_END_OF_RANKING = 0,
+    STOP_VOLUME_CAP = 1,
+    STOP_PATIENCE = 2,
+    STOP_CONDUCTANCE_BOUND = 3,
+    STOP_DEADLINE = 4,
+    NB_STOP_REASONS = 5
+};
+
+uint64_t ComputeGraphVolume(std::vector< NodeSet >& nodeNeighbors);
+uint32_t MinConductanceSweep(std::vector< NodeSet >& nodeNeighbors,
+                             const NodeSet& seedSet,
+                             const std::vector< uint32_t >& rankedNodes,
+                             const SweepLimits& limits,
+                             uint64_t graphVolume,
+                             NodeSet& bestCommunity,
+                             QueryBudgetTracker* budgetTracker = NULL);
+const char* GetSweepStopReasonName(uint32_t stopReason);
+void PrintStopReasonSummary(std::vector< uint32_t >& stopReasons);
+int PrintStopReasons(const char* fileName, std::vector< uint32_t >& stopReasons);
+
+#endif
@@ -2,6 +2,9 @@
 #define TYPES_H
 
 #include <set>
+#include <array>
+#include <vector>
+#include <stdint.h>
 
 typedef std::set< uint32_t > NodeSet;
 typedef std::pair< uint32_t, uint32_t > Edge;
@@ -9,4 +12,21 @@ typedef std::pair< uint32_t, double > NodePageRank;
 typedef std::pair< uint32_t, std::vector< double > > NodeLexRank;
 typedef std::pair< NodeSet, std::vector< double > > NodeSetLexRank;
 
+// Embedding of a node by its walk probabilities at steps 1..t.
+// For the common walk lengths, t is a template parameter and the embedding is a std::array,
+// so that comparisons and loops over t are unrolled. NbSteps = 0 is the generic (runtime t) case.
+template < uint32_t NbSteps >
+struct WalkEmbedding {
+    typedef std::array< double, NbSteps > Type;
+    static uint32_t Size(uint32_t nbSteps) { return NbSteps; }
+    static Type Create(uint32_t nbSteps) { Type embedding; embedding.fill(0.0); return embedding; }
+};
+
+template <>
+struct WalkEmbedding< 0 > {
+    typedef std::vector< double > Type;
+    static uint32_t Size(uint32_t nbSteps) { return nbSteps; }
+    static Type Create(uint32_t nbSteps) { return Type(nbSteps); }
+};
+
 #endif
@@ -18,6 +18,7 @@
 #include <cstdlib>
 #include <string.h>
 #include "../include/types.h"
+#include "../include/writer.h"
 
 #define CHECK_ARGUMENT_STRING(index, option,variable,setVariable) \
     if( strcmp(argv[index],option) == 0 ){ \
@@ -63,6 +64,8 @@ void DisplayProgress(double progress, uint32_t barWidth);
 int LoadGraph(char * graphFileName, std::vector< Edge >& edgeList, uint32_t& maxNodeId);
 int BuildNeighborhoods(std::vector< Edge >& edgeList, std::vector< NodeSet >& nodeNeighbors);
 int LoadCommunity(char * communityFileName, std::vector< NodeSet >& communities, std::vector< NodeSet >& nodeCommunities);
+uint32_t ReadSeedSets(std::istream& inStream, std::vector< NodeSet >& seeds, uint32_t maxNbSeedSets);
+uint32_t DeduplicateSeedSets(std::vector< NodeSet >& seeds, std::vector< uint32_t >& seedSetIndex);
 int PickRandomSeedsInGroundTruth(std::vector< NodeSet >& communities, std::vector< NodeSet >& seeds, double proportion);
 int PickRandomSeedsNearGroundTruth(std::vector< NodeSet >& nodeNeighbors, std::vector< NodeSet >& communities, std::vector< NodeSet >& seeds,
                                    double proportion, uint32_t distanceToGroundTruth);
@@ -70,8 +73,10 @@ int PickRandomSeeds(uint32_t maxNodeId, std::vector< NodeSet >& nodeNeighbors, s
                     uint32_t numSeeds, uint32_t numSimulations);
 int BuildCommunities(uint32_t * nodeCommunity, std::map< uint32_t, NodeSet >& communities, uint32_t maxNodeId);
 double GetAverage(std::vector< double >& vector);
+int WriteCommunity(std::ostream& outStream, const NodeSet& community);
 int PrintPartition(const char* fileName, std::vector< NodeSet >& communities);
 int PrintVector(const char* fileName, std::vector< double >& vector);
+int PrintTruncatedFlags(const char* fileName, std::vector< uint8_t >& truncated);
 void PrintSet(NodeSet set);
 void PrintPageRank(std::vector< double > pageRank, NodeSet support);
 
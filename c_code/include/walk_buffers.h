@@ -0,0 +1,46 @@
+#ifndef WALKSCAN_WALK_BUFFERS_H
+#define WALKSCAN_WALK_BUFFERS_H
+
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+
+// Probabilities of the random walk of a seed set, stored for the nodes of its walk support only: each node gets a
+// local index when the walk first reaches it (the seed nodes first, so the seeds are the indices below the seed set
+// size), and the walk keeps nbVectors probability vectors by local index (one per step, or the current and next
+// ones). One per thread, reused from one seed set to the next: a walk costs O(nbVectors x walk support) in time and
+// memory, whatever the largest node id of the graph.
+class WalkBuffers {
+public:
+    WalkBuffers() : nbVectors(0) {}
+
+    // Starts the walk of a new seed set with nbVectors vectors, keeping the allocated memory
+    void Reset(uint32_t nbVectors) {
+        this->nbVectors = nbVectors;
+        localIndices.clear();
+        probas.clear();
+    }
+    // Local index of node, with probabilities 0 if the walk had not reached it yet
+    uint32_t GetIndex(uint32_t node) {
+        std::pair< std::unordered_map< uint32_t, uint32_t >::iterator, bool > inserted =
+            localIndices.insert(std::make_pair(node, (uint32_t) localIndices.size()));
+        if (inserted.second) {
+            probas.resize(probas.size() + nbVectors, 0.0);
+        }
+        return inserted.first->second;
+    }
+    double& Proba(uint32_t vector, uint32_t index) { return probas[index * nbVectors + vector]; }
+    // Sets a vector to 0 over the walk support
+    void Clear(uint32_t vector) {
+        for (size_t i = vector; i < probas.size(); i += nbVectors) {
+            probas[i] = 0.0;
+        }
+    }
+
+private:
+    uint32_t nbVectors;
+    std::unordered_map< uint32_t, uint32_t > localIndices;
+    std::vector< double > probas;   // vector v of node index i at probas[i * nbVectors + v]
+};
+
+#endif
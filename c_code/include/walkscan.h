@@ -11,6 +11,31 @@
 #include <dbscan.h>
 #include "../include/utils.h"
 #include "../include/scores.h"
+#include "../include/budget.h"
+#include "../include/walk_buffers.h"
+
+// Choice of the DBSCAN engine of WalkSCAN
+struct DbscanSettings {
+    uint64_t memoryBudget;      // If positive, distances are recomputed block by block within this many bytes
+                                // instead of keeping the eps-neighbor lists in memory
+    double rho;                 // If positive, rho-approximate DBSCAN with this tolerance
+    bool quantized;             // If true, distances are computed on the embedding rounded to 16-bit fixed point
+    uint32_t nbThreads;         // Threads of the parallel engine (0: all, 1: sequential engines only)
+    uint32_t parallelMinSize;   // The parallel engine is used from this number of embedded nodes
+    DbscanSettings() : memoryBudget(0), rho(0.0), quantized(false), nbThreads(0), parallelMinSize(20000) {}
+};
+
+// Buffers of the clustering of the seed sets, reused from one seed set to the next (one per thread),
+// so that building the clusters costs O(walk support) and no graph-sized allocation.
+struct WalkScanClusterBuffers {
+    std::vector< std::pair< uint32_t, uint32_t > > nodeIndices; // (node, index in nodeList) of the embedded nodes, by node
+    std::vector< int32_t > attachments;                         // clusters of each outlier followed by -1, in node order
+    std::vector< uint32_t > lastOutlier;                        // last outlier attached to each cluster, plus one
+    std::vector< uint32_t > clusterOffsets;                     // cluster c is clusterNodes[clusterOffsets[c]..clusterOffsets[c + 1])
+    std::vector< uint32_t > clusterNodes;                       // indices in nodeList, by node
+    std::vector< double > centers;                              // center of cluster c at centers[c * steps..]
+    std::vector< uint32_t > clusterOrder;
+};
 
 int WalkScan(std::vector< NodeSet >& nodeNeighbors,
              std::vector< NodeSet >& groundTruthCommunities,
@@ -20,7 +45,26 @@ int WalkScan(std::vector< NodeSet >& nodeNeighbors,
              uint32_t maxNodeId,
              double epsilon,
              uint32_t minElems,
-             bool useSizeLimit = true);
+             bool useSizeLimit = true,
+             const DbscanSettings& dbscanSettings = DbscanSettings());
+int WalkScanEpsilonSweep(std::vector< NodeSet >& nodeNeighbors,
+                         std::vector< NodeSet >& groundTruthCommunities,
+                         std::vector< NodeSet >& seeds,
+                         uint32_t nbSteps,
+                         std::vector< std::vector< std::vector< NodeSet > > >& walkScanResults,
+                         uint32_t maxNodeId,
+                         const std::vector< double >& epsilons,
+                         uint32_t minElems,
+                         bool useSizeLimit = true);
+int WalkScanQuantizedLabelAgreement(std::vector< NodeSet >& nodeNeighbors,
+                                    std::vector< NodeSet >& groundTruthCommunities,
+                                    std::vector< NodeSet >& seeds,
+                                    uint32_t nbSteps,
+                                    std::vector< double >& labelAgreement,
+                                    uint32_t maxNodeId,
+                                    double epsilon,
+                                    uint32_t minElems,
+                                    bool useSizeLimit = true);
 bool WalkScanCenterCompare(const NodeSetLexRank cluster1, const NodeSetLexRank cluster2);
 int WalkScanMaxF1(std::vector< std::vector< NodeSet > > & walkScanResult,
                   std::vector< NodeSet >& groundTruthCommunities,
@@ -46,9 +90,41 @@ int WalkScanNoGroundTruth(std::vector< NodeSet >& nodeNeighbors,
                           std::vector< std::vector< NodeSet > > & walkScanResult,
                           uint32_t maxNodeId,
                           double epsilon,
-                          uint32_t minElems);
+                          uint32_t minElems,
+                          const DbscanSettings& dbscanSettings = DbscanSettings(),
+                          std::vector< uint64_t >* neighborCountHistogram = NULL);
 int WalkScanFirstCommunity(std::vector< std::vector< NodeSet > > & walkScanResult,
                            std::vector< NodeSet >& seeds,
                            std::vector< NodeSet >& communities);
+int WalkScanCommunitiesSeedSet(std::vector< NodeSet >& nodeNeighbors,
+                               NodeSet& seedSet,
+                               uint32_t nbSteps,
+                               std::vector< NodeSet >& orderedWalkScanSets,
+                               WalkBuffers& walkBuffers,
+                               WalkScanClusterBuffers& clusterBuffers,
+                               double epsilon,
+                               uint32_t minElems,
+                               const DbscanSettings& dbscanSettings = DbscanSettings(),
+                               QueryBudgetTracker* budgetTracker = NULL);
+int WalkScanFirstCommunitySeedSet(std::vector< NodeSet >& nodeNeighbors,
+                                  NodeSet& seedSet,
+                                  uint32_t nbSteps,
+                                  NodeSet& community,
+                                  WalkBuffers& walkBuffers,
+                                  WalkScanClusterBuffers& clusterBuffers,
+                                  double epsilon,
+                                  uint32_t minElems,
+                                  const DbscanSettings& dbscanSettings = DbscanSettings(),
+                                  QueryBudgetTracker* budgetTracker = NULL);
+int WalkScanFirstCommunityPipeline(std::vector< NodeSet >& nodeNeighbors,
+                                   std::vector< NodeSet >& seeds,
+                                   uint32_t nbSteps,
+                                   std::vector< NodeSet >& communities,
+                                   uint32_t maxNodeId,
+                                   double epsilon,
+                                   uint32_t minElems,
+                                   const DbscanSettings& dbscanSettings = DbscanSettings(),
+                                   std::vector< uint64_t >* neighborCountHistogram = NULL);
+int PrintNeighborCountHistogram(const char* fileName, std::vector< uint64_t >& neighborCountHistogram);
 
 #endif
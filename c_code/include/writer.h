@@ -0,0 +1,80 @@
+#ifndef WALKSCAN_WRITER_H
+#define WALKSCAN_WRITER_H
+
+#include <stdio.h>
+#include <string.h>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "../include/types.h"
+
+// Buffered writer of the result files (communities, scores, stop reasons, flags). The text is formatted in a large
+// buffer, integers by hand, and handed to the file when the buffer is full or on Flush. With background, the full
+// buffers are written by a thread of the writer, so that the file writes overlap with the computation (at most
+// maxPendingBuffers buffers wait for it, then the caller waits). A writer is used by one thread at a time.
+class ResultWriter {
+public:
+    ResultWriter();
+    explicit ResultWriter(const char* fileName, bool background = false, size_t bufferSize = 1 << 20);
+    ~ResultWriter();
+    bool Open(const char* fileName, bool background = false, size_t bufferSize = 1 << 20);
+    bool IsOpen() const { return file != NULL; }
+
+    void Write(const char* data, size_t size);
+    void WriteString(const char* text) { Write(text, strlen(text)); }
+    void WriteChar(char c) {
+        Reserve(1);
+        buffer[used++] = c;
+    }
+    void WriteUInt(uint64_t value) {
+        Reserve(20);
+        char digits[20];
+        uint32_t nbDigits = 0;
+        do {
+            digits[nbDigits++] = '0' + (value % 10);
+            value /= 10;
+        } while (value > 0);
+        while (nbDigits > 0) {
+            buffer[used++] = digits[--nbDigits];
+        }
+    }
+    // As std::ostream << value (6 significant digits)
+    void WriteDouble(double value);
+    // Nodes separated by spaces, then the end of the line (as the -communities.txt files)
+    void WriteCommunity(const NodeSet& community);
+
+    // Hands the buffered text to the file (to the thread with background, without waiting for the write)
+    void Flush();
+    // Writes everything and closes the file. Returns 1 if the file could not be opened or a write failed, 0 otherwise.
+    int Close();
+
+private:
+    static const size_t maxPendingBuffers = 4;
+
+    void Reserve(size_t size) {
+        if (used + size > buffer.size()) {
+            Submit(false);
+            if (size > buffer.size()) {
+                buffer.resize(size);
+            }
+        }
+    }
+    void Submit(bool flush);
+    void WriterLoop();
+
+    FILE* file;
+    std::vector< char > buffer;
+    size_t bufferSize;
+    size_t used;
+    bool failed;
+    bool background;
+    std::thread writerThread;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque< std::pair< std::vector< char >, bool > > pendingBuffers;    // bytes to write, and whether to flush
+    std::vector< std::vector< char > > freeBuffers;
+    bool closing;
+};
+
+#endif
@@ -14,6 +14,43 @@ static void PrintBenchmarkUsage() {
     printf("\t\t0: Max-F1\n");
     printf("\t\t1: Rank Threshold\n");
     printf("\t\t2: Conductance\n");
+    printf("\t\t3: All objectives in a single sweep (one output file per objective)\n");
+    printf("\t--epsilon-list [epsilon,epsilon,...] : WalkScan only. Computes the average F1 scores for each value of epsilon from a single run and writes them in a -epsilon-report.txt file.\n");
+    printf("\t--rho [tolerance] : WalkScan only. Also runs rho-approximate DBSCAN and reports the F1 scores of both in a -rho-report.txt file.\n");
+    printf("\t--quantize : WalkScan only. Also runs DBSCAN on the 16-bit quantized embedding and reports the label agreement and the F1 scores of both in a -quantize-report.txt file.\n");
+}
+
+// Average F1 scores of the four WalkScan variants of the benchmark: Max-F1, Max-F1 among the top 1 and top 2
+// communities, and Max-F1 with 2 communities
+static const uint32_t NB_WALKSCAN_VARIANTS = 4;
+static const char* walkScanVariantNames[NB_WALKSCAN_VARIANTS] = {"max-f1", "max-f1-top1", "max-f1-top2", "2-max-f1"};
+
+static void ComputeWalkScanAverageF1Scores(std::vector< std::vector< NodeSet > >& walkScanResult,
+                                           std::vector< NodeSet >& groundTruthCommunities,
+                                           std::vector< NodeSet >& seeds,
+                                           std::vector< double >& averageF1Scores) {
+    std::vector< NodeSet > communities(groundTruthCommunities.size());
+    std::vector< double > f1Scores(groundTruthCommunities.size());
+    averageF1Scores.resize(NB_WALKSCAN_VARIANTS);
+    WalkScanMaxF1(walkScanResult, groundTruthCommunities, seeds, communities, f1Scores);
+    averageF1Scores[0] = GetAverage(f1Scores);
+    WalkScanMaxF1(walkScanResult, groundTruthCommunities, seeds, communities, f1Scores, 1);
+    averageF1Scores[1] = GetAverage(f1Scores);
+    WalkScanMaxF1(walkScanResult, groundTruthCommunities, seeds, communities, f1Scores, 2);
+    averageF1Scores[2] = GetAverage(f1Scores);
+    WalkScan2MaxF1(walkScanResult, groundTruthCommunities, seeds, communities, f1Scores);
+    averageF1Scores[3] = GetAverage(f1Scores);
+}
+
+// Comma-separated list of numbers
+static void ParseDoubleList(const char* list, std::vector< double >& values) {
+    std::stringstream stream(list);
+    std::string value;
+    while (std::getline(stream, value, ',')) {
+        if (!value.empty()) {
+            values.push_back(atof(value.c_str()));
+        }
+    }
 }
 
 int RunBenchmark(int argc, char ** argv,
@@ -29,6 +66,10 @@ int RunBenchmark(int argc, char ** argv,
     bool objectiveFunctionIdSet = false;
     bool epsilonSet = false;
     bool minElemsSet = false;
+    bool rhoSet = false;
+    bool quantizeSet = false;
+    bool epsilonListSet = false;
+    char * epsilonList = NULL;
     char * outputFileName = NULL;
     char * seedSetFileName = NULL;
     uint32_t walkLength = 2;
@@ -36,6 +77,7 @@ int RunBenchmark(int argc, char ** argv,
     uint32_t objectiveFunctionId = 0;
     double epsilon = 0.01;
     uint32_t minElems = 2;
+    double rho = 0.0;
 
     for(int i = 1; i < argc; i++) {
         CHECK_ARGUMENT_STRING(i, "-o", outputFileName, outputFileNameSet)
@@ -45,6 +87,9 @@ int RunBenchmark(int argc, char ** argv,
         CHECK_ARGUMENT_INT(i, "-f", objectiveFunctionId, objectiveFunctionIdSet);
         CHECK_ARGUMENT_FLOAT(i, "--epsilon", epsilon, epsilonSet);
         CHECK_ARGUMENT_FLOAT(i, "--min-elems", minElems, minElemsSet);
+        CHECK_ARGUMENT_FLOAT(i, "--rho", rho, rhoSet);
+        CHECK_FLAG(i, "--quantize", quantizeSet);
+        CHECK_ARGUMENT_STRING(i, "--epsilon-list", epsilonList, epsilonListSet)
     }
 
     if (!outputFileNameSet) {
@@ -86,6 +131,9 @@ int RunBenchmark(int argc, char ** argv,
             case 2:
                 printf("Selected objective function: Conductance\n");
                 break;
+            case 3:
+                printf("Selected objective function: All (single sweep)\n");
+                break;
             default:
                 printf("Invalid objective function\n");
                 PrintBenchmarkUsage();
@@ -125,6 +173,8 @@ int RunBenchmark(int argc, char ** argv,
     //=================== ALGORITHM  =======================================
     std::vector< NodeSet > communities(groundTruthCommunities.size());    // Allocating vector for communities
     std::vector< double > f1Scores(groundTruthCommunities.size());    // Allocating vector for f1-scores
+    std::vector< std::vector< NodeSet > > objectiveCommunities;    // Results of the single sweep, by objective function
+    std::vector< std::vector< double > > objectiveF1Scores;
     double averageF1Score;
     switch (algorithmId) {
         // PAGERANK
@@ -152,6 +202,14 @@ int RunBenchmark(int argc, char ** argv,
                     averageF1Score = GetAverage(f1Scores);
                     printf("Average F1 score: %f\n", averageF1Score);
                     break;
+                case 3:
+                    printf("Computing all objectives in a single sweep...\n");
+                    PageRankAllObjectives(nodeNeighbors, pageRankResult, groundTruthCommunities, seeds, objectiveCommunities, objectiveF1Scores);
+                    for (uint32_t objectiveId = 0; objectiveId < NB_SWEEP_OBJECTIVES; objectiveId++) {
+                        averageF1Score = GetAverage(objectiveF1Scores[objectiveId]);
+                        printf("Average F1 score (%s): %f\n", GetSweepObjectiveName(objectiveId), averageF1Score);
+                    }
+                    break;
                 default:
                     printf("Incorrect objective function.\n");
                     PrintBenchmarkUsage();
@@ -178,6 +236,18 @@ int RunBenchmark(int argc, char ** argv,
                     averageF1Score = GetAverage(f1Scores);
                     printf("Average F1 score: %f\n", averageF1Score);
                     break;
+                case 3:
+                    printf("Computing all objectives in a single sweep...\n");
+                    LexRankAllObjectives(nodeNeighbors, lexRankResult, groundTruthCommunities, seeds, objectiveCommunities, objectiveF1Scores);
+                    objectiveCommunities[SWEEP_RANK_THRESHOLD].clear();
+                    objectiveF1Scores[SWEEP_RANK_THRESHOLD].clear();
+                    for (uint32_t objectiveId = 0; objectiveId < NB_SWEEP_OBJECTIVES; objectiveId++) {
+                        if (objectiveId != SWEEP_RANK_THRESHOLD) {
+                            averageF1Score = GetAverage(objectiveF1Scores[objectiveId]);
+                            printf("Average F1 score (%s): %f\n", GetSweepObjectiveName(objectiveId), averageF1Score);
+                        }
+                    }
+                    break;
                 default:
                     printf("Incorrect objective function.\n");
                     PrintBenchmarkUsage();
@@ -198,6 +268,36 @@ int RunBenchmark(int argc, char ** argv,
             } else {
                 printf("Value of min elements (parameter of DBSCAN) unspecified. Default value is used: %i\n", minElems);
             }
+            if (epsilonListSet) {
+                std::vector< double > epsilons;
+                ParseDoubleList(epsilonList, epsilons);
+                std::vector< std::vector< std::vector< NodeSet > > > walkScanResults;
+                printf("Computing WalkScan for %lu values of epsilon...\n", epsilons.size());
+                WalkScanEpsilonSweep(nodeNeighbors, groundTruthCommunities, seeds, walkLength, walkScanResults, maxNodeId, epsilons, minElems);
+                std::string epsilonReportFileName(outputFileName);
+                epsilonReportFileName += "-epsilon-report.txt";
+                printf("Printing the average F1 scores in %s...\n", epsilonReportFileName.c_str());
+                std::ofstream outFile;
+                outFile.open(epsilonReportFileName.c_str());
+                outFile << "epsilon";
+                for (uint32_t variant = 0; variant < NB_WALKSCAN_VARIANTS; variant++) {
+                    outFile << "\t" << walkScanVariantNames[variant];
+                }
+                outFile << std::endl;
+                for (uint32_t e = 0; e < epsilons.size(); e++) {
+                    std::vector< double > averageF1Scores;
+                    ComputeWalkScanAverageF1Scores(walkScanResults[e], groundTruthCommunities, seeds, averageF1Scores);
+                    printf("Epsilon %f: average F1 scores %f (max-f1), %f (top 1), %f (top 2), %f (2 communities)\n", epsilons[e],
+                           averageF1Scores[0], averageF1Scores[1], averageF1Scores[2], averageF1Scores[3]);
+                    outFile << epsilons[e];
+                    for (uint32_t variant = 0; variant < NB_WALKSCAN_VARIANTS; variant++) {
+                        outFile << "\t" << averageF1Scores[variant];
+                    }
+                    outFile << std::endl;
+                }
+                outFile.close();
+                return 0;
+            }
             std::vector <std::vector< NodeSet > > walkScanResult;
 
             printf("Computing WalkScan...\n");
@@ -223,6 +323,71 @@ int RunBenchmark(int argc, char ** argv,
             averageF1Score = GetAverage(f1Scores);
             printf("Average F1 score: %f\n", averageF1Score);
 
+            if (rhoSet && rho > 0.0) {
+                std::vector< double > exactF1Scores;
+                std::vector< double > approximateF1Scores;
+                std::vector <std::vector< NodeSet > > approximateResult;
+                DbscanSettings dbscanSettings;
+                dbscanSettings.rho = rho;
+                printf("Computing WalkScan with rho-approximate DBSCAN (rho = %f)...\n", rho);
+                WalkScan(nodeNeighbors, groundTruthCommunities, seeds, walkLength, approximateResult, maxNodeId, epsilon, minElems, true, dbscanSettings);
+                ComputeWalkScanAverageF1Scores(walkScanResult, groundTruthCommunities, seeds, exactF1Scores);
+                ComputeWalkScanAverageF1Scores(approximateResult, groundTruthCommunities, seeds, approximateF1Scores);
+                std::string rhoReportFileName(outputFileName);
+                rhoReportFileName += "-rho-report.txt";
+                printf("Printing the comparison with exact DBSCAN in %s...\n", rhoReportFileName.c_str());
+                std::ofstream outFile;
+                outFile.open(rhoReportFileName.c_str());
+                outFile << "variant\texact\tapproximate\tdifference" << std::endl;
+                for (uint32_t variant = 0; variant < NB_WALKSCAN_VARIANTS; variant++) {
+                    double difference = approximateF1Scores[variant] - exactF1Scores[variant];
+                    printf("%s: exact %f, approximate %f, difference %f\n", walkScanVariantNames[variant],
+                           exactF1Scores[variant], approximateF1Scores[variant], difference);
+                    outFile << walkScanVariantNames[variant] << "\t" << exactF1Scores[variant] << "\t"
+                            << approximateF1Scores[variant] << "\t" << difference << std::endl;
+                }
+                outFile.close();
+            }
+
+            if (quantizeSet) {
+                std::vector< double > exactF1Scores;
+                std::vector< double > quantizedF1Scores;
+                std::vector< double > labelAgreement;
+                std::vector <std::vector< NodeSet > > quantizedResult;
+                DbscanSettings dbscanSettings;
+                dbscanSettings.quantized = true;
+                printf("Computing WalkScan with DBSCAN on the quantized embedding...\n");
+                WalkScan(nodeNeighbors, groundTruthCommunities, seeds, walkLength, quantizedResult, maxNodeId, epsilon, minElems, true, dbscanSettings);
+                printf("Computing the label agreement with exact DBSCAN...\n");
+                WalkScanQuantizedLabelAgreement(nodeNeighbors, groundTruthCommunities, seeds, walkLength, labelAgreement, maxNodeId, epsilon, minElems);
+                ComputeWalkScanAverageF1Scores(walkScanResult, groundTruthCommunities, seeds, exactF1Scores);
+                ComputeWalkScanAverageF1Scores(quantizedResult, groundTruthCommunities, seeds, quantizedF1Scores);
+                uint32_t nbIdenticalLabelings = 0;
+                for (std::vector< double >::iterator it = labelAgreement.begin(); it != labelAgreement.end(); ++it) {
+                    if (*it == 1.0) {
+                        nbIdenticalLabelings++;
+                    }
+                }
+                std::string quantizeReportFileName(outputFileName);
+                quantizeReportFileName += "-quantize-report.txt";
+                printf("Printing the comparison with exact DBSCAN in %s...\n", quantizeReportFileName.c_str());
+                printf("Label agreement: %f (identical labels for %i seed sets out of %lu)\n", GetAverage(labelAgreement),
+                       nbIdenticalLabelings, labelAgreement.size());
+                std::ofstream outFile;
+                outFile.open(quantizeReportFileName.c_str());
+                outFile << "label_agreement\t" << GetAverage(labelAgreement) << std::endl;
+                outFile << "identical_labelings\t" << nbIdenticalLabelings << "\t" << labelAgreement.size() << std::endl;
+                outFile << "variant\texact\tquantized\tdifference" << std::endl;
+                for (uint32_t variant = 0; variant < NB_WALKSCAN_VARIANTS; variant++) {
+                    double difference = quantizedF1Scores[variant] - exactF1Scores[variant];
+                    printf("%s: exact %f, quantized %f, difference %f\n", walkScanVariantNames[variant],
+                           exactF1Scores[variant], quantizedF1Scores[variant], difference);
+                    outFile << walkScanVariantNames[variant] << "\t" << exactF1Scores[variant] << "\t"
+                            << quantizedF1Scores[variant] << "\t" << difference << std::endl;
+                }
+                outFile.close();
+            }
+
             break;
         }
         default:
@@ -234,6 +399,23 @@ int RunBenchmark(int argc, char ** argv,
 
 
     //======================== PRINT RESULTS ===============================
+    if (!objectiveCommunities.empty()) {
+        for (uint32_t objectiveId = 0; objectiveId < NB_SWEEP_OBJECTIVES; objectiveId++) {
+            if (objectiveCommunities[objectiveId].empty()) {
+                continue;
+            }
+            std::string objectivePrefix(outputFileName);
+            objectivePrefix += "-";
+            objectivePrefix += GetSweepObjectiveName(objectiveId);
+            std::string objectiveCommunityFileName = objectivePrefix + "-communities.txt";
+            std::string objectiveScoreFileName = objectivePrefix + "-f1scores.txt";
+            printf("Printing communities in %s...\n", objectiveCommunityFileName.c_str());
+            PrintPartition(objectiveCommunityFileName.c_str(), objectiveCommunities[objectiveId]);
+            printf("Printing scores in %s...\n", objectiveScoreFileName.c_str());
+            PrintVector(objectiveScoreFileName.c_str(), objectiveF1Scores[objectiveId]);
+        }
+        return 0;
+    }
     std::string communityOutputFileName(outputFileName);
     communityOutputFileName += "-communities.txt";
     std::string scoreOutputFileName(outputFileName);
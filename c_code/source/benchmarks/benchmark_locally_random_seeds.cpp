@@ -15,6 +15,7 @@ static void PrintBenchmarkLocallyRandomSeedsUsage() {
     printf("\t\t0: Max-F1\n");
     printf("\t\t1: Rank Threshold\n");
     printf("\t\t2: Conductance\n");
+    printf("\t\t3: All objectives in a single sweep (one output file per objective)\n");
 }
 
 int RunBenchmarkLocallyRandomSeeds(int argc, char ** argv,
@@ -96,6 +97,9 @@ int RunBenchmarkLocallyRandomSeeds(int argc, char ** argv,
             case 2:
                 printf("Selected objective function: Conductance\n");
                 break;
+            case 3:
+                printf("Selected objective function: All (single sweep)\n");
+                break;
             default:
                 printf("Invalid objective function\n");
                 PrintBenchmarkLocallyRandomSeedsUsage();
@@ -135,6 +139,8 @@ int RunBenchmarkLocallyRandomSeeds(int argc, char ** argv,
     //=================== ALGORITHM  =======================================
     std::vector< NodeSet > communities(groundTruthCommunities.size());    // Allocating vector for communities
     std::vector< double > f1Scores(groundTruthCommunities.size());    // Allocating vector for f1-scores
+    std::vector< std::vector< NodeSet > > objectiveCommunities;    // Results of the single sweep, by objective function
+    std::vector< std::vector< double > > objectiveF1Scores;
     double averageF1Score;
     switch (algorithmId) {
         // PAGERANK
@@ -162,6 +168,14 @@ int RunBenchmarkLocallyRandomSeeds(int argc, char ** argv,
                     averageF1Score = GetAverage(f1Scores);
                     printf("Average F1 score: %f\n", averageF1Score);
                     break;
+                case 3:
+                    printf("Computing all objectives in a single sweep...\n");
+                    PageRankAllObjectives(nodeNeighbors, pageRankResult, groundTruthCommunities, seeds, objectiveCommunities, objectiveF1Scores);
+                    for (uint32_t objectiveId = 0; objectiveId < NB_SWEEP_OBJECTIVES; objectiveId++) {
+                        averageF1Score = GetAverage(objectiveF1Scores[objectiveId]);
+                        printf("Average F1 score (%s): %f\n", GetSweepObjectiveName(objectiveId), averageF1Score);
+                    }
+                    break;
                 default:
                     printf("Incorrect objective function.\n");
                     PrintBenchmarkLocallyRandomSeedsUsage();
@@ -187,6 +201,18 @@ int RunBenchmarkLocallyRandomSeeds(int argc, char ** argv,
                     averageF1Score = GetAverage(f1Scores);
                     printf("Average F1 score: %f\n", averageF1Score);
                     break;
+                case 3:
+                    printf("Computing all objectives in a single sweep...\n");
+                    LexRankAllObjectives(nodeNeighbors, lexRankResult, groundTruthCommunities, seeds, objectiveCommunities, objectiveF1Scores);
+                    objectiveCommunities[SWEEP_RANK_THRESHOLD].clear();
+                    objectiveF1Scores[SWEEP_RANK_THRESHOLD].clear();
+                    for (uint32_t objectiveId = 0; objectiveId < NB_SWEEP_OBJECTIVES; objectiveId++) {
+                        if (objectiveId != SWEEP_RANK_THRESHOLD) {
+                            averageF1Score = GetAverage(objectiveF1Scores[objectiveId]);
+                            printf("Average F1 score (%s): %f\n", GetSweepObjectiveName(objectiveId), averageF1Score);
+                        }
+                    }
+                    break;
                 default:
                     printf("Incorrect objective function.\n");
                     PrintBenchmarkLocallyRandomSeedsUsage();
@@ -229,6 +255,23 @@ int RunBenchmarkLocallyRandomSeeds(int argc, char ** argv,
 
 
     //======================== PRINT RESULTS ===============================
+    if (!objectiveCommunities.empty()) {
+        for (uint32_t objectiveId = 0; objectiveId < NB_SWEEP_OBJECTIVES; objectiveId++) {
+            if (objectiveCommunities[objectiveId].empty()) {
+                continue;
+            }
+            std::string objectivePrefix(outputFileName);
+            objectivePrefix += "-";
+            objectivePrefix += GetSweepObjectiveName(objectiveId);
+            std::string objectiveCommunityFileName = objectivePrefix + "-communities.txt";
+            std::string objectiveScoreFileName = objectivePrefix + "-f1scores.txt";
+            printf("Printing communities in %s...\n", objectiveCommunityFileName.c_str());
+            PrintPartition(objectiveCommunityFileName.c_str(), objectiveCommunities[objectiveId]);
+            printf("Printing scores in %s...\n", objectiveScoreFileName.c_str());
+            PrintVector(objectiveScoreFileName.c_str(), objectiveF1Scores[objectiveId]);
+        }
+        return 0;
+    }
     std::string communityOutputFileName(outputFileName);
     communityOutputFileName += "-communities.txt";
     std::string scoreOutputFileName(outputFileName);
@@ -123,7 +123,8 @@ int RunBenchmarkRandomSeeds(int argc, char ** argv,
             printf("Computing PageRank...\n");
             PageRank(nodeNeighbors, seeds, walkLength, 0.85, pageRankResult, maxNodeId);
             printf("Computing Min Conductance communities...\n");
-            PageRankMinConductanceNoF1(nodeNeighbors, pageRankResult, seeds, communities);
+            std::vector< uint32_t > stopReasons;
+            PageRankMinConductanceNoF1(nodeNeighbors, pageRankResult, seeds, communities, SweepLimits(), stopReasons);
             printf("Computing F1 score...\n");
             //ComputeF1ScorePerSeed(seeds, groundTruthCommunities, nodeGroundTruthCommunities, communities, f1Scores);
             ComputeF1ScoreSeedUnion(seeds, groundTruthCommunities, nodeGroundTruthCommunities, communities, f1Scores);
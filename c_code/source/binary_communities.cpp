@@ -0,0 +1,133 @@
+#include "../include/binary_communities.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// The sections are written and mapped in host byte order, which must therefore be the little-endian order of the format
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "The binary community files are little-endian: big-endian hosts are not supported"
+#endif
+
+// Size of the nodes section, padded so that the scores are aligned
+static uint64_t GetNodeSectionSize(uint64_t nbNodes) {
+    return (nbNodes * sizeof(uint32_t) + 7) & ~((uint64_t) 7);
+}
+
+int PrintBinaryPartition(const char* fileName, std::vector< NodeSet >& communities, const std::vector< double >* scores) {
+    ResultWriter writer(fileName);
+    BinaryCommunityHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINARY_COMMUNITIES_MAGIC, sizeof(BINARY_COMMUNITIES_MAGIC));
+    header.version = BINARY_COMMUNITIES_VERSION;
+    header.flags = scores != NULL ? BINARY_COMMUNITIES_SCORES : 0;
+    header.nbCommunities = communities.size();
+    header.nbNodes = 0;
+    for (uint64_t i = 0; i < communities.size(); i++) {
+        header.nbNodes += communities[i].size();
+    }
+    writer.Write((const char*) &header, sizeof(header));
+    uint64_t offset = 0;
+    writer.Write((const char*) &offset, sizeof(offset));
+    for (uint64_t i = 0; i < communities.size(); i++) {
+        offset += communities[i].size();
+        writer.Write((const char*) &offset, sizeof(offset));
+    }
+    for (uint64_t i = 0; i < communities.size(); i++) {
+        for (NodeSet::const_iterator it = communities[i].begin(); it != communities[i].end(); ++it) {
+            uint32_t node = *it;
+            writer.Write((const char*) &node, sizeof(node));
+        }
+    }
+    const char padding[8] = {0};
+    writer.Write(padding, GetNodeSectionSize(header.nbNodes) - header.nbNodes * sizeof(uint32_t));
+    if (scores != NULL) {
+        for (uint64_t i = 0; i < communities.size(); i++) {
+            double score = i < scores->size() ? (*scores)[i] : 0.0;
+            writer.Write((const char*) &score, sizeof(score));
+        }
+    }
+    return writer.Close();
+}
+
+bool IsBinaryCommunityFile(const char* fileName) {
+    char magic[sizeof(BINARY_COMMUNITIES_MAGIC)];
+    std::ifstream file(fileName, std::ios::binary);
+    return file.read(magic, sizeof(magic)) && memcmp(magic, BINARY_COMMUNITIES_MAGIC, sizeof(magic)) == 0;
+}
+
+BinaryCommunities::BinaryCommunities()
+    : data(NULL), dataSize(0), header(NULL), offsets(NULL), nodes(NULL), scores(NULL) {}
+
+BinaryCommunities::~BinaryCommunities() {
+    Close();
+}
+
+bool BinaryCommunities::Open(const char* fileName) {
+    Close();
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0) {
+        printf("Cannot open %s: %s\n", fileName, strerror(errno));
+        return false;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || (uint64_t) fileStat.st_size < sizeof(BinaryCommunityHeader)) {
+        printf("%s is not a binary community file\n", fileName);
+        close(fd);
+        return false;
+    }
+    dataSize = fileStat.st_size;
+    data = mmap(NULL, dataSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        printf("Cannot map %s: %s\n", fileName, strerror(errno));
+        data = NULL;
+        return false;
+    }
+    header = (const BinaryCommunityHeader*) data;
+    // the sizes of the sections follow from the header, the file must have exactly these sizes
+    uint64_t expectedSize = 0;
+    bool valid = memcmp(header->magic, BINARY_COMMUNITIES_MAGIC, sizeof(BINARY_COMMUNITIES_MAGIC)) == 0
+                 && header->version == BINARY_COMMUNITIES_VERSION
+                 && header->nbCommunities < dataSize / sizeof(uint64_t)
+                 && header->nbNodes < dataSize / sizeof(uint32_t);
+    if (valid) {
+        expectedSize = sizeof(BinaryCommunityHeader) + (header->nbCommunities + 1) * sizeof(uint64_t)
+                       + GetNodeSectionSize(header->nbNodes);
+        if (header->flags & BINARY_COMMUNITIES_SCORES) {
+            expectedSize += header->nbCommunities * sizeof(double);
+        }
+        valid = expectedSize == dataSize;
+    }
+    if (valid) {
+        offsets = (const uint64_t*) (header + 1);
+        nodes = (const uint32_t*) (offsets + header->nbCommunities + 1);
+        valid = offsets[0] == 0 && offsets[header->nbCommunities] == header->nbNodes;
+        // GetSize and GetNodes trust the offsets: they must not decrease, so they all stay within the nodes
+        for (uint64_t i = 0; valid && i < header->nbCommunities; i++) {
+            valid = offsets[i] <= offsets[i + 1];
+        }
+    }
+    if (!valid) {
+        printf("%s is not a binary community file (version %u)\n", fileName, BINARY_COMMUNITIES_VERSION);
+        Close();
+        return false;
+    }
+    if (header->flags & BINARY_COMMUNITIES_SCORES) {
+        scores = (const double*) ((const char*) nodes + GetNodeSectionSize(header->nbNodes));
+    }
+    return true;
+}
+
+void BinaryCommunities::Close() {
+    if (data != NULL) {
+        munmap(data, dataSize);
+    }
+    data = NULL;
+    dataSize = 0;
+    header = NULL;
+    offsets = NULL;
+    nodes = NULL;
+    scores = NULL;
+}
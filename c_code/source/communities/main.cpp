@@ -0,0 +1,125 @@
+#include "../include/utils.h"
+#include "../include/binary_communities.h"
+
+static void PrintUsage() {
+    printf("Usage: communities <flags>\n");
+    printf("Availaible flags:\n");
+    printf("\t-i [community file name] : Specifies the community file, binary (-communities.bin) or text (-communities.txt).\n");
+    printf("\t-o [output file name] : Converts the community file to the other format (text for a binary file, binary for a text file).\n");
+    printf("\t-n [seed set number] : Prints the community of this seed set (0-based), and its score if the file has scores.\n");
+    printf("\t--scores [score file name] : With a text community file, stores these scores (one per line, e.g. the -f1scores.txt output of benchmarks) in the binary file.\n");
+    printf("Without -o and -n, prints the number of communities and nodes of the file.\n");
+}
+
+int main(int argc, char ** argv) {
+    bool inputFileNameSet = false;
+    bool outputFileNameSet = false;
+    bool indexSet = false;
+    bool scoreFileNameSet = false;
+    char * inputFileName = NULL;
+    char * outputFileName = NULL;
+    char * scoreFileName = NULL;
+    uint32_t index = 0;
+
+    for(int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            PrintUsage();
+            return 0;
+        }
+        CHECK_ARGUMENT_STRING(i, "-i", inputFileName, inputFileNameSet);
+        CHECK_ARGUMENT_STRING(i, "-o", outputFileName, outputFileNameSet)
+        CHECK_ARGUMENT_INT(i, "-n", index, indexSet);
+        CHECK_ARGUMENT_STRING(i, "--scores", scoreFileName, scoreFileNameSet)
+    }
+
+    if (!inputFileNameSet) {
+        printf("Community filename not set\n");
+        PrintUsage();
+        return 1;
+    }
+
+    //================ TEXT FILE: CONVERT TO BINARY ========================
+    if (!IsBinaryCommunityFile(inputFileName)) {
+        if (!outputFileNameSet || indexSet) {
+            printf("%s is a text file: only the conversion to binary (-o) is available\n", inputFileName);
+            return 1;
+        }
+        std::ifstream communityFile(inputFileName);
+        if (!communityFile) {
+            printf("Cannot open the community file %s\n", inputFileName);
+            return 1;
+        }
+        std::vector< NodeSet > communities;
+        ReadSeedSets(communityFile, communities, UINT32_MAX);
+        std::vector< double > scores;
+        if (scoreFileNameSet) {
+            std::ifstream scoreFile(scoreFileName);
+            if (!scoreFile) {
+                printf("Cannot open the score file %s\n", scoreFileName);
+                return 1;
+            }
+            double score;
+            while (scoreFile >> score) {
+                scores.push_back(score);
+            }
+            if (scores.size() != communities.size()) {
+                printf("%lu scores for %lu communities\n", scores.size(), communities.size());
+                return 1;
+            }
+        }
+        printf("Converting %lu communities to %s...\n", communities.size(), outputFileName);
+        return PrintBinaryPartition(outputFileName, communities, scoreFileNameSet ? &scores : NULL);
+    }
+    //======================================================================
+
+    //=============== BINARY FILE: LOOK UP OR CONVERT TO TEXT ==============
+    BinaryCommunities communities;
+    if (!communities.Open(inputFileName)) {
+        return 1;
+    }
+    if (scoreFileNameSet) {
+        printf("%s is a binary file: --scores is ignored\n", inputFileName);
+    }
+    if (indexSet) {
+        if (index >= communities.GetNbCommunities()) {
+            printf("Seed set %u out of range (%lu communities)\n", index, communities.GetNbCommunities());
+            return 1;
+        }
+        const uint32_t* nodes = communities.GetNodes(index);
+        for (uint64_t i = 0; i < communities.GetSize(index); i++) {
+            if (i > 0) {
+                std::cout << " ";
+            }
+            std::cout << nodes[i];
+        }
+        std::cout << "\n";
+        if (communities.HasScores()) {
+            std::cout << "Score: " << communities.GetScore(index) << "\n";
+        }
+    }
+    if (outputFileNameSet) {
+        printf("Converting %lu communities to %s...\n", communities.GetNbCommunities(), outputFileName);
+        ResultWriter writer(outputFileName);
+        for (uint64_t i = 0; i < communities.GetNbCommunities(); i++) {
+            const uint32_t* nodes = communities.GetNodes(i);
+            for (uint64_t j = 0; j < communities.GetSize(i); j++) {
+                if (j > 0) {
+                    writer.WriteChar(' ');
+                }
+                writer.WriteUInt(nodes[j]);
+            }
+            writer.WriteChar('\n');
+        }
+        if (writer.Close() != 0) {
+            return 1;
+        }
+    }
+    if (!indexSet && !outputFileNameSet) {
+        printf("Nb of communities: %lu\n", communities.GetNbCommunities());
+        printf("Nb of nodes: %lu\n", communities.GetNbNodes());
+        printf("Scores: %s\n", communities.HasScores() ? "yes" : "no");
+    }
+    //======================================================================
+
+    return 0;
+}
@@ -1,58 +1,101 @@
 #include "../include/lexrank.h"
 #include "../include/utils.h"
+#include "../include/scheduler.h"
+#include <omp.h>
 
-int LexRank(std::vector< NodeSet >& nodeNeighbors,
-            std::vector< NodeSet >& seedSets,
-            uint32_t nbSteps,
-            std::vector< std::vector< NodeLexRank > >& lexRankResult,
-            uint32_t maxNodeId) {
+template < uint32_t NbSteps >
+static bool nodeEmbeddingCompare(const std::pair< uint32_t, typename WalkEmbedding< NbSteps >::Type >& node1,
+                                 const std::pair< uint32_t, typename WalkEmbedding< NbSteps >::Type >& node2) {
+    return node1.second > node2.second;
+}
+
+// LexRank of one seed set: the non-seed nodes of the walk support with their walk probabilities at steps 1..t,
+// sorted by decreasing lexicographic order. With a budget, the walk stops at the last step completed within it
+// and the probabilities of the next steps are 0. The probabilities of the steps are kept in walkBuffers.
+template < uint32_t NbSteps >
+static int LexRankSeedSet(std::vector< NodeSet >& nodeNeighbors,
+                          const NodeSet& seedSet,
+                          uint32_t nbSteps,
+                          std::vector< std::pair< uint32_t, typename WalkEmbedding< NbSteps >::Type > >& nodeEmbedding,
+                          WalkBuffers& walkBuffers,
+                          QueryBudgetTracker* budgetTracker = NULL) {
+    typedef typename WalkEmbedding< NbSteps >::Type Embedding;
+    const uint32_t steps = WalkEmbedding< NbSteps >::Size(nbSteps);
+    uint32_t seedSetSize = seedSet.size();
+    NodeSet walkSupport;
+    walkBuffers.Reset(steps + 1);
+    // Initialization of the walk from the seed nodes
+    for (NodeSet::const_iterator it2 = seedSet.begin(); it2 != seedSet.end(); ++it2) {
+            walkBuffers.Proba(0, walkBuffers.GetIndex(*it2)) = 1.0 / ((double) seedSetSize);
+            walkSupport.insert(*it2);
+    }
+    // For each step
+    uint32_t nbCompletedSteps = 0;
+    for (uint32_t t = 0; t < steps; t++) {
+        NodeSet nextWalkSupport(walkSupport);
+        bool withinBudget = true;
+        // For each node with a pagerank > 0 at the previous step
+        for (NodeSet::iterator it2 = walkSupport.begin(); it2 != walkSupport.end(); ++it2) {
+            const NodeSet& neighbors = nodeNeighbors[*it2];
+            if (budgetTracker != NULL && !budgetTracker->ChargeWalk(nextWalkSupport.size(), neighbors.size())) {
+                withinBudget = false;
+                break;
+            }
+            double degree = neighbors.size();
+            double proba1 = walkBuffers.Proba(t, walkBuffers.GetIndex(*it2));
+            for (NodeSet::iterator it3 = neighbors.begin(); it3 != neighbors.end(); ++it3) {
+                // The walk goes to one of its neighbor with probability 1 / degree
+                uint32_t index2 = walkBuffers.GetIndex(*it3);
+                walkBuffers.Proba(t + 1, index2) += proba1 / degree;
+                nextWalkSupport.insert(*it3);
+            }
+        }
+        if (budgetTracker != NULL && withinBudget) {
+            withinBudget = budgetTracker->ChargeWalk(nextWalkSupport.size(), 0);
+        }
+        if (!withinBudget) {
+            break;
+        }
+        walkSupport = nextWalkSupport;
+        nbCompletedSteps++;
+    }
+    // Sorting the nodes by their fixed-size embedding
+    nodeEmbedding.clear();
+    for (NodeSet::iterator it2 = walkSupport.begin(); it2 != walkSupport.end(); ++it2) {
+        uint32_t index = walkBuffers.GetIndex(*it2);
+        if (index >= seedSetSize) {
+            Embedding embedding = WalkEmbedding< NbSteps >::Create(steps);
+            for (uint32_t t = 0; t < nbCompletedSteps; t++) {
+                embedding[t] = walkBuffers.Proba(t + 1, index);
+            }
+            nodeEmbedding.push_back(std::make_pair(*it2, embedding));
+        }
+    }
+    std::sort(nodeEmbedding.begin(), nodeEmbedding.end(), nodeEmbeddingCompare< NbSteps >);
+    return 0;
+}
+
+template < uint32_t NbSteps >
+static int LexRankFixedSteps(std::vector< NodeSet >& nodeNeighbors,
+                             std::vector< NodeSet >& seedSets,
+                             uint32_t nbSteps,
+                             std::vector< std::vector< NodeLexRank > >& lexRankResult,
+                             uint32_t maxNodeId) {
+    typedef typename WalkEmbedding< NbSteps >::Type Embedding;
     uint32_t counter = 0;
     uint32_t nbCommunities = seedSets.size();
+    WalkBuffers walkBuffers;
     for (std::vector< NodeSet >::iterator it1 = seedSets.begin(); it1 != seedSets.end(); ++it1) {
         DisplayProgress(((double) counter) / (double) nbCommunities, 100);
-        NodeSet seedSet(*it1);
-        uint32_t seedSetSize = seedSet.size();
-        NodeSet walkSupport;
-        std::vector< std::vector< double > > walkProba (nbSteps + 1);
-        std::vector< bool > isSeed (maxNodeId, false);
-        // Initialization of the walk from the seed nodes
-        walkProba[0].resize(maxNodeId + 1);
-        for (NodeSet::iterator it2 = seedSet.begin(); it2 != seedSet.end(); ++it2) {
-                walkProba[0][*it2] = 1.0 / ((double) seedSetSize);
-                walkSupport.insert(*it2);
-                isSeed[*it2] = true;
-        }
-        // For each step
-        for (uint32_t t = 0; t < nbSteps; t++) {
-            NodeSet nextWalkSupport(walkSupport);
-            walkProba[t + 1].resize(maxNodeId + 1);
-            // For each node with a pagerank > 0 at the previous step
-            for (NodeSet::iterator it2 = walkSupport.begin(); it2 != walkSupport.end(); ++it2) {
-                uint32_t node1 = *it2;
-                NodeSet neighbors = nodeNeighbors[node1];
-                double degree = neighbors.size();
-                for (NodeSet::iterator it3 = neighbors.begin(); it3 != neighbors.end(); ++it3) {
-                    // The walk goes to one of its neighbor with probability 1 / degree
-                    uint32_t node2 = *it3;
-                    walkProba[t + 1][node2] += walkProba[t][node1] / degree;
-                    nextWalkSupport.insert(node2);
-                }
-            }
-            walkSupport = nextWalkSupport;
-        }
+        std::vector< std::pair< uint32_t, Embedding > > nodeEmbedding;
+        LexRankSeedSet< NbSteps >(nodeNeighbors, *it1, nbSteps, nodeEmbedding, walkBuffers);
         // Building output
         std::vector< NodeLexRank > nodeLexRank;
-        for (NodeSet::iterator it2 = walkSupport.begin(); it2 != walkSupport.end(); ++it2) {
-            uint32_t node = *it2;
-            if (!isSeed[node]) {
-                std::vector< double > lexRank(nbSteps);
-                for (uint32_t t = 0; t < nbSteps; t++) {
-                    lexRank[t] = walkProba[t + 1][node];
-                }
-                nodeLexRank.push_back(std::make_pair(node, lexRank));
-            }
+        nodeLexRank.reserve(nodeEmbedding.size());
+        for (typename std::vector< std::pair< uint32_t, Embedding > >::iterator it2 = nodeEmbedding.begin();
+             it2 != nodeEmbedding.end(); ++it2) {
+            nodeLexRank.push_back(std::make_pair((*it2).first, std::vector< double >((*it2).second.begin(), (*it2).second.end())));
         }
-        std::sort(nodeLexRank.begin(), nodeLexRank.end(), nodeLexRankCompare);
         lexRankResult.push_back(nodeLexRank);
         counter++;
     }
@@ -60,6 +103,121 @@ int LexRank(std::vector< NodeSet >& nodeNeighbors,
     return 0;
 }
 
+template < uint32_t NbSteps >
+static uint32_t LexRankMinConductanceSeedSetFixedSteps(std::vector< NodeSet >& nodeNeighbors,
+                                                       NodeSet& seedSet,
+                                                       uint32_t nbSteps,
+                                                       NodeSet& community,
+                                                       WalkBuffers& walkBuffers,
+                                                       const SweepLimits& limits,
+                                                       uint64_t graphVolume,
+                                                       QueryBudgetTracker* budgetTracker) {
+    typedef typename WalkEmbedding< NbSteps >::Type Embedding;
+    std::vector< std::pair< uint32_t, Embedding > > nodeEmbedding;
+    LexRankSeedSet< NbSteps >(nodeNeighbors, seedSet, nbSteps, nodeEmbedding, walkBuffers, budgetTracker);
+    std::vector< uint32_t > rankedNodes;
+    rankedNodes.reserve(nodeEmbedding.size());
+    for (typename std::vector< std::pair< uint32_t, Embedding > >::const_iterator it = nodeEmbedding.begin();
+         it != nodeEmbedding.end(); ++it) {
+        rankedNodes.push_back((*it).first);
+    }
+    std::vector< std::pair< uint32_t, Embedding > >().swap(nodeEmbedding);
+    return MinConductanceSweep(nodeNeighbors, seedSet, rankedNodes, limits, graphVolume, community, budgetTracker);
+}
+
+// LexRank and conductance sweep for one seed set (graphVolume is ComputeGraphVolume(nodeNeighbors)), within the
+// budget of budgetTracker if any, with the walk buffers of the calling thread. Returns the reason why the sweep stopped.
+uint32_t LexRankMinConductanceSeedSet(std::vector< NodeSet >& nodeNeighbors,
+                                      NodeSet& seedSet,
+                                      uint32_t nbSteps,
+                                      NodeSet& community,
+                                      WalkBuffers& walkBuffers,
+                                      const SweepLimits& limits,
+                                      uint64_t graphVolume,
+                                      QueryBudgetTracker* budgetTracker) {
+    switch (nbSteps) {
+        case 2:
+            return LexRankMinConductanceSeedSetFixedSteps< 2 >(nodeNeighbors, seedSet, nbSteps, community, walkBuffers, limits, graphVolume, budgetTracker);
+        case 3:
+            return LexRankMinConductanceSeedSetFixedSteps< 3 >(nodeNeighbors, seedSet, nbSteps, community, walkBuffers, limits, graphVolume, budgetTracker);
+        case 4:
+            return LexRankMinConductanceSeedSetFixedSteps< 4 >(nodeNeighbors, seedSet, nbSteps, community, walkBuffers, limits, graphVolume, budgetTracker);
+        default:
+            return LexRankMinConductanceSeedSetFixedSteps< 0 >(nodeNeighbors, seedSet, nbSteps, community, walkBuffers, limits, graphVolume, budgetTracker);
+    }
+}
+
+template < uint32_t NbSteps >
+static int LexRankMinConductancePipelineFixedSteps(std::vector< NodeSet >& nodeNeighbors,
+                                                   std::vector< NodeSet >& seedSets,
+                                                   uint32_t nbSteps,
+                                                   std::vector< NodeSet >& communities,
+                                                   uint32_t maxNodeId,
+                                                   const SweepLimits& limits,
+                                                   std::vector< uint32_t >& stopReasons) {
+    int64_t nbCommunities = seedSets.size();
+    uint64_t graphVolume = ComputeGraphVolume(nodeNeighbors);
+    uint32_t counter = 0;
+    stopReasons.resize(nbCommunities);
+    std::vector< WalkBuffers > threadWalkBuffers (omp_get_max_threads());
+    SeedSetScheduler scheduler(nodeNeighbors, seedSets);
+#pragma omp parallel
+    for (uint32_t i; scheduler.Next(i); ) {
+        stopReasons[i] = LexRankMinConductanceSeedSetFixedSteps< NbSteps >(nodeNeighbors, seedSets[i], nbSteps, communities[i],
+                                                                           threadWalkBuffers[omp_get_thread_num()], limits,
+                                                                           graphVolume, NULL);
+        uint32_t done;
+#pragma omp atomic capture
+        done = ++counter;
+        if (omp_get_thread_num() == 0) {
+            DisplayProgress(((double) done) / (double) nbCommunities, 100);
+        }
+    }
+    std::cout << std::endl;
+    scheduler.PrintUtilization();
+    return 0;
+}
+
+// Pipelined LexRank and conductance sweep: the ranking of each seed set goes straight into its sweep
+// and is freed afterwards, so that only the final communities are kept. Seed sets are processed in parallel,
+// the most expensive ones first (see SeedSetScheduler), each thread with its own walk buffers.
+int LexRankMinConductancePipeline(std::vector< NodeSet >& nodeNeighbors,
+                                  std::vector< NodeSet >& seedSets,
+                                  uint32_t nbSteps,
+                                  std::vector< NodeSet >& communities,
+                                  uint32_t maxNodeId,
+                                  const SweepLimits& limits,
+                                  std::vector< uint32_t >& stopReasons) {
+    switch (nbSteps) {
+        case 2:
+            return LexRankMinConductancePipelineFixedSteps< 2 >(nodeNeighbors, seedSets, nbSteps, communities, maxNodeId, limits, stopReasons);
+        case 3:
+            return LexRankMinConductancePipelineFixedSteps< 3 >(nodeNeighbors, seedSets, nbSteps, communities, maxNodeId, limits, stopReasons);
+        case 4:
+            return LexRankMinConductancePipelineFixedSteps< 4 >(nodeNeighbors, seedSets, nbSteps, communities, maxNodeId, limits, stopReasons);
+        default:
+            return LexRankMinConductancePipelineFixedSteps< 0 >(nodeNeighbors, seedSets, nbSteps, communities, maxNodeId, limits, stopReasons);
+    }
+}
+
+int LexRank(std::vector< NodeSet >& nodeNeighbors,
+            std::vector< NodeSet >& seedSets,
+            uint32_t nbSteps,
+            std::vector< std::vector< NodeLexRank > >& lexRankResult,
+            uint32_t maxNodeId) {
+    // Specialized instances for the usual walk lengths, generic version otherwise
+    switch (nbSteps) {
+        case 2:
+            return LexRankFixedSteps< 2 >(nodeNeighbors, seedSets, nbSteps, lexRankResult, maxNodeId);
+        case 3:
+            return LexRankFixedSteps< 3 >(nodeNeighbors, seedSets, nbSteps, lexRankResult, maxNodeId);
+        case 4:
+            return LexRankFixedSteps< 4 >(nodeNeighbors, seedSets, nbSteps, lexRankResult, maxNodeId);
+        default:
+            return LexRankFixedSteps< 0 >(nodeNeighbors, seedSets, nbSteps, lexRankResult, maxNodeId);
+    }
+}
+
 bool nodeLexRankCompare(const NodeLexRank& node1, const NodeLexRank& node2) {
     return node1.second > node2.second;
 }
@@ -102,42 +260,108 @@ int LexRankMaxF1(std::vector< std::vector< NodeLexRank > >& lexRankResult,
     return 0;
 }
 
-int LexRankMinConductanceNoF1(std::vector< NodeSet >& nodeNeighbors,
-                              std::vector< std::vector< NodeLexRank > >& lexRankResult,
-                              std::vector< NodeSet >& seedSets,
-                              std::vector< NodeSet >& communities) {
-    uint32_t nbCommunities = seedSets.size();
+// Single sweep over each ranking computing the Max-F1 and Conductance communities at once.
+// communities[objectiveId] and f1Scores[objectiveId] receive the same results as LexRankMaxF1
+// and LexRankMinConductance (there is no Rank Threshold objective for LexRank).
+int LexRankAllObjectives(std::vector< NodeSet >& nodeNeighbors,
+                         std::vector< std::vector< NodeLexRank > >& lexRankResult,
+                         std::vector< NodeSet >& groundTruthCommunities,
+                         std::vector< NodeSet >& seedSets,
+                         std::vector< std::vector< NodeSet > >& communities,
+                         std::vector< std::vector< double > >& f1Scores) {
+    uint32_t nbCommunities = groundTruthCommunities.size();
+    communities.assign(NB_SWEEP_OBJECTIVES, std::vector< NodeSet >(nbCommunities));
+    f1Scores.assign(NB_SWEEP_OBJECTIVES, std::vector< double >(nbCommunities));
     for (uint32_t i = 0; i < nbCommunities; i++) {
         DisplayProgress(((double) i) / (double) nbCommunities, 100);
-        std::vector< NodeLexRank > nodeLexRank(lexRankResult[i]);
-        NodeSet community(seedSets[i]);
-        uint32_t communitySize = community.size();
-        NodeSet bestCommunity(community);
+        const NodeSet& groundTruthCommunity = groundTruthCommunities[i];
+        uint32_t groundTruthCommunitySize = groundTruthCommunity.size();
+        const std::vector< NodeLexRank >& nodeLexRank = lexRankResult[i];
+        const NodeSet& seedSet = seedSets[i];
+        uint32_t communitySize = seedSet.size();
+        uint32_t intersectionSize = ComputeIntersectionSize(seedSet, groundTruthCommunity);
+        // Max-F1
+        double bestF1Score = ComputeF1Score(communitySize, groundTruthCommunitySize, intersectionSize);
+        uint32_t bestF1Length = 0;
+        bool maxF1Done = false;
+        // Conductance
+        NodeSet community(seedSet);
         uint32_t internalEdges = 0;
         uint32_t degreeSum = 0;
         for (NodeSet::iterator it = community.begin(); it != community.end(); ++it) {
-            uint32_t node = *it;
-            NodeSet neighborhood = nodeNeighbors[node];
+            const NodeSet& neighborhood = nodeNeighbors[*it];
             internalEdges += ComputeIntersectionSize(neighborhood, community);
             degreeSum += neighborhood.size();
         }
         double bestConductance = ComputeConductance(degreeSum, internalEdges);
-
-        for (std::vector< NodeLexRank >::iterator it = nodeLexRank.begin();
-             it != nodeLexRank.end(); ++it) {
+        uint32_t bestConductanceLength = 0;
+        bool conductanceDone = false;
+        uint32_t length = 0;
+        for (std::vector< NodeLexRank >::const_iterator it = nodeLexRank.begin();
+             it != nodeLexRank.end() && !(maxF1Done && conductanceDone); ++it) {
             uint32_t node = (*it).first;
-            community.insert(node);
             communitySize++;
-            NodeSet neighborhood = nodeNeighbors[node];
-            internalEdges += ComputeIntersectionSize(neighborhood, community);
-            degreeSum += neighborhood.size();
-            double conductance = ComputeConductance(degreeSum, internalEdges);
-            if (conductance <= bestConductance) {
-                bestCommunity = community;
-                bestConductance = conductance;
+            length++;
+            if (groundTruthCommunity.find(node) != groundTruthCommunity.end()) {
+                intersectionSize++;
+            }
+            if (!maxF1Done) {
+                double f1Score = ComputeF1Score(communitySize, groundTruthCommunitySize, intersectionSize);
+                if (f1Score >= bestF1Score) {
+                    bestF1Length = length;
+                    bestF1Score = f1Score;
+                } else if (communitySize > 2 * groundTruthCommunitySize) {
+                    maxF1Done = true;
+                }
+            }
+            if (!conductanceDone) {
+                community.insert(node);
+                const NodeSet& neighborhood = nodeNeighbors[node];
+                internalEdges += ComputeIntersectionSize(neighborhood, community);
+                degreeSum += neighborhood.size();
+                double conductance = ComputeConductance(degreeSum, internalEdges);
+                if (conductance <= bestConductance) {
+                    bestConductanceLength = length;
+                    bestConductance = conductance;
+                } else if (communitySize > 2 * groundTruthCommunitySize) {
+                    conductanceDone = true;
+                }
             }
         }
-        communities[i] = bestCommunity;
+        NodeSet bestF1Community(seedSet);
+        for (uint32_t j = 0; j < bestF1Length; j++) {
+            bestF1Community.insert(nodeLexRank[j].first);
+        }
+        communities[SWEEP_MAX_F1][i] = bestF1Community;
+        f1Scores[SWEEP_MAX_F1][i] = bestF1Score;
+        NodeSet bestConductanceCommunity(seedSet);
+        for (uint32_t j = 0; j < bestConductanceLength; j++) {
+            bestConductanceCommunity.insert(nodeLexRank[j].first);
+        }
+        communities[SWEEP_CONDUCTANCE][i] = bestConductanceCommunity;
+        f1Scores[SWEEP_CONDUCTANCE][i] = ComputeF1Score(bestConductanceCommunity, groundTruthCommunity);
+    }
+    std::cout << std::endl;
+    return 0;
+}
+
+int LexRankMinConductanceNoF1(std::vector< NodeSet >& nodeNeighbors,
+                              std::vector< std::vector< NodeLexRank > >& lexRankResult,
+                              std::vector< NodeSet >& seedSets,
+                              std::vector< NodeSet >& communities,
+                              const SweepLimits& limits,
+                              std::vector< uint32_t >& stopReasons) {
+    uint32_t nbCommunities = seedSets.size();
+    uint64_t graphVolume = ComputeGraphVolume(nodeNeighbors);
+    stopReasons.resize(nbCommunities);
+    for (uint32_t i = 0; i < nbCommunities; i++) {
+        DisplayProgress(((double) i) / (double) nbCommunities, 100);
+        std::vector< uint32_t > rankedNodes;
+        rankedNodes.reserve(lexRankResult[i].size());
+        for (std::vector< NodeLexRank >::const_iterator it = lexRankResult[i].begin(); it != lexRankResult[i].end(); ++it) {
+            rankedNodes.push_back((*it).first);
+        }
+        stopReasons[i] = MinConductanceSweep(nodeNeighbors, seedSets[i], rankedNodes, limits, graphVolume, communities[i]);
     }
     std::cout << std::endl;
     return 0;
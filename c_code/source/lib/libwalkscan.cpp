@@ -0,0 +1,363 @@
+#include "../include/libwalkscan.h"
+#include "../include/query.h"
+#include "../include/scheduler.h"
+#include <omp.h>
+#include <mutex>
+
+struct walkscan_engine {
+    std::vector< NodeSet > nodeNeighbors;
+    uint32_t maxNodeId;
+    uint64_t graphVolume;
+    // Buffers of the queries that ended, reused by the next ones (one per concurrent query at most)
+    mutable std::mutex buffersMutex;
+    mutable std::vector< QueryBuffers* > freeBuffers;
+    ~walkscan_engine() {
+        for (std::vector< QueryBuffers* >::iterator it = freeBuffers.begin(); it != freeBuffers.end(); ++it) {
+            delete *it;
+        }
+    }
+};
+
+// Query buffers of the calling thread, taken from the engine for the duration of a query
+class EngineQueryBuffers {
+public:
+    explicit EngineQueryBuffers(const walkscan_engine* engine) : engine(engine), buffers(NULL) {
+        std::lock_guard< std::mutex > lock(engine->buffersMutex);
+        if (!engine->freeBuffers.empty()) {
+            buffers = engine->freeBuffers.back();
+            engine->freeBuffers.pop_back();
+        }
+    }
+    ~EngineQueryBuffers() {
+        if (buffers != NULL) {
+            std::lock_guard< std::mutex > lock(engine->buffersMutex);
+            engine->freeBuffers.push_back(buffers);
+        }
+    }
+    QueryBuffers& Get() {
+        if (buffers == NULL) {
+            buffers = new QueryBuffers;
+        }
+        return *buffers;
+    }
+
+private:
+    EngineQueryBuffers(const EngineQueryBuffers&);
+    EngineQueryBuffers& operator=(const EngineQueryBuffers&);
+
+    const walkscan_engine* engine;
+    QueryBuffers* buffers;
+};
+
+// The C API lets no exception out (std::bad_alloc mostly): the functions that create an engine return NULL,
+// the queries WALKSCAN_ERROR_INTERNAL
+#define WALKSCAN_CATCH(errorValue) catch (...) { return errorValue; }
+
+static walkscan_engine* CreateEngine(std::vector< Edge >& edgeList, uint32_t maxNodeId) {
+    std::vector< NodeSet > nodeNeighbors(((uint64_t) maxNodeId) + 1);
+    BuildNeighborhoods(edgeList, nodeNeighbors);
+    walkscan_engine* engine = new walkscan_engine;
+    engine->nodeNeighbors.swap(nodeNeighbors);
+    engine->maxNodeId = maxNodeId;
+    engine->graphVolume = ComputeGraphVolume(engine->nodeNeighbors);
+    return engine;
+}
+
+static QuerySettings GetQuerySettings(const walkscan_settings* settings) {
+    walkscan_settings defaultSettings;
+    if (settings == NULL) {
+        walkscan_default_settings(&defaultSettings);
+        settings = &defaultSettings;
+    }
+    QuerySettings querySettings;
+    querySettings.nbSteps = settings->nb_steps;
+    querySettings.epsilon = settings->epsilon;
+    querySettings.minElems = settings->min_elems;
+    querySettings.sweepLimits.maxVolumeRatio = settings->max_volume_ratio;
+    querySettings.sweepLimits.patience = settings->patience;
+    querySettings.budget.maxFrontierSize = settings->max_frontier_size;
+    querySettings.budget.maxPushedEdges = settings->max_pushed_edges;
+    querySettings.budget.timeLimit = settings->time_limit;
+    querySettings.dbscanSettings.rho = settings->rho;
+    querySettings.dbscanSettings.quantized = settings->quantized != 0;
+    querySettings.dbscanSettings.memoryBudget = settings->dbscan_memory_budget;
+    querySettings.dbscanSettings.nbThreads = settings->nb_threads;
+    return querySettings;
+}
+
+// Seed set of the query, WALKSCAN_OK or the error of an invalid one
+static int BuildSeedSet(const walkscan_engine* engine, const uint32_t* seeds, size_t nbSeeds, NodeSet& seedSet) {
+    if (nbSeeds == 0 || seeds == NULL) {
+        return WALKSCAN_ERROR_INVALID_ARGUMENT;
+    }
+    for (size_t i = 0; i < nbSeeds; i++) {
+        if (seeds[i] > engine->maxNodeId) {
+            return WALKSCAN_ERROR_INVALID_NODE;
+        }
+        seedSet.insert(seeds[i]);
+    }
+    return WALKSCAN_OK;
+}
+
+void walkscan_default_settings(walkscan_settings* settings) {
+    QuerySettings querySettings;
+    settings->nb_steps = querySettings.nbSteps;
+    settings->epsilon = querySettings.epsilon;
+    settings->min_elems = querySettings.minElems;
+    settings->max_volume_ratio = querySettings.sweepLimits.maxVolumeRatio;
+    settings->patience = querySettings.sweepLimits.patience;
+    settings->max_frontier_size = querySettings.budget.maxFrontierSize;
+    settings->max_pushed_edges = querySettings.budget.maxPushedEdges;
+    settings->time_limit = querySettings.budget.timeLimit;
+    settings->rho = querySettings.dbscanSettings.rho;
+    settings->quantized = querySettings.dbscanSettings.quantized;
+    settings->dbscan_memory_budget = querySettings.dbscanSettings.memoryBudget;
+    settings->nb_threads = querySettings.dbscanSettings.nbThreads;
+}
+
+walkscan_engine* walkscan_engine_load(const char* graph_file_name) {
+    if (graph_file_name == NULL) {
+        return NULL;
+    }
+    try {
+        std::vector< Edge > edgeList;
+        uint32_t maxNodeId = 0;
+        std::string fileName(graph_file_name);
+        if (LoadGraph(&fileName[0], edgeList, maxNodeId) != 0) {
+            return NULL;
+        }
+        return CreateEngine(edgeList, maxNodeId);
+    } WALKSCAN_CATCH(NULL)
+}
+
+walkscan_engine* walkscan_engine_from_edges(const uint32_t* sources, const uint32_t* targets, uint64_t nb_edges) {
+    if (nb_edges > 0 && (sources == NULL || targets == NULL)) {
+        return NULL;
+    }
+    try {
+        std::vector< Edge > edgeList(nb_edges);
+        uint32_t maxNodeId = 0;
+        for (uint64_t i = 0; i < nb_edges; i++) {
+            edgeList[i] = std::make_pair(sources[i], targets[i]);
+            maxNodeId = std::max(maxNodeId, std::max(sources[i], targets[i]));
+        }
+        return CreateEngine(edgeList, maxNodeId);
+    } WALKSCAN_CATCH(NULL)
+}
+
+walkscan_engine* walkscan_engine_from_csr(uint32_t nb_nodes,
+                                          const uint64_t* offsets,
+                                          const uint32_t* neighbors,
+                                          uint64_t nb_neighbors) {
+    if (nb_nodes == 0 || offsets == NULL || (nb_neighbors > 0 && neighbors == NULL)) {
+        return NULL;
+    }
+    // the offsets are checked before anything is allocated from them
+    if (offsets[0] != 0 || offsets[nb_nodes] > nb_neighbors) {
+        return NULL;
+    }
+    for (uint32_t node = 0; node < nb_nodes; node++) {
+        if (offsets[node + 1] < offsets[node]) {
+            return NULL;
+        }
+    }
+    try {
+        std::vector< Edge > edgeList;
+        edgeList.reserve(offsets[nb_nodes]);
+        for (uint32_t node = 0; node < nb_nodes; node++) {
+            for (uint64_t i = offsets[node]; i < offsets[node + 1]; i++) {
+                if (neighbors[i] >= nb_nodes) {
+                    return NULL;
+                }
+                edgeList.push_back(std::make_pair(node, neighbors[i]));
+            }
+        }
+        return CreateEngine(edgeList, nb_nodes - 1);
+    } WALKSCAN_CATCH(NULL)
+}
+
+void walkscan_engine_free(walkscan_engine* engine) {
+    delete engine;
+}
+
+uint32_t walkscan_engine_nb_nodes(const walkscan_engine* engine) {
+    return engine == NULL ? 0 : engine->maxNodeId + 1;
+}
+
+uint64_t walkscan_engine_nb_edges(const walkscan_engine* engine) {
+    if (engine == NULL) {
+        return 0;
+    }
+    // each edge is in the neighborhoods of both of its nodes, self-loops once
+    uint64_t nbSelfLoops = 0;
+    for (uint32_t node = 0; node <= engine->maxNodeId; node++) {
+        nbSelfLoops += engine->nodeNeighbors[node].count(node);
+    }
+    return (engine->graphVolume + nbSelfLoops) / 2;
+}
+
+int walkscan_query(const walkscan_engine* engine,
+                   int algorithm,
+                   const walkscan_settings* settings,
+                   const uint32_t* seeds,
+                   size_t nb_seeds,
+                   uint32_t* community,
+                   size_t capacity,
+                   size_t* community_size,
+                   uint32_t* stop_reason,
+                   uint8_t* truncated) {
+    if (engine == NULL || algorithm < WALKSCAN_PAGERANK || algorithm > WALKSCAN_WALKSCAN || community_size == NULL
+        || (capacity > 0 && community == NULL)) {
+        return WALKSCAN_ERROR_INVALID_ARGUMENT;
+    }
+    try {
+        NodeSet seedSet;
+        int status = BuildSeedSet(engine, seeds, nb_seeds, seedSet);
+        if (status != WALKSCAN_OK) {
+            return status;
+        }
+        QuerySettings querySettings = GetQuerySettings(settings);
+        NodeSet seedSetCommunity;
+        bool seedSetTruncated;
+        // the queries only read the graph
+        std::vector< NodeSet >& nodeNeighbors = const_cast< std::vector< NodeSet >& >(engine->nodeNeighbors);
+        EngineQueryBuffers buffers(engine);
+        uint32_t seedSetStopReason = ComputeSeedSetCommunity(algorithm, nodeNeighbors, seedSet, seedSetCommunity,
+                                                             buffers.Get(), engine->graphVolume, querySettings, NULL,
+                                                             NULL, &seedSetTruncated);
+        if (stop_reason != NULL) {
+            *stop_reason = seedSetStopReason;
+        }
+        if (truncated != NULL) {
+            *truncated = seedSetTruncated;
+        }
+        *community_size = seedSetCommunity.size();
+        if (seedSetCommunity.size() > capacity) {
+            return WALKSCAN_ERROR_BUFFER_TOO_SMALL;
+        }
+        std::copy(seedSetCommunity.begin(), seedSetCommunity.end(), community);
+        return WALKSCAN_OK;
+    } WALKSCAN_CATCH(WALKSCAN_ERROR_INTERNAL)
+}
+
+int walkscan_query_clusters(const walkscan_engine* engine,
+                            const walkscan_settings* settings,
+                            const uint32_t* seeds,
+                            size_t nb_seeds,
+                            uint64_t* cluster_offsets,
+                            size_t max_clusters,
+                            size_t* nb_clusters,
+                            uint32_t* nodes,
+                            size_t capacity,
+                            size_t* nb_nodes,
+                            uint8_t* truncated) {
+    if (engine == NULL || cluster_offsets == NULL || nb_clusters == NULL || nb_nodes == NULL
+        || (capacity > 0 && nodes == NULL)) {
+        return WALKSCAN_ERROR_INVALID_ARGUMENT;
+    }
+    try {
+        NodeSet seedSet;
+        int status = BuildSeedSet(engine, seeds, nb_seeds, seedSet);
+        if (status != WALKSCAN_OK) {
+            return status;
+        }
+        QuerySettings querySettings = GetQuerySettings(settings);
+        QueryBudgetTracker budgetTracker(querySettings.budget);
+        std::vector< NodeSet >& nodeNeighbors = const_cast< std::vector< NodeSet >& >(engine->nodeNeighbors);
+        std::vector< NodeSet > communities;
+        EngineQueryBuffers buffers(engine);
+        WalkScanCommunitiesSeedSet(nodeNeighbors, seedSet, querySettings.nbSteps, communities, buffers.Get().walk,
+                                   buffers.Get().clusters, querySettings.epsilon, querySettings.minElems,
+                                   querySettings.dbscanSettings, querySettings.budget.IsLimited() ? &budgetTracker : NULL);
+        if (truncated != NULL) {
+            *truncated = budgetTracker.IsTruncated();
+        }
+        *nb_clusters = communities.size();
+        *nb_nodes = 0;
+        for (std::vector< NodeSet >::iterator it = communities.begin(); it != communities.end(); ++it) {
+            *nb_nodes += it->size();
+        }
+        if (*nb_clusters > max_clusters || *nb_nodes > capacity) {
+            return WALKSCAN_ERROR_BUFFER_TOO_SMALL;
+        }
+        cluster_offsets[0] = 0;
+        for (size_t i = 0; i < communities.size(); i++) {
+            std::copy(communities[i].begin(), communities[i].end(), nodes + cluster_offsets[i]);
+            cluster_offsets[i + 1] = cluster_offsets[i] + communities[i].size();
+        }
+        return WALKSCAN_OK;
+    } WALKSCAN_CATCH(WALKSCAN_ERROR_INTERNAL)
+}
+
+int walkscan_query_batch(const walkscan_engine* engine,
+                         int algorithm,
+                         const walkscan_settings* settings,
+                         const uint64_t* seed_offsets,
+                         const uint32_t* seed_nodes,
+                         size_t nb_seed_sets,
+                         uint64_t* community_offsets,
+                         uint32_t* community_nodes,
+                         size_t capacity,
+                         uint32_t* stop_reasons,
+                         uint8_t* truncated) {
+    if (engine == NULL || algorithm < WALKSCAN_PAGERANK || algorithm > WALKSCAN_WALKSCAN || seed_offsets == NULL
+        || (nb_seed_sets > 0 && seed_nodes == NULL) || community_offsets == NULL
+        || (capacity > 0 && community_nodes == NULL)) {
+        return WALKSCAN_ERROR_INVALID_ARGUMENT;
+    }
+    try {
+        std::vector< NodeSet > seeds(nb_seed_sets);
+        for (size_t i = 0; i < nb_seed_sets; i++) {
+            if (seed_offsets[i + 1] < seed_offsets[i]) {
+                return WALKSCAN_ERROR_INVALID_ARGUMENT;
+            }
+            int status = BuildSeedSet(engine, seed_nodes + seed_offsets[i], seed_offsets[i + 1] - seed_offsets[i], seeds[i]);
+            if (status != WALKSCAN_OK) {
+                return status;
+            }
+        }
+        QuerySettings querySettings = GetQuerySettings(settings);
+        uint32_t nbThreads = querySettings.dbscanSettings.nbThreads > 0 ? querySettings.dbscanSettings.nbThreads : omp_get_max_threads();
+        std::vector< NodeSet >& nodeNeighbors = const_cast< std::vector< NodeSet >& >(engine->nodeNeighbors);
+        std::vector< NodeSet > communities(nb_seed_sets);
+        SeedSetScheduler scheduler(nodeNeighbors, seeds);
+        // an exception cannot leave the parallel region: the threads that fail stop and the batch fails at the end
+        bool failed = false;
+#pragma omp parallel num_threads(nbThreads)
+        try {
+            EngineQueryBuffers buffers(engine);
+            for (uint32_t i; scheduler.Next(i); ) {
+                bool seedSetTruncated;
+                uint32_t stopReason = ComputeSeedSetCommunity(algorithm, nodeNeighbors, seeds[i], communities[i], buffers.Get(),
+                                                              engine->graphVolume, querySettings, NULL, NULL, &seedSetTruncated);
+                if (stop_reasons != NULL) {
+                    stop_reasons[i] = stopReason;
+                }
+                if (truncated != NULL) {
+                    truncated[i] = seedSetTruncated;
+                }
+            }
+        } catch (...) {
+#pragma omp atomic write
+            failed = true;
+        }
+        if (failed) {
+            return WALKSCAN_ERROR_INTERNAL;
+        }
+        community_offsets[0] = 0;
+        for (size_t i = 0; i < nb_seed_sets; i++) {
+            community_offsets[i + 1] = community_offsets[i] + communities[i].size();
+        }
+        if (community_offsets[nb_seed_sets] > capacity) {
+            return WALKSCAN_ERROR_BUFFER_TOO_SMALL;
+        }
+        for (size_t i = 0; i < nb_seed_sets; i++) {
+            std::copy(communities[i].begin(), communities[i].end(), community_nodes + community_offsets[i]);
+        }
+        return WALKSCAN_OK;
+    } WALKSCAN_CATCH(WALKSCAN_ERROR_INTERNAL)
+}
+
+const char* walkscan_stop_reason_name(uint32_t stop_reason) {
+    return GetSweepStopReasonName(stop_reason);
+}
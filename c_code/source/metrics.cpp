@@ -0,0 +1,78 @@
+#include "../include/metrics.h"
+#include "../include/sweep.h"
+#include <omp.h>
+
+// Communities are scored in parallel. Each thread marks the nodes of the current community
+// in its own membership bitmap, and unmarks them once the community is done.
+int ComputeCommunityMetrics(std::vector< NodeSet >& nodeNeighbors,
+                            std::vector< NodeSet >& communities,
+                            std::vector< CommunityMetrics >& metrics) {
+    int64_t nbCommunities = communities.size();
+    uint32_t nbNodes = nodeNeighbors.size();
+    double graphVolume = ComputeGraphVolume(nodeNeighbors);
+    metrics.resize(nbCommunities);
+#pragma omp parallel
+    {
+        std::vector< uint8_t > isMember(nbNodes, 0);
+#pragma omp for schedule(dynamic)
+        for (int64_t i = 0; i < nbCommunities; i++) {
+            const NodeSet& community = communities[i];
+            for (NodeSet::const_iterator it = community.begin(); it != community.end(); ++it) {
+                if (*it < nbNodes) {
+                    isMember[*it] = 1;
+                }
+            }
+            uint64_t volume = 0;
+            uint64_t internalDegree = 0;
+            for (NodeSet::const_iterator it1 = community.begin(); it1 != community.end(); ++it1) {
+                if (*it1 >= nbNodes) {
+                    continue;
+                }
+                const NodeSet& neighbors = nodeNeighbors[*it1];
+                volume += neighbors.size();
+                for (NodeSet::const_iterator it2 = neighbors.begin(); it2 != neighbors.end(); ++it2) {
+                    internalDegree += isMember[*it2];
+                }
+            }
+            CommunityMetrics& communityMetrics = metrics[i];
+            communityMetrics.size = community.size();
+            communityMetrics.volume = volume;
+            communityMetrics.cut = volume - internalDegree;
+            communityMetrics.internalEdges = internalDegree / 2;
+            double minVolume = std::min((double) volume, graphVolume - (double) volume);
+            communityMetrics.conductance = minVolume > 0.0 ? ((double) communityMetrics.cut) / minVolume : 1.0;
+            double nbPairs = ((double) communityMetrics.size) * ((double) communityMetrics.size - 1.0) / 2.0;
+            communityMetrics.density = nbPairs > 0.0 ? ((double) communityMetrics.internalEdges) / nbPairs : 0.0;
+            for (NodeSet::const_iterator it = community.begin(); it != community.end(); ++it) {
+                if (*it < nbNodes) {
+                    isMember[*it] = 0;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+int PrintCommunityMetrics(const char* fileName, std::vector< CommunityMetrics >& metrics) {
+    ResultWriter writer(fileName);
+    writer.WriteString("community\tsize\tvolume\tcut\tinternal_edges\tconductance\tdensity\n");
+    uint32_t index = 0;
+    for (std::vector< CommunityMetrics >::iterator it = metrics.begin(); it != metrics.end(); ++it) {
+        writer.WriteUInt(index);
+        writer.WriteChar('\t');
+        writer.WriteUInt((*it).size);
+        writer.WriteChar('\t');
+        writer.WriteUInt((*it).volume);
+        writer.WriteChar('\t');
+        writer.WriteUInt((*it).cut);
+        writer.WriteChar('\t');
+        writer.WriteUInt((*it).internalEdges);
+        writer.WriteChar('\t');
+        writer.WriteDouble((*it).conductance);
+        writer.WriteChar('\t');
+        writer.WriteDouble((*it).density);
+        writer.WriteChar('\n');
+        index++;
+    }
+    return writer.Close();
+}
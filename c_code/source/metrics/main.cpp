@@ -0,0 +1,77 @@
+#include "../include/utils.h"
+#include "../include/metrics.h"
+
+static void PrintUsage() {
+    printf("Usage: metrics <flags>\n");
+    printf("Availaible flags:\n");
+    printf("\t-i [graph file name] : Specifies the graph file (tab-separated list of edges).\n");
+    printf("\t-c [community file name] : Specifies the file with the communities to score (e.g. the -communities.txt output of walkscan).\n");
+    printf("\t-o [output path/prefix] : Specifies the prefix for output files.\n");
+}
+
+int main(int argc, char ** argv) {
+    bool graphFileNameSet = false;
+    bool communityFileNameSet = false;
+    bool outputFileNameSet = false;
+    char * graphFileName = NULL;
+    char * communityFileName = NULL;
+    char * outputFileName = NULL;
+
+    for(int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            PrintUsage();
+            return 0;
+        }
+        CHECK_ARGUMENT_STRING(i, "-i", graphFileName, graphFileNameSet);
+        CHECK_ARGUMENT_STRING(i, "-c", communityFileName, communityFileNameSet)
+        CHECK_ARGUMENT_STRING(i, "-o", outputFileName, outputFileNameSet)
+    }
+
+    if (!graphFileNameSet) {
+        printf("Graph filename not set\n");
+        PrintUsage();
+        return 1;
+    }
+
+    if (!communityFileNameSet) {
+        printf("Community filename not set\n");
+        PrintUsage();
+        return 1;
+    }
+
+    if (!outputFileNameSet) {
+        printf("Output filename not set\n");
+        PrintUsage();
+        return 1;
+    }
+
+    //==================== LOAD THE GRAPH ==================================
+    std::vector< Edge > edgeList;  // Allocating list for edges
+    printf("Graph file: %s\n", graphFileName);
+    uint32_t maxNodeId;
+    LoadGraph(graphFileName, edgeList, maxNodeId);
+    std::vector< NodeSet > nodeNeighbors (maxNodeId + 1);
+    BuildNeighborhoods(edgeList, nodeNeighbors);
+    printf("Nb of edges: %lu\n", edgeList.size());
+    //======================================================================
+
+    //====================== LOAD THE COMMUNITIES ==========================
+    std::vector< NodeSet > communities;
+    std::vector< NodeSet > nodeCommunities (maxNodeId + 1);
+    printf("Communities: %s\n", communityFileName);
+    LoadCommunity(communityFileName, communities, nodeCommunities);
+    printf("Nb of communities: %lu\n", communities.size());
+    //======================================================================
+
+    //======================== METRICS =====================================
+    std::vector< CommunityMetrics > metrics;
+    printf("Computing community metrics...\n");
+    ComputeCommunityMetrics(nodeNeighbors, communities, metrics);
+    std::string metricsOutputFileName(outputFileName);
+    metricsOutputFileName += "-metrics.tsv";
+    printf("Printing metrics in %s...\n", metricsOutputFileName.c_str());
+    int status = PrintCommunityMetrics(metricsOutputFileName.c_str(), metrics);
+    //======================================================================
+
+    return status;
+}
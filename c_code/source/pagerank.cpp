@@ -1,5 +1,73 @@
 #include "../include/pagerank.h"
 #include "../include/utils.h"
+#include "../include/scheduler.h"
+#include <omp.h>
+
+// Personalized PageRank of one seed set after nbSteps steps; the non-seed nodes of the walk support
+// are returned by decreasing score. With a budget, the scores are those of the last step completed within it.
+// The scores of the current and next steps are kept in walkBuffers.
+static int PageRankSeedSet(std::vector< NodeSet >& nodeNeighbors,
+                           const NodeSet& seedSet,
+                           uint32_t nbSteps, double alpha,
+                           std::vector< NodePageRank >& nodePageRank,
+                           WalkBuffers& walkBuffers,
+                           QueryBudgetTracker* budgetTracker = NULL) {
+    uint32_t seedSetSize = seedSet.size();
+    NodeSet walkSupport;
+    uint32_t pageRank = 0;
+    walkBuffers.Reset(2);
+    // Initialization of the walk from the seed nodes
+    for (NodeSet::const_iterator it2 = seedSet.begin(); it2 != seedSet.end(); ++it2) {
+            walkBuffers.Proba(pageRank, walkBuffers.GetIndex(*it2)) = 1.0 / ((double) seedSetSize);
+            walkSupport.insert(*it2);
+    }
+    // For each step
+    for (uint32_t t = 0; t < nbSteps; t++) {
+        NodeSet nextWalkSupport(walkSupport);
+        uint32_t nextPageRank = 1 - pageRank;
+        walkBuffers.Clear(nextPageRank);
+        bool withinBudget = true;
+        // For each node with a pagerank > 0 at the previous step
+        for (NodeSet::iterator it2 = walkSupport.begin(); it2 != walkSupport.end(); ++it2) {
+            uint32_t index1 = walkBuffers.GetIndex(*it2);
+            // The walk restarts from a seed node with probability (1 - alpha)
+            if (index1 < seedSetSize) {
+                walkBuffers.Proba(nextPageRank, index1) += (1.0 - alpha) * 1.0 / ((double) seedSetSize);
+            }
+            const NodeSet& neighbors = nodeNeighbors[*it2];
+            if (budgetTracker != NULL && !budgetTracker->ChargeWalk(nextWalkSupport.size(), neighbors.size())) {
+                withinBudget = false;
+                break;
+            }
+            double degree = neighbors.size();
+            double pageRank1 = walkBuffers.Proba(pageRank, index1);
+            for (NodeSet::iterator it3 = neighbors.begin(); it3 != neighbors.end(); ++it3) {
+                // The walk goes to one of its neighbor with probability alpha * 1 / degree
+                uint32_t index2 = walkBuffers.GetIndex(*it3);
+                walkBuffers.Proba(nextPageRank, index2) += alpha * pageRank1 / degree;
+                nextWalkSupport.insert(*it3);
+            }
+        }
+        if (budgetTracker != NULL && withinBudget) {
+            withinBudget = budgetTracker->ChargeWalk(nextWalkSupport.size(), 0);
+        }
+        if (!withinBudget) {
+            break;
+        }
+        walkSupport = nextWalkSupport;
+        pageRank = nextPageRank;
+    }
+    // Building output
+    nodePageRank.clear();
+    for (NodeSet::iterator it2 = walkSupport.begin(); it2 != walkSupport.end(); ++it2) {
+        uint32_t index = walkBuffers.GetIndex(*it2);
+        if (index >= seedSetSize) {
+            nodePageRank.push_back(std::make_pair(*it2, walkBuffers.Proba(pageRank, index)));
+        }
+    }
+    std::sort(nodePageRank.begin(), nodePageRank.end(), nodePageRankCompare);
+    return 0;
+}
 
 int PageRank(std::vector< NodeSet >& nodeNeighbors, std::vector< NodeSet >& seedSets,
              uint32_t nbSteps, double alpha,
@@ -7,50 +75,11 @@ int PageRank(std::vector< NodeSet >& nodeNeighbors, std::vector< NodeSet >& seed
              uint32_t maxNodeId) {
     uint32_t counter = 0;
     uint32_t nbCommunities = seedSets.size();
+    WalkBuffers walkBuffers;
     for (std::vector < NodeSet >::iterator it1 = seedSets.begin(); it1 != seedSets.end(); ++it1) {
         DisplayProgress(((double) counter) / (double) nbCommunities, 100);
-        NodeSet seedSet(*it1);
-        uint32_t seedSetSize = seedSet.size();
-        NodeSet walkSupport;
-        std::vector< double > pageRank (maxNodeId + 1);
-        std::vector< bool > isSeed (maxNodeId, false);
-        // Initialization of the walk from the seed nodes
-        for (NodeSet::iterator it2 = seedSet.begin(); it2 != seedSet.end(); ++it2) {
-                pageRank[*it2] = 1.0 / ((double) seedSetSize);
-                walkSupport.insert(*it2);
-                isSeed[*it2] = true;
-        }
-        // For each step
-        for (uint32_t t = 0; t < nbSteps; t++) {
-            NodeSet nextWalkSupport(walkSupport);
-            std::vector< double > nextPageRank(pageRank.size());
-            // For each node with a pagerank > 0 at the previous step
-            for (NodeSet::iterator it2 = walkSupport.begin(); it2 != walkSupport.end(); ++it2) {
-                uint32_t node1 = *it2;
-                // The walk restarts from a seed node with probability (1 - alpha)
-                if (isSeed[node1]) {
-                    nextPageRank[node1] += (1.0 - alpha) * 1.0 / ((double) seedSetSize);
-                }
-                NodeSet neighbors = nodeNeighbors[node1];
-                double degree = neighbors.size();
-                for (NodeSet::iterator it3 = neighbors.begin(); it3 != neighbors.end(); ++it3) {
-                    // The walk goes to one of its neighbor with probability alpha * 1 / degree
-                    uint32_t node2 = *it3;
-                    nextPageRank[node2] += alpha * pageRank[node1] / degree;
-                    nextWalkSupport.insert(node2);
-                }
-            }
-            walkSupport = nextWalkSupport;
-            pageRank = nextPageRank;
-        }
-        // Building output
         std::vector< NodePageRank > nodePageRank;
-        for (NodeSet::iterator it2 = walkSupport.begin(); it2 != walkSupport.end(); ++it2) {
-            if (!isSeed[*it2]) {
-                nodePageRank.push_back(std::make_pair(*it2, pageRank[*it2]));
-            }
-        }
-        std::sort(nodePageRank.begin(), nodePageRank.end(), nodePageRankCompare);
+        PageRankSeedSet(nodeNeighbors, *it1, nbSteps, alpha, nodePageRank, walkBuffers);
         pageRankResult.push_back(nodePageRank);
         counter++;
     }
@@ -58,6 +87,59 @@ int PageRank(std::vector< NodeSet >& nodeNeighbors, std::vector< NodeSet >& seed
     return 0;
 }
 
+// PageRank and conductance sweep for one seed set (graphVolume is ComputeGraphVolume(nodeNeighbors)), within the
+// budget of budgetTracker if any, with the walk buffers of the calling thread. Returns the reason why the sweep stopped.
+uint32_t PageRankMinConductanceSeedSet(std::vector< NodeSet >& nodeNeighbors,
+                                       NodeSet& seedSet,
+                                       uint32_t nbSteps, double alpha,
+                                       NodeSet& community,
+                                       WalkBuffers& walkBuffers,
+                                       const SweepLimits& limits,
+                                       uint64_t graphVolume,
+                                       QueryBudgetTracker* budgetTracker) {
+    std::vector< NodePageRank > nodePageRank;
+    PageRankSeedSet(nodeNeighbors, seedSet, nbSteps, alpha, nodePageRank, walkBuffers, budgetTracker);
+    std::vector< uint32_t > rankedNodes;
+    rankedNodes.reserve(nodePageRank.size());
+    for (std::vector< NodePageRank >::const_iterator it = nodePageRank.begin(); it != nodePageRank.end(); ++it) {
+        rankedNodes.push_back((*it).first);
+    }
+    std::vector< NodePageRank >().swap(nodePageRank);
+    return MinConductanceSweep(nodeNeighbors, seedSet, rankedNodes, limits, graphVolume, community, budgetTracker);
+}
+
+// Pipelined PageRank and conductance sweep: the ranking of each seed set goes straight into its sweep
+// and is freed afterwards, so that only the final communities are kept. Seed sets are processed in parallel,
+// the most expensive ones first (see SeedSetScheduler), each thread with its own walk buffers.
+int PageRankMinConductancePipeline(std::vector< NodeSet >& nodeNeighbors,
+                                   std::vector< NodeSet >& seedSets,
+                                   uint32_t nbSteps, double alpha,
+                                   std::vector< NodeSet >& communities,
+                                   uint32_t maxNodeId,
+                                   const SweepLimits& limits,
+                                   std::vector< uint32_t >& stopReasons) {
+    int64_t nbCommunities = seedSets.size();
+    uint64_t graphVolume = ComputeGraphVolume(nodeNeighbors);
+    uint32_t counter = 0;
+    stopReasons.resize(nbCommunities);
+    std::vector< WalkBuffers > threadWalkBuffers (omp_get_max_threads());
+    SeedSetScheduler scheduler(nodeNeighbors, seedSets);
+#pragma omp parallel
+    for (uint32_t i; scheduler.Next(i); ) {
+        stopReasons[i] = PageRankMinConductanceSeedSet(nodeNeighbors, seedSets[i], nbSteps, alpha, communities[i],
+                                                       threadWalkBuffers[omp_get_thread_num()], limits, graphVolume);
+        uint32_t done;
+#pragma omp atomic capture
+        done = ++counter;
+        if (omp_get_thread_num() == 0) {
+            DisplayProgress(((double) done) / (double) nbCommunities, 100);
+        }
+    }
+    std::cout << std::endl;
+    scheduler.PrintUtilization();
+    return 0;
+}
+
 bool nodePageRankCompare(const NodePageRank& node1, const NodePageRank& node2) {
     return node1.second > node2.second;
 }
@@ -199,40 +281,153 @@ int PageRankMinConductance(std::vector< NodeSet >& nodeNeighbors,
     return 0;
 }
 
-int PageRankMinConductanceNoF1(std::vector< NodeSet >& nodeNeighbors,
-                               std::vector <std::vector< NodePageRank > >& pageRankResult,
-                               std::vector< NodeSet >& seedSets,
-                               std::vector< NodeSet >& communities) {
-    uint32_t nbCommunities = seedSets.size();
+// Single sweep over each ranking computing the Max-F1, Rank Threshold and Conductance communities at once.
+// communities[objectiveId] and f1Scores[objectiveId] receive the same results as PageRankMaxF1,
+// PageRankThresholdFindBest and PageRankMinConductance.
+int PageRankAllObjectives(std::vector< NodeSet >& nodeNeighbors,
+                          std::vector< std::vector< NodePageRank > >& pageRankResult,
+                          std::vector< NodeSet >& groundTruthCommunities,
+                          std::vector< NodeSet >& seedSets,
+                          std::vector< std::vector< NodeSet > >& communities,
+                          std::vector< std::vector< double > >& f1Scores) {
+    const int nbThresholds = 100;
+    uint32_t nbCommunities = groundTruthCommunities.size();
+    communities.assign(NB_SWEEP_OBJECTIVES, std::vector< NodeSet >(nbCommunities));
+    f1Scores.assign(NB_SWEEP_OBJECTIVES, std::vector< double >(nbCommunities));
+    // F1 score of each seed set for each threshold 0.001 * j
+    std::vector< std::vector< double > > thresholdF1Scores(nbThresholds, std::vector< double >(nbCommunities));
     for (uint32_t i = 0; i < nbCommunities; i++) {
         DisplayProgress(((double) i) / (double) nbCommunities, 100);
-        std::vector<NodePageRank > nodePageRank(pageRankResult[i]);
-        NodeSet community(seedSets[i]);
-        uint32_t communitySize = community.size();
-        NodeSet bestCommunity(community);
+        const NodeSet& groundTruthCommunity = groundTruthCommunities[i];
+        uint32_t groundTruthCommunitySize = groundTruthCommunity.size();
+        const std::vector< NodePageRank >& nodePageRank = pageRankResult[i];
+        const NodeSet& seedSet = seedSets[i];
+        uint32_t seedSetSize = seedSet.size();
+        uint32_t communitySize = seedSetSize;
+        uint32_t intersectionSize = ComputeIntersectionSize(seedSet, groundTruthCommunity);
+        // Max-F1
+        double bestF1Score = ComputeF1Score(communitySize, groundTruthCommunitySize, intersectionSize);
+        uint32_t bestF1Length = 0;
+        bool maxF1Done = false;
+        // Conductance
+        NodeSet community(seedSet);
         uint32_t internalEdges = 0;
         uint32_t degreeSum = 0;
         for (NodeSet::iterator it = community.begin(); it != community.end(); ++it) {
-            uint32_t node = *it;
-            NodeSet neighborhood = nodeNeighbors[node];
+            const NodeSet& neighborhood = nodeNeighbors[*it];
             internalEdges += ComputeIntersectionSize(neighborhood, community);
             degreeSum += neighborhood.size();
         }
         double bestConductance = ComputeConductance(degreeSum, internalEdges);
-        for (std::vector<NodePageRank >::iterator it = nodePageRank.begin(); it != nodePageRank.end(); ++it) {
+        uint32_t bestConductanceLength = 0;
+        bool conductanceDone = false;
+        // Rank Threshold: thresholds are visited by decreasing value as the prefix grows
+        int threshold = nbThresholds - 1;
+        uint32_t length = 0;
+        for (std::vector< NodePageRank >::const_iterator it = nodePageRank.begin(); it != nodePageRank.end(); ++it) {
+            if (maxF1Done && conductanceDone && threshold < 0) {
+                break;
+            }
             uint32_t node = (*it).first;
-            community.insert(node);
+            double pageRank = (*it).second;
+            while (threshold >= 0 && !(pageRank > 0.001 * ((double) threshold))) {
+                thresholdF1Scores[threshold][i] = ComputeF1Score(communitySize, groundTruthCommunitySize, intersectionSize);
+                threshold--;
+            }
             communitySize++;
-            NodeSet neighborhood = nodeNeighbors[node];
-            internalEdges += ComputeIntersectionSize(neighborhood, community);
-            degreeSum += neighborhood.size();
-            double conductance = ComputeConductance(degreeSum, internalEdges);
-            if (conductance <= bestConductance) {
-                bestCommunity = community;
-                bestConductance = conductance;
+            length++;
+            if (groundTruthCommunity.find(node) != groundTruthCommunity.end()) {
+                intersectionSize++;
+            }
+            if (!maxF1Done) {
+                double f1Score = ComputeF1Score(communitySize, groundTruthCommunitySize, intersectionSize);
+                if (f1Score >= bestF1Score) {
+                    bestF1Length = length;
+                    bestF1Score = f1Score;
+                } else if (communitySize > 2 * groundTruthCommunitySize) {
+                    maxF1Done = true;
+                }
+            }
+            if (!conductanceDone) {
+                community.insert(node);
+                const NodeSet& neighborhood = nodeNeighbors[node];
+                internalEdges += ComputeIntersectionSize(neighborhood, community);
+                degreeSum += neighborhood.size();
+                double conductance = ComputeConductance(degreeSum, internalEdges);
+                if (conductance <= bestConductance) {
+                    bestConductanceLength = length;
+                    bestConductance = conductance;
+                } else if (communitySize > 2 * groundTruthCommunitySize) {
+                    conductanceDone = true;
+                }
             }
         }
-        communities[i] = bestCommunity;
+        // Thresholds below all the scores keep the whole ranking
+        for (; threshold >= 0; threshold--) {
+            thresholdF1Scores[threshold][i] = ComputeF1Score(communitySize, groundTruthCommunitySize, intersectionSize);
+        }
+        NodeSet bestF1Community(seedSet);
+        for (uint32_t j = 0; j < bestF1Length; j++) {
+            bestF1Community.insert(nodePageRank[j].first);
+        }
+        communities[SWEEP_MAX_F1][i] = bestF1Community;
+        f1Scores[SWEEP_MAX_F1][i] = bestF1Score;
+        NodeSet bestConductanceCommunity(seedSet);
+        for (uint32_t j = 0; j < bestConductanceLength; j++) {
+            bestConductanceCommunity.insert(nodePageRank[j].first);
+        }
+        communities[SWEEP_CONDUCTANCE][i] = bestConductanceCommunity;
+        f1Scores[SWEEP_CONDUCTANCE][i] = ComputeF1Score(bestConductanceCommunity, groundTruthCommunity);
+    }
+    std::cout << std::endl;
+    // Best threshold on average
+    double bestF1Score = 0.0;
+    int bestThreshold = -1;
+    for (int j = 0; j < nbThresholds; j++) {
+        double averageF1Score = GetAverage(thresholdF1Scores[j]);
+        if (averageF1Score > bestF1Score) {
+            bestThreshold = j;
+            bestF1Score = averageF1Score;
+        }
+    }
+    if (bestThreshold >= 0) {
+        double pageRankThreshold = 0.001 * ((double) bestThreshold);
+        for (uint32_t i = 0; i < nbCommunities; i++) {
+            NodeSet community(seedSets[i]);
+            for (std::vector< NodePageRank >::const_iterator it = pageRankResult[i].begin(); it != pageRankResult[i].end(); ++it) {
+                if ((*it).second > pageRankThreshold) {
+                    community.insert((*it).first);
+                } else {
+                    break;
+                }
+            }
+            communities[SWEEP_RANK_THRESHOLD][i] = community;
+            f1Scores[SWEEP_RANK_THRESHOLD][i] = thresholdF1Scores[bestThreshold][i];
+        }
+        printf ("Best threshold: %f\n", pageRankThreshold);
+    } else {
+        printf ("Best threshold: %f\n", 0.0);
+    }
+    return 0;
+}
+
+int PageRankMinConductanceNoF1(std::vector< NodeSet >& nodeNeighbors,
+                               std::vector< std::vector< NodePageRank > >& pageRankResult,
+                               std::vector< NodeSet >& seedSets,
+                               std::vector< NodeSet >& communities,
+                               const SweepLimits& limits,
+                               std::vector< uint32_t >& stopReasons) {
+    uint32_t nbCommunities = seedSets.size();
+    uint64_t graphVolume = ComputeGraphVolume(nodeNeighbors);
+    stopReasons.resize(nbCommunities);
+    for (uint32_t i = 0; i < nbCommunities; i++) {
+        DisplayProgress(((double) i) / (double) nbCommunities, 100);
+        std::vector< uint32_t > rankedNodes;
+        rankedNodes.reserve(pageRankResult[i].size());
+        for (std::vector< NodePageRank >::const_iterator it = pageRankResult[i].begin(); it != pageRankResult[i].end(); ++it) {
+            rankedNodes.push_back((*it).first);
+        }
+        stopReasons[i] = MinConductanceSweep(nodeNeighbors, seedSets[i], rankedNodes, limits, graphVolume, communities[i]);
     }
     std::cout << std::endl;
     return 0;
@@ -0,0 +1,151 @@
+#include "../include/scheduler.h"
+#include "../include/utils.h"
+#include <algorithm>
+
+// Estimated cost of the walk of a seed set: the walk touches the neighbors of the seeds at the first step and their
+// neighbors at the second one, so the cost grows with the sum of the seed degrees and with the two-hop volume
+// (sum of the degrees of the neighbors of the seeds). At least 1.
+uint64_t EstimateSeedSetCost(std::vector< NodeSet >& nodeNeighbors, const NodeSet& seedSet) {
+    uint64_t degreeSum = 0;
+    uint64_t twoHopVolume = 0;
+    for (NodeSet::const_iterator it = seedSet.begin(); it != seedSet.end(); ++it) {
+        const NodeSet& neighbors = nodeNeighbors[*it];
+        degreeSum += neighbors.size();
+        for (NodeSet::const_iterator it2 = neighbors.begin(); it2 != neighbors.end(); ++it2) {
+            twoHopVolume += nodeNeighbors[*it2].size();
+        }
+    }
+    return 1 + seedSet.size() + degreeSum + twoHopVolume;
+}
+
+struct SeedSetCostOrder {
+    const std::vector< uint64_t >& costs;
+    SeedSetCostOrder(const std::vector< uint64_t >& costs) : costs(costs) {}
+    bool operator()(uint32_t i, uint32_t j) const {
+        return costs[i] > costs[j] || (costs[i] == costs[j] && i < j);
+    }
+};
+
+SeedSetScheduler::SeedSetScheduler(std::vector< NodeSet >& nodeNeighbors, std::vector< NodeSet >& seedSets)
+    : costs(seedSets.size()), queues(omp_get_max_threads()), nbSteals(0) {
+    int64_t nbSeedSets = seedSets.size();
+#pragma omp parallel for schedule(dynamic, 64)
+    for (int64_t i = 0; i < nbSeedSets; i++) {
+        costs[i] = EstimateSeedSetCost(nodeNeighbors, seedSets[i]);
+    }
+    std::vector< uint32_t > order(nbSeedSets);
+    for (int64_t i = 0; i < nbSeedSets; i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), SeedSetCostOrder(costs));
+    for (std::vector< ThreadQueue >::iterator it = queues.begin(); it != queues.end(); ++it) {
+        it->remainingCost = 0;
+        omp_init_lock(&it->lock);
+        it->taskStart = 0.0;
+        it->busyTime = 0.0;
+        it->endTime = 0.0;
+    }
+    // largest first, each one to the least loaded thread
+    for (std::vector< uint32_t >::iterator it = order.begin(); it != order.end(); ++it) {
+        ThreadQueue* leastLoaded = &queues[0];
+        for (std::vector< ThreadQueue >::iterator it2 = queues.begin(); it2 != queues.end(); ++it2) {
+            if (it2->remainingCost < leastLoaded->remainingCost) {
+                leastLoaded = &*it2;
+            }
+        }
+        leastLoaded->seedSets.push_back(*it);
+        leastLoaded->remainingCost += costs[*it];
+    }
+    startTime = omp_get_wtime();
+}
+
+SeedSetScheduler::~SeedSetScheduler() {
+    for (std::vector< ThreadQueue >::iterator it = queues.begin(); it != queues.end(); ++it) {
+        omp_destroy_lock(&it->lock);
+    }
+}
+
+bool SeedSetScheduler::PopFront(ThreadQueue& queue, uint32_t& seedSetIndex) {
+    bool found = false;
+    omp_set_lock(&queue.lock);
+    if (!queue.seedSets.empty()) {
+        seedSetIndex = queue.seedSets.front();
+        queue.seedSets.pop_front();
+        uint64_t remainingCost = queue.remainingCost - costs[seedSetIndex];
+#pragma omp atomic write
+        queue.remainingCost = remainingCost;
+        found = true;
+    }
+    omp_unset_lock(&queue.lock);
+    return found;
+}
+
+bool SeedSetScheduler::Next(uint32_t& seedSetIndex) {
+    uint32_t thread = omp_get_thread_num();
+    ThreadQueue* own = thread < queues.size() ? &queues[thread] : NULL;
+    double now = omp_get_wtime();
+    if (own != NULL && own->taskStart > 0.0) {
+        own->busyTime += now - own->taskStart;
+        own->taskStart = 0.0;
+    }
+    bool found = own != NULL && PopFront(*own, seedSetIndex);
+    while (!found) {
+        // the deque with the most remaining work (read without its lock, so the choice is approximate)
+        ThreadQueue* victim = NULL;
+        uint64_t mostRemainingCost = 0;
+        for (std::vector< ThreadQueue >::iterator it = queues.begin(); it != queues.end(); ++it) {
+            uint64_t remainingCost;
+#pragma omp atomic read
+            remainingCost = it->remainingCost;
+            if (remainingCost > mostRemainingCost) {
+                mostRemainingCost = remainingCost;
+                victim = &*it;
+            }
+        }
+        if (victim == NULL) {
+            break;
+        }
+        found = PopFront(*victim, seedSetIndex);
+        if (found) {
+#pragma omp atomic
+            nbSteals++;
+        }
+    }
+    if (own != NULL) {
+        if (found) {
+            own->taskStart = omp_get_wtime();
+        } else {
+            own->endTime = omp_get_wtime();
+        }
+    }
+    return found;
+}
+
+double SeedSetScheduler::GetUtilization() {
+    double busyTime = 0.0;
+    double endTime = startTime;
+    uint32_t nbThreads = 0;
+    for (std::vector< ThreadQueue >::iterator it = queues.begin(); it != queues.end(); ++it) {
+        if (it->endTime > 0.0) {
+            busyTime += it->busyTime;
+            endTime = std::max(endTime, it->endTime);
+            nbThreads++;
+        }
+    }
+    if (nbThreads == 0 || endTime <= startTime) {
+        return 1.0;
+    }
+    return busyTime / (nbThreads * (endTime - startTime));
+}
+
+uint64_t SeedSetScheduler::GetNbSteals() {
+    return nbSteals;
+}
+
+void SeedSetScheduler::PrintUtilization() {
+    uint32_t nbThreads = 0;
+    for (std::vector< ThreadQueue >::iterator it = queues.begin(); it != queues.end(); ++it) {
+        nbThreads += it->endTime > 0.0;
+    }
+    printf("Scheduler: %u threads, %lu seed sets stolen, utilization %.1f%%\n", nbThreads, nbSteals, 100.0 * GetUtilization());
+}
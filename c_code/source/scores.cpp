@@ -1,15 +1,15 @@
 #include "../include/scores.h"
 
-uint32_t ComputeIntersectionSize(NodeSet community1, NodeSet community2) {
+uint32_t ComputeIntersectionSize(const NodeSet& community1, const NodeSet& community2) {
     uint32_t intersection = 0;
     if( community1.size() < community2.size() ) {
-        for( NodeSet::iterator iterCom1 = community1.begin(); iterCom1 != community1.end(); iterCom1++ ) {
+        for( NodeSet::const_iterator iterCom1 = community1.begin(); iterCom1 != community1.end(); iterCom1++ ) {
             if( community2.find( *iterCom1 ) != community2.end() ) {
                 intersection++;
             }
         }
     } else {
-        for( NodeSet::iterator iterCom2 = community2.begin(); iterCom2 != community2.end(); iterCom2++ ) {
+        for( NodeSet::const_iterator iterCom2 = community2.begin(); iterCom2 != community2.end(); iterCom2++ ) {
             if( community1.find( *iterCom2 ) != community1.end() ) {
                 intersection++;
             }
@@ -18,7 +18,7 @@ uint32_t ComputeIntersectionSize(NodeSet community1, NodeSet community2) {
     return intersection;
 }
 
-double ComputeF1Score(NodeSet community1, NodeSet community2) {
+double ComputeF1Score(const NodeSet& community1, const NodeSet& community2) {
     unsigned sizeIntersection = ComputeIntersectionSize(community1, community2);
     double sizecommunity1 = community1.size();
     double sizecommunity2 = community2.size();
@@ -47,6 +47,19 @@ double ComputeConductance(uint32_t degreeSum, uint32_t internalEdges) {
     return conductance;
 }
 
+const char* GetSweepObjectiveName(uint32_t objectiveId) {
+    switch (objectiveId) {
+        case SWEEP_MAX_F1:
+            return "maxf1";
+        case SWEEP_RANK_THRESHOLD:
+            return "threshold";
+        case SWEEP_CONDUCTANCE:
+            return "conductance";
+        default:
+            return "unknown";
+    }
+}
+
 int ComputeF1ScorePerSeed(std::vector< NodeSet >& seedSets,
                           std::vector< NodeSet >& groundTruthCommunities,
                           std::vector< NodeSet >& nodeGroundTruthCommunities,
@@ -0,0 +1,128 @@
+#include "../include/sweep.h"
+
+uint64_t ComputeGraphVolume(std::vector< NodeSet >& nodeNeighbors) {
+    uint64_t volume = 0;
+    for (std::vector< NodeSet >::iterator it = nodeNeighbors.begin(); it != nodeNeighbors.end(); ++it) {
+        volume += (*it).size();
+    }
+    return volume;
+}
+
+// Sweep over the ranked nodes, starting from the seed set, and keep the prefix of minimum conductance.
+// Returns the reason why the sweep stopped (the deadline of budgetTracker, if any, keeps the best prefix so far).
+//
+// Conductance bound: adding a node v of degree d(v) increases degreeSum by d(v) and internalEdges by at most d(v),
+// so (degreeSum / 2 - internalEdges) decreases by at most ceil(d(v) / 2). If h is the sum of ceil(d(v) / 2) over the
+// remaining nodes, every further prefix has a conductance of at least c / (degreeSum + remainingVolume + c),
+// with c = degreeSum / 2 - internalEdges - h. The sweep stops when this bound exceeds the best conductance,
+// which gives the same community as the full sweep.
+uint32_t MinConductanceSweep(std::vector< NodeSet >& nodeNeighbors,
+                             const NodeSet& seedSet,
+                             const std::vector< uint32_t >& rankedNodes,
+                             const SweepLimits& limits,
+                             uint64_t graphVolume,
+                             NodeSet& bestCommunity,
+                             QueryBudgetTracker* budgetTracker) {
+    NodeSet community(seedSet);
+    uint32_t internalEdges = 0;
+    uint32_t degreeSum = 0;
+    for (NodeSet::iterator it = community.begin(); it != community.end(); ++it) {
+        const NodeSet& neighborhood = nodeNeighbors[*it];
+        internalEdges += ComputeIntersectionSize(neighborhood, community);
+        degreeSum += neighborhood.size();
+    }
+    double bestConductance = ComputeConductance(degreeSum, internalEdges);
+    uint32_t bestLength = 0;
+    uint64_t remainingVolume = 0;
+    uint64_t remainingHalfVolume = 0;
+    if (limits.useConductanceBound) {
+        for (std::vector< uint32_t >::const_iterator it = rankedNodes.begin(); it != rankedNodes.end(); ++it) {
+            uint32_t degree = nodeNeighbors[*it].size();
+            remainingVolume += degree;
+            remainingHalfVolume += (degree + 1) / 2;
+        }
+    }
+    double maxVolume = limits.maxVolumeRatio * ((double) graphVolume);
+    uint32_t stopReason = STOP_END_OF_RANKING;
+    uint32_t length = 0;
+    for (std::vector< uint32_t >::const_iterator it = rankedNodes.begin(); it != rankedNodes.end(); ++it) {
+        if (limits.useConductanceBound) {
+            int64_t minCut = ((int64_t) (degreeSum / 2)) - ((int64_t) internalEdges) - ((int64_t) remainingHalfVolume);
+            if (minCut > 0) {
+                double minConductance = ((double) minCut) / (((double) degreeSum) + ((double) remainingVolume) + ((double) minCut));
+                if (minConductance > bestConductance) {
+                    stopReason = STOP_CONDUCTANCE_BOUND;
+                    break;
+                }
+            }
+        }
+        if (limits.patience > 0 && length - bestLength >= limits.patience) {
+            stopReason = STOP_PATIENCE;
+            break;
+        }
+        if (budgetTracker != NULL && !budgetTracker->BeforeDeadline()) {
+            stopReason = STOP_DEADLINE;
+            break;
+        }
+        uint32_t node = *it;
+        const NodeSet& neighborhood = nodeNeighbors[node];
+        if (((double) degreeSum) + ((double) neighborhood.size()) > maxVolume) {
+            stopReason = STOP_VOLUME_CAP;
+            break;
+        }
+        community.insert(node);
+        length++;
+        internalEdges += ComputeIntersectionSize(neighborhood, community);
+        degreeSum += neighborhood.size();
+        remainingVolume -= neighborhood.size();
+        remainingHalfVolume -= (neighborhood.size() + 1) / 2;
+        double conductance = ComputeConductance(degreeSum, internalEdges);
+        if (conductance <= bestConductance) {
+            bestLength = length;
+            bestConductance = conductance;
+        }
+    }
+    bestCommunity = seedSet;
+    for (uint32_t i = 0; i < bestLength; i++) {
+        bestCommunity.insert(rankedNodes[i]);
+    }
+    return stopReason;
+}
+
+const char* GetSweepStopReasonName(uint32_t stopReason) {
+    switch (stopReason) {
+        case STOP_END_OF_RANKING:
+            return "end-of-ranking";
+        case STOP_VOLUME_CAP:
+            return "volume-cap";
+        case STOP_PATIENCE:
+            return "patience";
+        case STOP_CONDUCTANCE_BOUND:
+            return "conductance-bound";
+        case STOP_DEADLINE:
+            return "deadline";
+        default:
+            return "unknown";
+    }
+}
+
+void PrintStopReasonSummary(std::vector< uint32_t >& stopReasons) {
+    std::vector< uint32_t > counts(NB_STOP_REASONS);
+    for (std::vector< uint32_t >::iterator it = stopReasons.begin(); it != stopReasons.end(); ++it) {
+        if (*it < NB_STOP_REASONS) {
+            counts[*it]++;
+        }
+    }
+    for (uint32_t i = 0; i < NB_STOP_REASONS; i++) {
+        printf("Sweeps stopped by %s: %u\n", GetSweepStopReasonName(i), counts[i]);
+    }
+}
+
+int PrintStopReasons(const char* fileName, std::vector< uint32_t >& stopReasons) {
+    ResultWriter writer(fileName);
+    for (std::vector< uint32_t >::iterator it = stopReasons.begin(); it != stopReasons.end(); ++it) {
+        writer.WriteString(GetSweepStopReasonName(*it));
+        writer.WriteChar('\n');
+    }
+    return writer.Close();
+}
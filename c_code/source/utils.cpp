@@ -86,6 +86,62 @@ int LoadCommunity(char * communityFileName, std::vector< NodeSet >& communities,
     return 0;
 }
 
+// Reads at most maxNbSeedSets seed sets (one per line, nodes separated by spaces or tabs) from inStream and
+// appends them to seeds, without the inverted index of LoadCommunity. Returns the number of seed sets read.
+uint32_t ReadSeedSets(std::istream& inStream, std::vector< NodeSet >& seeds, uint32_t maxNbSeedSets) {
+    std::string line;
+    uint32_t nbSeedSets = 0;
+    while (nbSeedSets < maxNbSeedSets && std::getline(inStream, line)) {
+        std::stringstream linestream(line);
+        uint32_t nodeId;
+        seeds.push_back(NodeSet());
+        while (linestream >> nodeId) {
+            seeds.back().insert(nodeId);
+        }
+        nbSeedSets++;
+    }
+    return nbSeedSets;
+}
+
+struct SeedSetIndexCompare {
+    const std::vector< NodeSet >& seeds;
+    SeedSetIndexCompare(const std::vector< NodeSet >& seeds) : seeds(seeds) {}
+    bool operator()(uint32_t i, uint32_t j) const {
+        return seeds[i] < seeds[j];
+    }
+};
+
+// Keeps one copy of each seed set in seeds, in order of first occurrence. seedSetIndex[i] receives the index in
+// the deduplicated seeds of the seed set that was at position i. Returns the number of distinct seed sets.
+uint32_t DeduplicateSeedSets(std::vector< NodeSet >& seeds, std::vector< uint32_t >& seedSetIndex) {
+    uint32_t nbSeedSets = seeds.size();
+    std::vector< uint32_t > order(nbSeedSets);
+    for (uint32_t i = 0; i < nbSeedSets; i++) {
+        order[i] = i;
+    }
+    // equal seed sets are contiguous, first occurrence first
+    std::stable_sort(order.begin(), order.end(), SeedSetIndexCompare(seeds));
+    std::vector< uint32_t > firstOccurrence(nbSeedSets);
+    for (uint32_t i = 0; i < nbSeedSets; i++) {
+        bool sameAsPrevious = i > 0 && seeds[order[i]] == seeds[order[i - 1]];
+        firstOccurrence[order[i]] = sameAsPrevious ? firstOccurrence[order[i - 1]] : order[i];
+    }
+    seedSetIndex.assign(nbSeedSets, 0);
+    uint32_t nbDistinctSeedSets = 0;
+    for (uint32_t i = 0; i < nbSeedSets; i++) {
+        if (firstOccurrence[i] == i) {
+            if (nbDistinctSeedSets != i) {
+                seeds[nbDistinctSeedSets].swap(seeds[i]);
+            }
+            seedSetIndex[i] = nbDistinctSeedSets++;
+        } else {
+            seedSetIndex[i] = seedSetIndex[firstOccurrence[i]];
+        }
+    }
+    seeds.resize(nbDistinctSeedSets);
+    return nbDistinctSeedSets;
+}
+
 int PickRandomSeedsInGroundTruth(std::vector< NodeSet >& communities, std::vector< NodeSet >& seeds, double proportion) {
     std::srand(std::time(0));
     for (std::vector< NodeSet >::iterator it1 = communities.begin(); it1 != communities.end(); ++it1) {
@@ -181,36 +237,43 @@ double GetAverage(std::vector< double >& vector) {
     return sum / ((double) vector.size());
 }
 
-int PrintPartition(const char* fileName, std::vector< NodeSet >& communities) {
-    std::ofstream outFile;
-    outFile.open(fileName);
-    for (std::vector< NodeSet >::iterator it1 = communities.begin(); it1 != communities.end(); ++it1) {
-        NodeSet::iterator it2 = (*it1).begin();
-        uint32_t nodeId;
-        while ( true ) {
-            nodeId = *it2;
-            ++it2;
-            if (it2 != (*it1).end()) {
-                outFile << nodeId << " ";
-            } else {
-                break;
-            }
+// One community per line, nodes separated by spaces
+int WriteCommunity(std::ostream& outStream, const NodeSet& community) {
+    for (NodeSet::const_iterator it = community.begin(); it != community.end(); ++it) {
+        if (it != community.begin()) {
+            outStream << " ";
         }
-        outFile << nodeId << std::endl;
+        outStream << *it;
     }
-    outFile.close();
+    outStream << "\n";
     return 0;
 }
 
+int PrintPartition(const char* fileName, std::vector< NodeSet >& communities) {
+    ResultWriter writer(fileName);
+    for (std::vector< NodeSet >::iterator it1 = communities.begin(); it1 != communities.end(); ++it1) {
+        writer.WriteCommunity(*it1);
+    }
+    return writer.Close();
+}
+
 int PrintVector(const char* fileName, std::vector< double >& vector) {
-    std::ofstream outFile;
-    outFile.open(fileName);
+    ResultWriter writer(fileName);
     for (std::vector< double >::iterator it = vector.begin();
          it != vector.end(); ++it) {
-        outFile << *it << std::endl;
+        writer.WriteDouble(*it);
+        writer.WriteChar('\n');
     }
-    outFile.close();
-    return 0;
+    return writer.Close();
+}
+
+// One line per seed set: 1 if its budget was exhausted (truncated community), 0 otherwise
+int PrintTruncatedFlags(const char* fileName, std::vector< uint8_t >& truncated) {
+    ResultWriter writer(fileName);
+    for (std::vector< uint8_t >::iterator it = truncated.begin(); it != truncated.end(); ++it) {
+        writer.WriteString(*it ? "1\n" : "0\n");
+    }
+    return writer.Close();
 }
 
 void PrintSet(NodeSet set) {
@@ -1,6 +1,352 @@
 #include "../include/walkscan.h"
 #include "../include/lexrank.h"
 #include "../include/utils.h"
+#include "../include/scheduler.h"
+#include <omp.h>
+
+template < uint32_t NbSteps >
+static bool WalkScanEmbeddingCompare(const std::pair< uint32_t, typename WalkEmbedding< NbSteps >::Type >& node1,
+                                     const std::pair< uint32_t, typename WalkEmbedding< NbSteps >::Type >& node2) {
+    return node1.second > node2.second;
+}
+
+// Random walk embedding of a seed set: the (at most maxNbNodes) best ranked nodes that are not seeds are listed
+// in nodeList, and nodeEmbedding(i, t - 1) is the probability that the walk is at nodeList[i] after t steps.
+// With a budget, the walk stops at the last step completed within it and the probabilities of the next steps are 0.
+// The probabilities of the steps are kept in walkBuffers.
+template < uint32_t NbSteps >
+static void WalkScanEmbedding(std::vector< NodeSet >& nodeNeighbors,
+                              NodeSet& seedSet,
+                              uint32_t nbSteps,
+                              WalkBuffers& walkBuffers,
+                              uint32_t maxNbNodes,
+                              std::vector< uint32_t >& nodeList,
+                              clustering::DBSCAN::ClusterData& nodeEmbedding,
+                              QueryBudgetTracker* budgetTracker = NULL) {
+    typedef typename WalkEmbedding< NbSteps >::Type Embedding;
+    const uint32_t steps = WalkEmbedding< NbSteps >::Size(nbSteps);
+    uint32_t seedSetSize = seedSet.size();
+    NodeSet walkSupport;
+    walkBuffers.Reset(steps + 1);
+    // Initialization of the walk from the seed nodes
+    for (NodeSet::iterator it2 = seedSet.begin(); it2 != seedSet.end(); ++it2) {
+            walkBuffers.Proba(0, walkBuffers.GetIndex(*it2)) = 1.0 / ((double) seedSetSize);
+            walkSupport.insert(*it2);
+    }
+    // For each step
+    uint32_t nbCompletedSteps = 0;
+    for (uint32_t t = 0; t < steps; t++) {
+        NodeSet nextWalkSupport(walkSupport);
+        bool withinBudget = true;
+        // For each node with a pagerank > 0 at the previous step
+        for (NodeSet::iterator it2 = walkSupport.begin(); it2 != walkSupport.end(); ++it2) {
+            const NodeSet& neighbors = nodeNeighbors[*it2];
+            if (budgetTracker != NULL && !budgetTracker->ChargeWalk(nextWalkSupport.size(), neighbors.size())) {
+                withinBudget = false;
+                break;
+            }
+            double degree = neighbors.size();
+            double proba1 = walkBuffers.Proba(t, walkBuffers.GetIndex(*it2));
+            for (NodeSet::iterator it3 = neighbors.begin();
+                 it3 != neighbors.end(); ++it3) {
+                // The walker goes to one of its neighbor with probability 1 / degree
+                uint32_t index2 = walkBuffers.GetIndex(*it3);
+                walkBuffers.Proba(t + 1, index2) += proba1 / degree;
+                nextWalkSupport.insert(*it3);
+            }
+        }
+        if (budgetTracker != NULL && withinBudget) {
+            withinBudget = budgetTracker->ChargeWalk(nextWalkSupport.size(), 0);
+        }
+        if (!withinBudget) {
+            break;
+        }
+        walkSupport = nextWalkSupport;
+        nbCompletedSteps++;
+    }
+    // Building output
+    std::vector< std::pair< uint32_t, Embedding > > nodeProba;
+    for (NodeSet::iterator it2 = walkSupport.begin(); it2 != walkSupport.end(); ++it2) {
+        uint32_t index = walkBuffers.GetIndex(*it2);
+        if (index >= seedSetSize) {
+            Embedding proba = WalkEmbedding< NbSteps >::Create(steps);
+            for (uint32_t t = 0; t < nbCompletedSteps; t++) {
+                proba[t] = walkBuffers.Proba(t + 1, index);
+            }
+            nodeProba.push_back(std::make_pair(*it2, proba));
+        }
+    }
+    std::sort(nodeProba.begin(), nodeProba.end(), WalkScanEmbeddingCompare< NbSteps >);
+    uint32_t nbNodes = nodeProba.size();
+    if (nbNodes > maxNbNodes) {
+        nbNodes = maxNbNodes;
+    }
+    nodeList.resize(nbNodes);
+    nodeEmbedding.resize(nbNodes, steps, false);
+    for (uint32_t nodeIndex = 0; nodeIndex < nbNodes; nodeIndex++) {
+        for (uint32_t t = 0; t < steps; t++) {
+            nodeEmbedding (nodeIndex, t) = nodeProba[nodeIndex].second[t];
+        }
+        nodeList[nodeIndex] = nodeProba[nodeIndex].first;
+    }
+}
+
+static bool WalkScanNodeIndexCompare(const std::pair< uint32_t, uint32_t >& nodeIndex, uint32_t node) {
+    return nodeIndex.first < node;
+}
+
+// Orders clusters by decreasing center (lexicographic order on the walk probabilities at steps 1..t)
+struct WalkScanCenterOrder {
+    const double* centers;
+    uint32_t steps;
+    bool operator()(uint32_t cluster1, uint32_t cluster2) const {
+        const double* center1 = centers + cluster1 * steps;
+        const double* center2 = centers + cluster2 * steps;
+        return std::lexicographical_compare(center2, center2 + steps, center1, center1 + steps);
+    }
+};
+
+// Clusters of a seed set from the DBSCAN labels of the embedded nodes: outliers are attached to neighboring clusters
+// and clusters are ordered by decreasing center.
+template < uint32_t NbSteps >
+static void WalkScanOrderedSets(std::vector< NodeSet >& nodeNeighbors,
+                                uint32_t nbSteps,
+                                std::vector< uint32_t >& nodeList,
+                                const clustering::DBSCAN::ClusterData& nodeEmbedding,
+                                const clustering::DBSCAN::Labels& labels,
+                                std::vector< NodeSet >& orderedWalkScanSets,
+                                WalkScanClusterBuffers& buffers) {
+    const uint32_t steps = WalkEmbedding< NbSteps >::Size(nbSteps);
+    uint32_t nbNodes = nodeList.size();
+    std::vector< std::pair< uint32_t, uint32_t > >& nodeIndices = buffers.nodeIndices;
+    std::vector< uint32_t >& clusterOffsets = buffers.clusterOffsets;
+    int32_t nbSets = 0;
+    nodeIndices.resize(nbNodes);
+    for (uint32_t nodeIndex = 0; nodeIndex < nbNodes; nodeIndex++) {
+        nodeIndices[nodeIndex] = std::make_pair(nodeList[nodeIndex], nodeIndex);
+        nbSets = std::max(nbSets, labels[nodeIndex] + 1);
+    }
+    std::sort(nodeIndices.begin(), nodeIndices.end());
+    // Cluster sizes: the nodes of each label, plus the outliers with a neighbor in the cluster
+    clusterOffsets.assign(nbSets + 1, 0);
+    buffers.attachments.clear();
+    buffers.lastOutlier.assign(nbSets, 0);
+    for (uint32_t i = 0; i < nbNodes; i++) {
+        int32_t label = labels[nodeIndices[i].second];
+        if (label >= 0) {
+            clusterOffsets[label + 1]++;
+            continue;
+        }
+        const NodeSet& neighborhood = nodeNeighbors[nodeIndices[i].first];
+        for (NodeSet::const_iterator it2 = neighborhood.begin(); it2 != neighborhood.end(); ++it2) {
+            std::vector< std::pair< uint32_t, uint32_t > >::const_iterator it3 =
+                std::lower_bound(nodeIndices.begin(), nodeIndices.end(), *it2, WalkScanNodeIndexCompare);
+            if (it3 == nodeIndices.end() || it3->first != *it2) {
+                continue;
+            }
+            int32_t cluster = labels[it3->second];
+            if (cluster >= 0 && buffers.lastOutlier[cluster] != i + 1) {
+                buffers.lastOutlier[cluster] = i + 1;
+                buffers.attachments.push_back(cluster);
+                clusterOffsets[cluster + 1]++;
+            }
+        }
+        buffers.attachments.push_back(-1);
+    }
+    for (int32_t cluster = 0; cluster < nbSets; cluster++) {
+        clusterOffsets[cluster + 1] += clusterOffsets[cluster];
+    }
+    // Flat cluster arrays and centers, filled in node order (the order of the sums is that of the NodeSets)
+    std::vector< uint32_t >& position = buffers.clusterOrder;
+    std::vector< double >& centers = buffers.centers;
+    position.assign(clusterOffsets.begin(), clusterOffsets.end() - 1);
+    buffers.clusterNodes.resize(clusterOffsets[nbSets]);
+    centers.assign(nbSets * steps, 0.0);
+    std::vector< int32_t >::const_iterator attachment = buffers.attachments.begin();
+    for (uint32_t i = 0; i < nbNodes; i++) {
+        uint32_t nodeIndex = nodeIndices[i].second;
+        int32_t label = labels[nodeIndex];
+        bool outlier = label < 0;
+        if (outlier) {
+            label = *(attachment++);
+        }
+        while (label >= 0) {
+            double clusterSize = clusterOffsets[label + 1] - clusterOffsets[label];
+            buffers.clusterNodes[position[label]++] = nodeIndex;
+            for (uint32_t t = 0; t < steps; t++) {
+                centers[label * steps + t] += nodeEmbedding(nodeIndex, t) / clusterSize;
+            }
+            label = outlier ? *(attachment++) : -1;
+        }
+    }
+    // Clusters by decreasing center
+    for (int32_t cluster = 0; cluster < nbSets; cluster++) {
+        position[cluster] = cluster;
+    }
+    WalkScanCenterOrder centerOrder = { centers.data(), steps };
+    std::sort(buffers.clusterOrder.begin(), buffers.clusterOrder.end(), centerOrder);
+    orderedWalkScanSets.clear();
+    orderedWalkScanSets.resize(nbSets);
+    for (int32_t rank = 0; rank < nbSets; rank++) {
+        uint32_t cluster = buffers.clusterOrder[rank];
+        NodeSet& walkScanSet = orderedWalkScanSets[rank];
+        for (uint32_t i = clusterOffsets[cluster]; i < clusterOffsets[cluster + 1]; i++) {
+            walkScanSet.insert(walkScanSet.end(), nodeList[buffers.clusterNodes[i]]);
+        }
+    }
+}
+
+// WalkSCAN for one seed set: random walk embedding, DBSCAN on the (at most maxNbNodes) best ranked nodes,
+// then outliers are attached to neighboring clusters and clusters are ordered by decreasing center.
+template < uint32_t NbSteps >
+static int WalkScanSeedSet(std::vector< NodeSet >& nodeNeighbors,
+                           NodeSet& seedSet,
+                           uint32_t nbSteps,
+                           std::vector< NodeSet >& orderedWalkScanSets,
+                           WalkBuffers& walkBuffers,
+                           double epsilon,
+                           uint32_t minElems,
+                           uint32_t maxNbNodes,
+                           const DbscanSettings& dbscanSettings,
+                           WalkScanClusterBuffers& clusterBuffers,
+                           std::vector< uint64_t >* neighborCountHistogram,
+                           QueryBudgetTracker* budgetTracker) {
+    const uint32_t steps = WalkEmbedding< NbSteps >::Size(nbSteps);
+    std::vector< uint32_t > nodeList;
+    clustering::DBSCAN::ClusterData nodeEmbedding;
+    WalkScanEmbedding< NbSteps >(nodeNeighbors, seedSet, nbSteps, walkBuffers, maxNbNodes, nodeList, nodeEmbedding, budgetTracker);
+    uint32_t nbNodes = nodeList.size();
+    if (nbNodes == 0) {
+        // the walk did not leave the seed set (isolated seeds, or no step within the budget)
+        orderedWalkScanSets.clear();
+        return 0;
+    }
+    // large supports are clustered in parallel, unless the seed sets are already processed in parallel
+    // (nbThreads = 1) or the embedding is 2-dimensional (the grid engine is faster)
+    uint32_t dbscanThreads = dbscanSettings.nbThreads > 0 ? dbscanSettings.nbThreads : omp_get_max_threads();
+    bool parallelDbscan = dbscanThreads > 1 && steps != 2 && nbNodes >= dbscanSettings.parallelMinSize;
+    clustering::DBSCAN dbs (epsilon, minElems, parallelDbscan ? dbscanThreads : 1);
+    dbs.count_neighbors(neighborCountHistogram != NULL);
+    if (budgetTracker != NULL) {
+        dbs.set_deadline(budgetTracker->GetDeadline());
+    }
+    if (dbscanSettings.rho > 0.0) {
+        dbs.fit_approximate(nodeEmbedding, dbscanSettings.rho);
+    } else if (dbscanSettings.memoryBudget > 0) {
+        dbs.fit_streaming(nodeEmbedding, dbscanSettings.memoryBudget);
+    } else if (dbscanSettings.quantized) {
+        dbs.fit_quantized(nodeEmbedding);
+    } else if (parallelDbscan) {
+        dbs.fit_parallel(nodeEmbedding);
+    } else if (steps == 2) {
+        dbs.fit_grid(nodeEmbedding);
+    } else {
+        dbs.fit_indexed(nodeEmbedding);
+    }
+    if (dbs.timed_out()) {
+        // no cluster: the community is the seed set
+        budgetTracker->SetTruncated();
+        orderedWalkScanSets.clear();
+        return 0;
+    }
+    if (neighborCountHistogram != NULL) {
+        const clustering::DBSCAN::Neighbors& neighborCounts = dbs.get_neighbor_counts();
+        for (std::vector< uint32_t >::const_iterator it2 = neighborCounts.begin(); it2 != neighborCounts.end(); ++it2) {
+            if (*it2 >= neighborCountHistogram->size()) {
+                neighborCountHistogram->resize(*it2 + 1);
+            }
+            (*neighborCountHistogram)[*it2]++;
+        }
+    }
+    WalkScanOrderedSets< NbSteps >(nodeNeighbors, nbSteps, nodeList, nodeEmbedding, dbs.get_labels(), orderedWalkScanSets, clusterBuffers);
+    return 0;
+}
+
+// WalkSCAN for one seed set and several values of epsilon: the random walk embedding and the neighborhoods of
+// DBSCAN are computed once, orderedWalkScanSets[e] receives the clusters for epsilons[e].
+template < uint32_t NbSteps >
+static int WalkScanEpsilonSweepSeedSet(std::vector< NodeSet >& nodeNeighbors,
+                                       NodeSet& seedSet,
+                                       uint32_t nbSteps,
+                                       std::vector< std::vector< NodeSet > >& orderedWalkScanSets,
+                                       WalkBuffers& walkBuffers,
+                                       const std::vector< double >& epsilons,
+                                       uint32_t minElems,
+                                       uint32_t maxNbNodes,
+                                       WalkScanClusterBuffers& clusterBuffers) {
+    std::vector< uint32_t > nodeList;
+    clustering::DBSCAN::ClusterData nodeEmbedding;
+    WalkScanEmbedding< NbSteps >(nodeNeighbors, seedSet, nbSteps, walkBuffers, maxNbNodes, nodeList, nodeEmbedding);
+    clustering::DBSCAN dbs (0.0, minElems, 1);
+    std::vector< clustering::DBSCAN::Labels > labels;
+    dbs.fit_eps_sweep(nodeEmbedding, epsilons, labels);
+    orderedWalkScanSets.resize(epsilons.size());
+    for (uint32_t e = 0; e < epsilons.size(); e++) {
+        WalkScanOrderedSets< NbSteps >(nodeNeighbors, nbSteps, nodeList, nodeEmbedding, labels[e], orderedWalkScanSets[e], clusterBuffers);
+    }
+    return 0;
+}
+
+// Fraction of the embedded nodes of a seed set that get the same DBSCAN label with the quantized embedding
+// as with the exact one (1 if no node is embedded).
+template < uint32_t NbSteps >
+static double WalkScanQuantizedLabelAgreementSeedSet(std::vector< NodeSet >& nodeNeighbors,
+                                                     NodeSet& seedSet,
+                                                     uint32_t nbSteps,
+                                                     WalkBuffers& walkBuffers,
+                                                     double epsilon,
+                                                     uint32_t minElems,
+                                                     uint32_t maxNbNodes) {
+    const uint32_t steps = WalkEmbedding< NbSteps >::Size(nbSteps);
+    std::vector< uint32_t > nodeList;
+    clustering::DBSCAN::ClusterData nodeEmbedding;
+    WalkScanEmbedding< NbSteps >(nodeNeighbors, seedSet, nbSteps, walkBuffers, maxNbNodes, nodeList, nodeEmbedding);
+    if (nodeList.empty()) {
+        return 1.0;
+    }
+    clustering::DBSCAN exactDbs (epsilon, minElems, 1);
+    clustering::DBSCAN quantizedDbs (epsilon, minElems, 1);
+    if (steps == 2) {
+        exactDbs.fit_grid(nodeEmbedding);
+    } else {
+        exactDbs.fit_indexed(nodeEmbedding);
+    }
+    quantizedDbs.fit_quantized(nodeEmbedding);
+    const clustering::DBSCAN::Labels& exactLabels = exactDbs.get_labels();
+    const clustering::DBSCAN::Labels& quantizedLabels = quantizedDbs.get_labels();
+    uint32_t nbAgreements = 0;
+    for (uint32_t nodeIndex = 0; nodeIndex < nodeList.size(); nodeIndex++) {
+        if (exactLabels[nodeIndex] == quantizedLabels[nodeIndex]) {
+            nbAgreements++;
+        }
+    }
+    return ((double) nbAgreements) / ((double) nodeList.size());
+}
+
+// Dispatches on the walk length: specialized instances for the usual values, generic version otherwise.
+static int WalkScanSeedSet(std::vector< NodeSet >& nodeNeighbors,
+                           NodeSet& seedSet,
+                           uint32_t nbSteps,
+                           std::vector< NodeSet >& orderedWalkScanSets,
+                           WalkBuffers& walkBuffers,
+                           double epsilon,
+                           uint32_t minElems,
+                           uint32_t maxNbNodes,
+                           const DbscanSettings& dbscanSettings,
+                           WalkScanClusterBuffers& clusterBuffers,
+                           std::vector< uint64_t >* neighborCountHistogram = NULL,
+                           QueryBudgetTracker* budgetTracker = NULL) {
+    switch (nbSteps) {
+        case 2:
+            return WalkScanSeedSet< 2 >(nodeNeighbors, seedSet, nbSteps, orderedWalkScanSets, walkBuffers, epsilon, minElems, maxNbNodes, dbscanSettings, clusterBuffers, neighborCountHistogram, budgetTracker);
+        case 3:
+            return WalkScanSeedSet< 3 >(nodeNeighbors, seedSet, nbSteps, orderedWalkScanSets, walkBuffers, epsilon, minElems, maxNbNodes, dbscanSettings, clusterBuffers, neighborCountHistogram, budgetTracker);
+        case 4:
+            return WalkScanSeedSet< 4 >(nodeNeighbors, seedSet, nbSteps, orderedWalkScanSets, walkBuffers, epsilon, minElems, maxNbNodes, dbscanSettings, clusterBuffers, neighborCountHistogram, budgetTracker);
+        default:
+            return WalkScanSeedSet< 0 >(nodeNeighbors, seedSet, nbSteps, orderedWalkScanSets, walkBuffers, epsilon, minElems, maxNbNodes, dbscanSettings, clusterBuffers, neighborCountHistogram, budgetTracker);
+    }
+}
 
 int WalkScan(std::vector< NodeSet >& nodeNeighbors,
              std::vector< NodeSet >& groundTruthCommunities,
@@ -10,137 +356,106 @@ int WalkScan(std::vector< NodeSet >& nodeNeighbors,
              uint32_t maxNodeId,
              double epsilon,
              uint32_t minElems,
-             bool useSizeLimit) {
+             bool useSizeLimit,
+             const DbscanSettings& dbscanSettings) {
     uint32_t counter = 0;
     uint32_t nbCommunities = seeds.size();
+    WalkBuffers walkBuffers;
+    WalkScanClusterBuffers clusterBuffers;
     for (std::vector< NodeSet >::iterator it1 = seeds.begin(); it1 != seeds.end(); ++it1) {
         DisplayProgress(((double) counter) / (double) nbCommunities, 100);
-        NodeSet seedSet(*it1);
-        uint32_t seedSetSize = seedSet.size();
-        NodeSet walkSupport;
-        std::vector <std::vector< double > > walkProba (nbSteps + 1);
-        std::vector< bool > isSeed (maxNodeId, false);
-        // Initialization of the walk from the seed nodes
-        walkProba[0].resize(maxNodeId + 1);
-        for (NodeSet::iterator it2 = seedSet.begin(); it2 != seedSet.end(); ++it2) {
-                walkProba[0][*it2] = 1.0 / ((double) seedSetSize);
-                walkSupport.insert(*it2);
-                isSeed[*it2] = true;
+        uint32_t maxNbNodes = UINT32_MAX;
+        if (useSizeLimit) {
+            maxNbNodes = 2 * groundTruthCommunities[counter].size();
         }
-        // For each step
-        for (uint32_t t = 0; t < nbSteps; t++) {
-            NodeSet nextWalkSupport(walkSupport);
-            walkProba[t + 1].resize(maxNodeId + 1);
-            // For each node with a pagerank > 0 at the previous step
-            for (NodeSet::iterator it2 = walkSupport.begin(); it2 != walkSupport.end(); ++it2) {
-                uint32_t node1 = *it2;
-                NodeSet neighbors = nodeNeighbors[node1];
-                double degree = neighbors.size();
-                for (NodeSet::iterator it3 = neighbors.begin();
-                     it3 != neighbors.end(); ++it3) {
-                    // The walker goes to one of its neighbor with probability 1 / degree
-                    uint32_t node2 = *it3;
-                    walkProba[t + 1][node2] += walkProba[t][node1] / degree;
-                    nextWalkSupport.insert(node2);
-                }
-            }
-            walkSupport = nextWalkSupport;
-        }
-        // Building output
-        std::vector< std::pair< uint32_t, std::vector< double > > > nodeProba;
-        for (NodeSet::iterator it2 = walkSupport.begin(); it2 != walkSupport.end(); ++it2) {
-            uint32_t node = *it2;
-            if (!isSeed[node]) {
-                std::vector< double > proba(nbSteps);
-                for (uint32_t t = 0; t < nbSteps; t++) {
-                    proba[t] = walkProba[t + 1][node];
-                }
-                nodeProba.push_back(std::make_pair(node, proba));
-            }
-        }
-        std::sort(nodeProba.begin(), nodeProba.end(), nodeLexRankCompare);
-        NodeSet groundTruthCommunity (groundTruthCommunities[counter]);
-        uint32_t groundTruthCommunitySize = groundTruthCommunity.size();
-        uint32_t walkSupportSize = walkSupport.size();
-        uint32_t nbNodes = walkSupportSize - seedSetSize;
-        uint32_t sizeLimit = 2 * groundTruthCommunitySize;
-        if (useSizeLimit && nbNodes > sizeLimit) {
-            nbNodes = sizeLimit;
+        walkScanResult.push_back(std::vector< NodeSet >());
+        WalkScanSeedSet(nodeNeighbors, *it1, nbSteps, walkScanResult.back(), walkBuffers, epsilon, minElems, maxNbNodes, dbscanSettings, clusterBuffers);
+        counter++;
+    }
+    return 0;
+}
+
+// WalkSCAN for a list of epsilon values: walkScanResults[e] is the result of WalkScan for epsilons[e],
+// but the random walks and the DBSCAN neighborhoods are only computed once per seed set.
+int WalkScanEpsilonSweep(std::vector< NodeSet >& nodeNeighbors,
+                         std::vector< NodeSet >& groundTruthCommunities,
+                         std::vector< NodeSet >& seeds,
+                         uint32_t nbSteps,
+                         std::vector< std::vector< std::vector< NodeSet > > >& walkScanResults,
+                         uint32_t maxNodeId,
+                         const std::vector< double >& epsilons,
+                         uint32_t minElems,
+                         bool useSizeLimit) {
+    uint32_t counter = 0;
+    uint32_t nbCommunities = seeds.size();
+    WalkBuffers walkBuffers;
+    WalkScanClusterBuffers clusterBuffers;
+    walkScanResults.assign(epsilons.size(), std::vector< std::vector< NodeSet > >());
+    for (std::vector< NodeSet >::iterator it1 = seeds.begin(); it1 != seeds.end(); ++it1) {
+        DisplayProgress(((double) counter) / (double) nbCommunities, 100);
+        uint32_t maxNbNodes = UINT32_MAX;
+        if (useSizeLimit) {
+            maxNbNodes = 2 * groundTruthCommunities[counter].size();
         }
-        std::vector< uint32_t > nodeList(nbNodes);
-        ublas::matrix <double, ublas::row_major, ublas::unbounded_array< double > > nodeEmbedding(nbNodes, nbSteps);
-        uint32_t nodeIndex = 0;
-        for (std::vector<std::pair<uint32_t, std::vector< double > > >::iterator it2 = nodeProba.begin();
-             it2 != nodeProba.end(); ++it2) {
-            uint32_t node = (*it2).first;
-            if (nodeIndex >= nbNodes) {
+        std::vector< std::vector< NodeSet > > orderedWalkScanSets;
+        switch (nbSteps) {
+            case 2:
+                WalkScanEpsilonSweepSeedSet< 2 >(nodeNeighbors, *it1, nbSteps, orderedWalkScanSets, walkBuffers, epsilons, minElems, maxNbNodes, clusterBuffers);
                 break;
-            } else if (!isSeed[node]) {
-                for (uint32_t t = 0; t < nbSteps; t++) {
-                    nodeEmbedding (nodeIndex, t) = (*it2).second[t];
-                }
-                nodeList[nodeIndex] = node;
-                nodeIndex++;
-            }
-        }
-        clustering::DBSCAN dbs (epsilon, minElems, 1);
-        dbs.fit(nodeEmbedding);
-        clustering::DBSCAN::Labels labels = dbs.get_labels();
-        std::vector< NodeSet > walkScanSets;
-        std::vector< int > nodeSet (maxNodeId + 1, -1);
-        NodeSet outliers;
-        int32_t nbSets = 0;
-        nodeIndex = 0;
-        for (std::vector<int32_t>::iterator it2 = labels.begin(); it2 != labels.end(); it2++) {
-            if (*it2 < 0) {
-                outliers.insert(nodeList[nodeIndex]);
-            } else if (*it2 >= nbSets) {
-                walkScanSets.resize(*it2 + 1);
-                nbSets = *it2 + 1;
-                uint32_t node = nodeList[nodeIndex];
-                walkScanSets[*it2].insert(node);
-                nodeSet[node] = *it2;
-            } else {
-                uint32_t node = nodeList[nodeIndex];
-                walkScanSets[*it2].insert(node);
-                nodeSet[node] = *it2;
-            }
-            nodeIndex++;
+            case 3:
+                WalkScanEpsilonSweepSeedSet< 3 >(nodeNeighbors, *it1, nbSteps, orderedWalkScanSets, walkBuffers, epsilons, minElems, maxNbNodes, clusterBuffers);
+                break;
+            case 4:
+                WalkScanEpsilonSweepSeedSet< 4 >(nodeNeighbors, *it1, nbSteps, orderedWalkScanSets, walkBuffers, epsilons, minElems, maxNbNodes, clusterBuffers);
+                break;
+            default:
+                WalkScanEpsilonSweepSeedSet< 0 >(nodeNeighbors, *it1, nbSteps, orderedWalkScanSets, walkBuffers, epsilons, minElems, maxNbNodes, clusterBuffers);
         }
-        for (NodeSet::iterator it2 = outliers.begin();
-             it2 != outliers.end(); it2++) {
-            uint32_t node = *it2;
-            NodeSet neighborhood = nodeNeighbors[node];
-            for (NodeSet::iterator it3 = neighborhood.begin();
-                 it3 != neighborhood.end(); ++it3) {
-                if (nodeSet[*it3] >= 0) {
-                    walkScanSets[nodeSet[*it3]].insert(node);
-                }
-            }
+        for (uint32_t e = 0; e < epsilons.size(); e++) {
+            walkScanResults[e].push_back(std::vector< NodeSet >());
+            walkScanResults[e].back().swap(orderedWalkScanSets[e]);
         }
-        std::vector <NodeSetLexRank > walkScanSetCenters;
-        for (std::vector< NodeSet >::iterator it2 = walkScanSets.begin(); it2 != walkScanSets.end(); it2++) {
-            NodeSet cluster = (*it2);
-            double clusterSize = cluster.size();
-            std::vector< double > center (nbSteps);
-            for (NodeSet::iterator it3 = cluster.begin();
-                 it3 != cluster.end(); it3++) {
-                uint32_t node = (*it3);
-                for (uint32_t t = 0; t < nbSteps; t++) {
-                    center[t] += walkProba[t + 1][node] / clusterSize;
-                }
-            }
-            walkScanSetCenters.push_back(std::make_pair(cluster, center));
+        counter++;
+    }
+    std::cout << std::endl;
+    return 0;
+}
+
+// Validation of the quantized DBSCAN: labelAgreement[i] is the fraction of the embedded nodes of seed set i
+// with the same label as with the exact DBSCAN of WalkScan (labels are numbered canonically by both).
+int WalkScanQuantizedLabelAgreement(std::vector< NodeSet >& nodeNeighbors,
+                                    std::vector< NodeSet >& groundTruthCommunities,
+                                    std::vector< NodeSet >& seeds,
+                                    uint32_t nbSteps,
+                                    std::vector< double >& labelAgreement,
+                                    uint32_t maxNodeId,
+                                    double epsilon,
+                                    uint32_t minElems,
+                                    bool useSizeLimit) {
+    uint32_t nbCommunities = seeds.size();
+    labelAgreement.resize(nbCommunities);
+    WalkBuffers walkBuffers;
+    for (uint32_t i = 0; i < nbCommunities; i++) {
+        DisplayProgress(((double) i) / (double) nbCommunities, 100);
+        uint32_t maxNbNodes = UINT32_MAX;
+        if (useSizeLimit) {
+            maxNbNodes = 2 * groundTruthCommunities[i].size();
         }
-        std::sort(walkScanSetCenters.begin(), walkScanSetCenters.end(), WalkScanCenterCompare);
-        std::vector< NodeSet > orderedWalkScanSets;
-        for (std::vector <NodeSetLexRank >::iterator it2 = walkScanSetCenters.begin();
-             it2 != walkScanSetCenters.end(); it2++ ) {
-            orderedWalkScanSets.push_back((*it2).first);
+        switch (nbSteps) {
+            case 2:
+                labelAgreement[i] = WalkScanQuantizedLabelAgreementSeedSet< 2 >(nodeNeighbors, seeds[i], nbSteps, walkBuffers, epsilon, minElems, maxNbNodes);
+                break;
+            case 3:
+                labelAgreement[i] = WalkScanQuantizedLabelAgreementSeedSet< 3 >(nodeNeighbors, seeds[i], nbSteps, walkBuffers, epsilon, minElems, maxNbNodes);
+                break;
+            case 4:
+                labelAgreement[i] = WalkScanQuantizedLabelAgreementSeedSet< 4 >(nodeNeighbors, seeds[i], nbSteps, walkBuffers, epsilon, minElems, maxNbNodes);
+                break;
+            default:
+                labelAgreement[i] = WalkScanQuantizedLabelAgreementSeedSet< 0 >(nodeNeighbors, seeds[i], nbSteps, walkBuffers, epsilon, minElems, maxNbNodes);
         }
-        walkScanResult.push_back(orderedWalkScanSets);
-        counter++;
     }
+    std::cout << std::endl;
     return 0;
 }
 
@@ -295,129 +610,17 @@ int WalkScanNoGroundTruth(std::vector< NodeSet >& nodeNeighbors,
                           std::vector< std::vector< NodeSet > > & walkScanResult,
                           uint32_t maxNodeId,
                           double epsilon,
-                          uint32_t minElems) {
+                          uint32_t minElems,
+                          const DbscanSettings& dbscanSettings,
+                          std::vector< uint64_t >* neighborCountHistogram) {
     uint32_t counter = 0;
     uint32_t nbCommunities = seeds.size();
+    WalkBuffers walkBuffers;
+    WalkScanClusterBuffers clusterBuffers;
     for (std::vector< NodeSet >::iterator it1 = seeds.begin(); it1 != seeds.end(); ++it1) {
         DisplayProgress(((double) counter) / (double) nbCommunities, 100);
-        NodeSet seedSet(*it1);
-        uint32_t seedSetSize = seedSet.size();
-        NodeSet walkSupport;
-        std::vector <std::vector< double > > walkProba (nbSteps + 1);
-        std::vector< bool > isSeed (maxNodeId, false);
-        // Initialization of the walk from the seed nodes
-        walkProba[0].resize(maxNodeId + 1);
-        for (NodeSet::iterator it2 = seedSet.begin(); it2 != seedSet.end(); ++it2) {
-                walkProba[0][*it2] = 1.0 / ((double) seedSetSize);
-                walkSupport.insert(*it2);
-                isSeed[*it2] = true;
-        }
-        // For each step
-        for (uint32_t t = 0; t < nbSteps; t++) {
-            NodeSet nextWalkSupport(walkSupport);
-            walkProba[t + 1].resize(maxNodeId + 1);
-            // For each node with a pagerank > 0 at the previous step
-            for (NodeSet::iterator it2 = walkSupport.begin(); it2 != walkSupport.end(); ++it2) {
-                uint32_t node1 = *it2;
-                NodeSet neighbors = nodeNeighbors[node1];
-                double degree = neighbors.size();
-                for (NodeSet::iterator it3 = neighbors.begin();
-                     it3 != neighbors.end(); ++it3) {
-                    // The walker goes to one of its neighbor with probability 1 / degree
-                    uint32_t node2 = *it3;
-                    walkProba[t + 1][node2] += walkProba[t][node1] / degree;
-                    nextWalkSupport.insert(node2);
-                }
-            }
-            walkSupport = nextWalkSupport;
-        }
-        // Building output
-        std::vector< std::pair< uint32_t, std::vector< double > > > nodeProba;
-        for (NodeSet::iterator it2 = walkSupport.begin(); it2 != walkSupport.end(); ++it2) {
-            uint32_t node = *it2;
-            if (!isSeed[node]) {
-                std::vector< double > proba(nbSteps);
-                for (uint32_t t = 0; t < nbSteps; t++) {
-                    proba[t] = walkProba[t + 1][node];
-                }
-                nodeProba.push_back(std::make_pair(node, proba));
-            }
-        }
-        std::sort(nodeProba.begin(), nodeProba.end(), nodeLexRankCompare);
-        uint32_t walkSupportSize = walkSupport.size();
-        uint32_t nbNodes = walkSupportSize - seedSetSize;
-        std::vector< uint32_t > nodeList(nbNodes);
-        ublas::matrix <double, ublas::row_major, ublas::unbounded_array< double > > nodeEmbedding(nbNodes, nbSteps);
-        uint32_t nodeIndex = 0;
-        for (std::vector<std::pair<uint32_t, std::vector< double > > >::iterator it2 = nodeProba.begin();
-             it2 != nodeProba.end(); ++it2) {
-            uint32_t node = (*it2).first;
-            if (nodeIndex >= nbNodes) {
-                break;
-            } else if (!isSeed[node]) {
-                for (uint32_t t = 0; t < nbSteps; t++) {
-                    nodeEmbedding (nodeIndex, t) = (*it2).second[t];
-                }
-                nodeList[nodeIndex] = node;
-                nodeIndex++;
-            }
-        }
-        clustering::DBSCAN dbs (epsilon, minElems, 1);
-        dbs.fit(nodeEmbedding);
-        clustering::DBSCAN::Labels labels = dbs.get_labels();
-        std::vector< NodeSet > walkScanSets;
-        std::vector< int > nodeSet (maxNodeId + 1, -1);
-        NodeSet outliers;
-        int32_t nbSets = 0;
-        nodeIndex = 0;
-        for (std::vector<int32_t>::iterator it2 = labels.begin(); it2 != labels.end(); it2++) {
-            if (*it2 < 0) {
-                outliers.insert(nodeList[nodeIndex]);
-            } else if (*it2 >= nbSets) {
-                walkScanSets.resize(*it2 + 1);
-                nbSets = *it2 + 1;
-                uint32_t node = nodeList[nodeIndex];
-                walkScanSets[*it2].insert(node);
-                nodeSet[node] = *it2;
-            } else {
-                uint32_t node = nodeList[nodeIndex];
-                walkScanSets[*it2].insert(node);
-                nodeSet[node] = *it2;
-            }
-            nodeIndex++;
-        }
-        for (NodeSet::iterator it2 = outliers.begin();
-             it2 != outliers.end(); it2++) {
-            uint32_t node = *it2;
-            NodeSet neighborhood = nodeNeighbors[node];
-            for (NodeSet::iterator it3 = neighborhood.begin();
-                 it3 != neighborhood.end(); ++it3) {
-                if (nodeSet[*it3] >= 0) {
-                    walkScanSets[nodeSet[*it3]].insert(node);
-                }
-            }
-        }
-        std::vector <NodeSetLexRank > walkScanSetCenters;
-        for (std::vector< NodeSet >::iterator it2 = walkScanSets.begin(); it2 != walkScanSets.end(); it2++) {
-            NodeSet cluster = (*it2);
-            double clusterSize = cluster.size();
-            std::vector< double > center (nbSteps);
-            for (NodeSet::iterator it3 = cluster.begin();
-                 it3 != cluster.end(); it3++) {
-                uint32_t node = (*it3);
-                for (uint32_t t = 0; t < nbSteps; t++) {
-                    center[t] += walkProba[t + 1][node] / clusterSize;
-                }
-            }
-            walkScanSetCenters.push_back(std::make_pair(cluster, center));
-        }
-        std::sort(walkScanSetCenters.begin(), walkScanSetCenters.end(), WalkScanCenterCompare);
-        std::vector< NodeSet > orderedWalkScanSets;
-        for (std::vector <NodeSetLexRank >::iterator it2 = walkScanSetCenters.begin();
-             it2 != walkScanSetCenters.end(); it2++ ) {
-            orderedWalkScanSets.push_back((*it2).first);
-        }
-        walkScanResult.push_back(orderedWalkScanSets);
+        walkScanResult.push_back(std::vector< NodeSet >());
+        WalkScanSeedSet(nodeNeighbors, *it1, nbSteps, walkScanResult.back(), walkBuffers, epsilon, minElems, UINT32_MAX, dbscanSettings, clusterBuffers, neighborCountHistogram);
         counter++;
     }
     return 0;
@@ -441,3 +644,125 @@ int WalkScanFirstCommunity(std::vector< std::vector< NodeSet > > & walkScanResul
     std::cout << std::endl;
     return 0;
 }
+
+// All the WalkSCAN communities of one seed set, ordered by decreasing center (the seeds are not added), with
+// DBSCAN on a single thread, within the budget of budgetTracker if any, with the buffers of the calling thread.
+int WalkScanCommunitiesSeedSet(std::vector< NodeSet >& nodeNeighbors,
+                               NodeSet& seedSet,
+                               uint32_t nbSteps,
+                               std::vector< NodeSet >& orderedWalkScanSets,
+                               WalkBuffers& walkBuffers,
+                               WalkScanClusterBuffers& clusterBuffers,
+                               double epsilon,
+                               uint32_t minElems,
+                               const DbscanSettings& dbscanSettings,
+                               QueryBudgetTracker* budgetTracker) {
+    DbscanSettings threadDbscanSettings(dbscanSettings);
+    threadDbscanSettings.nbThreads = 1;
+    orderedWalkScanSets.clear();
+    return WalkScanSeedSet(nodeNeighbors, seedSet, nbSteps, orderedWalkScanSets, walkBuffers, epsilon, minElems, UINT32_MAX, threadDbscanSettings, clusterBuffers,
+                           NULL, budgetTracker);
+}
+
+// First WalkSCAN community of one seed set (the seeds included), as above.
+int WalkScanFirstCommunitySeedSet(std::vector< NodeSet >& nodeNeighbors,
+                                  NodeSet& seedSet,
+                                  uint32_t nbSteps,
+                                  NodeSet& community,
+                                  WalkBuffers& walkBuffers,
+                                  WalkScanClusterBuffers& clusterBuffers,
+                                  double epsilon,
+                                  uint32_t minElems,
+                                  const DbscanSettings& dbscanSettings,
+                                  QueryBudgetTracker* budgetTracker) {
+    std::vector< NodeSet > orderedWalkScanSets;
+    WalkScanCommunitiesSeedSet(nodeNeighbors, seedSet, nbSteps, orderedWalkScanSets, walkBuffers, clusterBuffers, epsilon, minElems, dbscanSettings,
+                               budgetTracker);
+    community.clear();
+    if (orderedWalkScanSets.size() > 0) {
+        community.swap(orderedWalkScanSets[0]);
+    }
+    community.insert(seedSet.begin(), seedSet.end());
+    return 0;
+}
+
+// Pipelined WalkSCAN: the clusters of each seed set are reduced to the first community as soon as they are
+// computed, so that only the final communities are kept. Seed sets are processed in parallel, each thread with its
+// own walk and cluster buffers.
+int WalkScanFirstCommunityPipeline(std::vector< NodeSet >& nodeNeighbors,
+                                   std::vector< NodeSet >& seeds,
+                                   uint32_t nbSteps,
+                                   std::vector< NodeSet >& communities,
+                                   uint32_t maxNodeId,
+                                   double epsilon,
+                                   uint32_t minElems,
+                                   const DbscanSettings& dbscanSettings,
+                                   std::vector< uint64_t >* neighborCountHistogram) {
+    int64_t nbCommunities = seeds.size();
+    uint32_t counter = 0;
+    // the seed sets are processed in parallel, so each DBSCAN runs on one thread
+    DbscanSettings threadDbscanSettings(dbscanSettings);
+    threadDbscanSettings.nbThreads = 1;
+    // one histogram per thread, merged at the end
+    std::vector< std::vector< uint64_t > > threadHistograms (omp_get_max_threads());
+    std::vector< WalkBuffers > threadWalkBuffers (omp_get_max_threads());
+    std::vector< WalkScanClusterBuffers > threadClusterBuffers (omp_get_max_threads());
+    SeedSetScheduler scheduler(nodeNeighbors, seeds);
+#pragma omp parallel
+    for (uint32_t i; scheduler.Next(i); ) {
+        std::vector< NodeSet > orderedWalkScanSets;
+        std::vector< uint64_t >* threadHistogram = NULL;
+        if (neighborCountHistogram != NULL) {
+            threadHistogram = &threadHistograms[omp_get_thread_num()];
+        }
+        WalkScanSeedSet(nodeNeighbors, seeds[i], nbSteps, orderedWalkScanSets, threadWalkBuffers[omp_get_thread_num()], epsilon, minElems, UINT32_MAX, threadDbscanSettings, threadClusterBuffers[omp_get_thread_num()], threadHistogram);
+        NodeSet community;
+        if (orderedWalkScanSets.size() > 0) {
+            community.swap(orderedWalkScanSets[0]);
+        }
+        community.insert(seeds[i].begin(), seeds[i].end());
+        communities[i].swap(community);
+        uint32_t done;
+#pragma omp atomic capture
+        done = ++counter;
+        if (omp_get_thread_num() == 0) {
+            DisplayProgress(((double) done) / (double) nbCommunities, 100);
+        }
+    }
+    std::cout << std::endl;
+    scheduler.PrintUtilization();
+    if (neighborCountHistogram != NULL) {
+        for (std::vector< std::vector< uint64_t > >::iterator it = threadHistograms.begin(); it != threadHistograms.end(); ++it) {
+            if (it->size() > neighborCountHistogram->size()) {
+                neighborCountHistogram->resize(it->size());
+            }
+            for (size_t count = 0; count < it->size(); count++) {
+                (*neighborCountHistogram)[count] += (*it)[count];
+            }
+        }
+    }
+    return 0;
+}
+
+// For each number of eps-neighbors (the node included), the number of nodes with exactly that many neighbors
+// and the number of nodes with at least that many, i.e. the core nodes if --min-elems were set to that value.
+int PrintNeighborCountHistogram(const char* fileName, std::vector< uint64_t >& neighborCountHistogram) {
+    ResultWriter writer(fileName);
+    writer.WriteString("neighbors\tnodes\tcore_nodes\n");
+    uint64_t coreNodes = 0;
+    for (std::vector< uint64_t >::iterator it = neighborCountHistogram.begin(); it != neighborCountHistogram.end(); ++it) {
+        coreNodes += *it;
+    }
+    for (size_t count = 1; count < neighborCountHistogram.size(); count++) {
+        if (neighborCountHistogram[count] > 0) {
+            writer.WriteUInt(count);
+            writer.WriteChar('\t');
+            writer.WriteUInt(neighborCountHistogram[count]);
+            writer.WriteChar('\t');
+            writer.WriteUInt(coreNodes);
+            writer.WriteChar('\n');
+        }
+        coreNodes -= neighborCountHistogram[count];
+    }
+    return writer.Close();
+}
@@ -0,0 +1,117 @@
+#include "../include/cache.h"
+#include <stdio.h>
+#include <utility>
+
+// memory of an entry besides its vectors (list and index nodes, allocator headers)
+static const uint64_t entryOverhead = 128;
+
+CommunityCache::CommunityCache(uint64_t memoryBudget)
+    : memoryBudget(memoryBudget), memoryUsage(0), nbHits(0), nbMisses(0) {
+    omp_init_lock(&lock);
+}
+
+CommunityCache::~CommunityCache() {
+    omp_destroy_lock(&lock);
+}
+
+// FNV-1a
+uint64_t CommunityCache::Hash(const std::vector< uint32_t >& key) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (std::vector< uint32_t >::const_iterator it = key.begin(); it != key.end(); ++it) {
+        for (uint32_t byte = 0; byte < 4; byte++) {
+            hash ^= (*it >> (8 * byte)) & 0xff;
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+bool CommunityCache::Lookup(const std::vector< uint32_t >& key, NodeSet& community, uint32_t& stopReason) {
+    uint64_t hash = Hash(key);
+    bool found = false;
+    omp_set_lock(&lock);
+    std::map< uint64_t, std::list< Entry >::iterator >::iterator it = entryIndex.find(hash);
+    if (it != entryIndex.end() && it->second->key == key) {
+        // most recently used
+        entries.splice(entries.begin(), entries, it->second);
+        community.clear();
+        community.insert(it->second->community.begin(), it->second->community.end());
+        stopReason = it->second->stopReason;
+        found = true;
+        nbHits++;
+    } else {
+        nbMisses++;
+    }
+    omp_unset_lock(&lock);
+    return found;
+}
+
+void CommunityCache::Insert(const std::vector< uint32_t >& key, const NodeSet& community, uint32_t stopReason) {
+    Entry entry;
+    entry.hash = Hash(key);
+    entry.key = key;
+    entry.community.assign(community.begin(), community.end());
+    entry.stopReason = stopReason;
+    entry.size = sizeof(Entry) + entryOverhead + sizeof(uint32_t) * (entry.key.size() + entry.community.size());
+    if (entry.size > memoryBudget) {
+        return;
+    }
+    omp_set_lock(&lock);
+    std::map< uint64_t, std::list< Entry >::iterator >::iterator it = entryIndex.find(entry.hash);
+    if (it != entryIndex.end()) {
+        // already inserted by another thread, or a collision: the new entry replaces the old one
+        memoryUsage -= it->second->size;
+        entries.erase(it->second);
+        entryIndex.erase(it);
+    }
+    Evict(memoryBudget - entry.size);
+    memoryUsage += entry.size;
+    entries.push_front(std::move(entry));
+    entryIndex[entries.front().hash] = entries.begin();
+    omp_unset_lock(&lock);
+}
+
+// Removes the least recently used entries until the memory usage is at most targetUsage (lock held)
+void CommunityCache::Evict(uint64_t targetUsage) {
+    while (memoryUsage > targetUsage && !entries.empty()) {
+        memoryUsage -= entries.back().size;
+        entryIndex.erase(entries.back().hash);
+        entries.pop_back();
+    }
+}
+
+uint64_t CommunityCache::GetNbHits() {
+    omp_set_lock(&lock);
+    uint64_t value = nbHits;
+    omp_unset_lock(&lock);
+    return value;
+}
+
+uint64_t CommunityCache::GetNbMisses() {
+    omp_set_lock(&lock);
+    uint64_t value = nbMisses;
+    omp_unset_lock(&lock);
+    return value;
+}
+
+uint64_t CommunityCache::GetNbEntries() {
+    omp_set_lock(&lock);
+    uint64_t value = entries.size();
+    omp_unset_lock(&lock);
+    return value;
+}
+
+uint64_t CommunityCache::GetMemoryUsage() {
+    omp_set_lock(&lock);
+    uint64_t value = memoryUsage;
+    omp_unset_lock(&lock);
+    return value;
+}
+
+void CommunityCache::PrintStatistics() {
+    omp_set_lock(&lock);
+    uint64_t nbLookups = nbHits + nbMisses;
+    printf("Cache: %lu hits, %lu misses (hit rate %.1f%%), %lu communities in %.1f MB\n", nbHits, nbMisses,
+           nbLookups > 0 ? 100.0 * nbHits / nbLookups : 0.0, entries.size(), memoryUsage / 1048576.0);
+    omp_unset_lock(&lock);
+}
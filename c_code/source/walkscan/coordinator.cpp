@@ -0,0 +1,414 @@
+#include "../include/coordinator.h"
+#include <omp.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+// Protocol between the coordinator and its workers, over a socket pair per worker. The coordinator sends a range
+// of seed sets as one line "<first> <end>" (indices in the input, end excluded), and the worker answers one line
+// per seed set of the range, in order: the stop reason of the sweep, a space, 1 if the budget was exhausted (0
+// otherwise), a tab and the nodes of the community (as in the -communities.txt files). A worker stops when the
+// coordinator closes its end of the socket.
+
+struct CoordinatorWorker {
+    pid_t pid;
+    int socketFd;
+    bool busy;
+    uint64_t rangeBegin;
+    uint64_t rangeEnd;
+    std::string pending;                   // received bytes after the last complete line
+    std::vector< std::string > answers;    // lines received for the current range
+};
+
+// Lines of a range whose answers are all received, or of a range lost with its worker (no lines)
+struct CoordinatorRange {
+    uint64_t rangeEnd;
+    bool lost;
+    std::vector< std::string > answers;
+};
+
+static bool SendAll(int socketFd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t nbBytes = send(socketFd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (nbBytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nbBytes <= 0) {
+            return false;
+        }
+        sent += nbBytes;
+    }
+    return true;
+}
+
+// Loop of a worker process: computes the communities of the ranges it receives, one seed set at a time
+// (the parallelism is that of the workers, the OpenMP runtime of the coordinator is not used after the fork)
+static void RunWorker(int socketFd,
+                      uint32_t algorithmId,
+                      std::vector< NodeSet >& nodeNeighbors,
+                      std::vector< NodeSet >& seeds,
+                      uint32_t maxNodeId,
+                      uint64_t graphVolume,
+                      const QuerySettings& settings) {
+    std::string pending;
+    char buffer[256];
+    QueryBuffers buffers;
+    while (true) {
+        size_t lineEnd = pending.find('\n');
+        if (lineEnd == std::string::npos) {
+            ssize_t nbBytes = recv(socketFd, buffer, sizeof(buffer), 0);
+            if (nbBytes < 0 && errno == EINTR) {
+                continue;
+            }
+            if (nbBytes <= 0) {
+                return;
+            }
+            pending.append(buffer, nbBytes);
+            continue;
+        }
+        std::istringstream range(pending.substr(0, lineEnd));
+        pending.erase(0, lineEnd + 1);
+        uint64_t rangeBegin = 0;
+        uint64_t rangeEnd = 0;
+        range >> rangeBegin >> rangeEnd;
+        std::ostringstream answers;
+        for (uint64_t i = rangeBegin; i < rangeEnd && i < seeds.size(); i++) {
+            NodeSet community;
+            bool truncated;
+            uint32_t stopReason = ComputeSeedSetCommunity(algorithmId, nodeNeighbors, seeds[i], community, buffers,
+                                                          graphVolume, settings, NULL, NULL, &truncated);
+            answers << stopReason << " " << (truncated ? 1 : 0) << "\t";
+            WriteCommunity(answers, community);
+        }
+        if (!SendAll(socketFd, answers.str())) {
+            return;
+        }
+    }
+}
+
+// Forks a worker. The child shares the pages of the graph and of the seed sets with the coordinator (copy on write,
+// and the workers only read them), and closes the coordinator ends of the sockets of the other workers so that each
+// worker sees the end of its own socket when the coordinator closes it.
+static bool StartWorker(CoordinatorWorker& worker,
+                        std::vector< CoordinatorWorker >& workers,
+                        uint32_t algorithmId,
+                        std::vector< NodeSet >& nodeNeighbors,
+                        std::vector< NodeSet >& seeds,
+                        uint32_t maxNodeId,
+                        uint64_t graphVolume,
+                        const QuerySettings& settings) {
+    int socketFds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, socketFds) < 0) {
+        printf("Cannot create the socket of a worker: %s\n", strerror(errno));
+        return false;
+    }
+    fflush(stdout);
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+        printf("Cannot start a worker: %s\n", strerror(errno));
+        close(socketFds[0]);
+        close(socketFds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(socketFds[0]);
+        for (std::vector< CoordinatorWorker >::iterator it = workers.begin(); it != workers.end(); ++it) {
+            if (it->socketFd >= 0) {
+                close(it->socketFd);
+            }
+        }
+        RunWorker(socketFds[1], algorithmId, nodeNeighbors, seeds, maxNodeId, graphVolume, settings);
+        close(socketFds[1]);
+        // no destructors or stdio flushes of the coordinator state in the child
+        _exit(0);
+    }
+    close(socketFds[1]);
+    worker.pid = pid;
+    worker.socketFd = socketFds[0];
+    worker.busy = false;
+    worker.pending.clear();
+    worker.answers.clear();
+    return true;
+}
+
+// Closes the socket of a worker that stopped answering and reports how it ended. Its range in flight, if any, is lost.
+static void StopWorker(CoordinatorWorker& worker, uint32_t workerId, std::map< uint64_t, CoordinatorRange >& ranges) {
+    close(worker.socketFd);
+    worker.socketFd = -1;
+    int status = 0;
+    kill(worker.pid, SIGKILL);
+    while (waitpid(worker.pid, &status, 0) < 0 && errno == EINTR) {}
+    std::ostringstream reason;
+    if (WIFSIGNALED(status) && WTERMSIG(status) != SIGKILL) {
+        reason << "killed by signal " << WTERMSIG(status);
+    } else if (WIFEXITED(status)) {
+        reason << "exited with status " << WEXITSTATUS(status);
+    } else {
+        reason << "stopped answering";
+    }
+    if (worker.busy) {
+        printf("\nWorker %u (pid %i) %s, seed sets %lu to %lu lost\n", workerId, worker.pid, reason.str().c_str(),
+               worker.rangeBegin, worker.rangeEnd - 1);
+        CoordinatorRange& range = ranges[worker.rangeBegin];
+        range.rangeEnd = worker.rangeEnd;
+        range.lost = true;
+        worker.busy = false;
+    } else {
+        printf("\nWorker %u (pid %i) %s\n", workerId, worker.pid, reason.str().c_str());
+    }
+    worker.pending.clear();
+    worker.answers.clear();
+}
+
+// Coordinator mode: the graph is loaded once by the caller, the seed sets are read from seedSetFileName ("-" for
+// the standard input), and nbWorkers processes are forked over them. The workers share the graph read-only with the
+// coordinator, which hands out ranges of rangeSize seed sets to the idle workers and writes the communities (with
+// the stop reasons for PageRank and LexRank, and the truncated flags with a query budget) in input order as the
+// ranges complete. A worker that crashes only loses its range in flight: its seed sets get empty communities, they
+// are listed in a -lost.txt file, and a new worker takes its place. If the coordinator cannot wait for the workers
+// anymore, all the seed sets not written yet are lost in the same way. Returns 1 if any seed set was lost.
+int RunCoordinator(const char* seedSetFileName,
+                   const char* outputFileName,
+                   uint32_t algorithmId,
+                   std::vector< NodeSet >& nodeNeighbors,
+                   uint32_t maxNodeId,
+                   const QuerySettings& settings,
+                   uint32_t nbWorkers,
+                   uint32_t rangeSize) {
+    std::vector< NodeSet > seeds;
+    if (strcmp(seedSetFileName, "-") == 0) {
+        ReadSeedSets(std::cin, seeds, UINT32_MAX);
+    } else {
+        std::ifstream seedSetFile(seedSetFileName);
+        if (!seedSetFile) {
+            printf("Cannot open the seed set file %s\n", seedSetFileName);
+            return 1;
+        }
+        ReadSeedSets(seedSetFile, seeds, UINT32_MAX);
+    }
+    uint64_t nbSeedSets = seeds.size();
+    printf("Nb of seed sets: %lu\n", nbSeedSets);
+    std::string communityOutputFileName(outputFileName);
+    communityOutputFileName += "-communities.txt";
+    // the file writes overlap with the wait for the next ranges
+    ResultWriter communityFile(communityOutputFileName.c_str(), true);
+    ResultWriter stopReasonFile;
+    bool hasStopReasons = algorithmId != 2;
+    if (hasStopReasons) {
+        std::string stopReasonOutputFileName(outputFileName);
+        stopReasonOutputFileName += "-stop-reasons.txt";
+        stopReasonFile.Open(stopReasonOutputFileName.c_str());
+    }
+    ResultWriter truncatedFile;
+    bool hasBudget = settings.budget.IsLimited();
+    if (hasBudget) {
+        std::string truncatedOutputFileName(outputFileName);
+        truncatedOutputFileName += "-truncated.txt";
+        truncatedFile.Open(truncatedOutputFileName.c_str());
+    }
+    std::string lostOutputFileName(outputFileName);
+    lostOutputFileName += "-lost.txt";
+    unlink(lostOutputFileName.c_str());
+    ResultWriter lostFile;
+    printf("Computing communities with %u worker processes (ranges of %u seed sets)...\n", nbWorkers, rangeSize);
+    uint64_t graphVolume = ComputeGraphVolume(nodeNeighbors);
+
+    std::vector< CoordinatorWorker > workers(nbWorkers);
+    for (std::vector< CoordinatorWorker >::iterator it = workers.begin(); it != workers.end(); ++it) {
+        it->socketFd = -1;
+        it->busy = false;
+    }
+    for (uint32_t i = 0; i < nbWorkers; i++) {
+        if (!StartWorker(workers[i], workers, algorithmId, nodeNeighbors, seeds, maxNodeId, graphVolume, settings)) {
+            break;
+        }
+    }
+    std::map< uint64_t, CoordinatorRange > ranges;    // reordering buffer, by first seed set
+    uint64_t nextRange = 0;
+    uint64_t nextToWrite = 0;
+    uint64_t nbLost = 0;
+    uint64_t nbTruncated = 0;
+    std::vector< uint64_t > nbStopReasons (NB_STOP_REASONS, 0);
+    std::vector< pollfd > pollFds;
+    std::vector< uint32_t > pollWorkers;
+    char buffer[65536];
+    double startTime = omp_get_wtime();
+    while (nextToWrite < nbSeedSets) {
+        // hands out the next ranges to the idle workers
+        for (uint32_t i = 0; i < nbWorkers && nextRange < nbSeedSets; i++) {
+            CoordinatorWorker& worker = workers[i];
+            if (worker.socketFd < 0 || worker.busy) {
+                continue;
+            }
+            uint64_t rangeEnd = std::min(nbSeedSets, nextRange + rangeSize);
+            std::ostringstream range;
+            range << nextRange << " " << rangeEnd << "\n";
+            if (!SendAll(worker.socketFd, range.str())) {
+                StopWorker(worker, i, ranges);
+                StartWorker(worker, workers, algorithmId, nodeNeighbors, seeds, maxNodeId, graphVolume, settings);
+                continue;
+            }
+            worker.busy = true;
+            worker.rangeBegin = nextRange;
+            worker.rangeEnd = rangeEnd;
+            nextRange = rangeEnd;
+        }
+        // writes the completed ranges that follow the last written one
+        std::map< uint64_t, CoordinatorRange >::iterator it;
+        while ((it = ranges.find(nextToWrite)) != ranges.end()) {
+            CoordinatorRange& range = it->second;
+            if (range.lost) {
+                if (!lostFile.IsOpen()) {
+                    lostFile.Open(lostOutputFileName.c_str());
+                }
+                lostFile.WriteUInt(nextToWrite);
+                lostFile.WriteChar(' ');
+                lostFile.WriteUInt(range.rangeEnd - 1);
+                lostFile.WriteChar('\n');
+                for (uint64_t i = nextToWrite; i < range.rangeEnd; i++) {
+                    communityFile.WriteChar('\n');
+                    if (hasStopReasons) {
+                        stopReasonFile.WriteString(GetSweepStopReasonName(NB_STOP_REASONS));
+                        stopReasonFile.WriteChar('\n');
+                    }
+                    if (hasBudget) {
+                        truncatedFile.WriteString("0\n");
+                    }
+                }
+                nbLost += range.rangeEnd - nextToWrite;
+            }
+            for (std::vector< std::string >::iterator it2 = range.answers.begin(); it2 != range.answers.end(); ++it2) {
+                size_t tab = it2->find('\t');
+                uint32_t stopReason = atoi(it2->c_str());
+                bool truncated = it2->size() > 2 && (*it2)[it2->find(' ') + 1] == '1';
+                communityFile.Write(it2->data() + tab + 1, it2->size() - tab - 1);
+                communityFile.WriteChar('\n');
+                if (hasStopReasons) {
+                    stopReasonFile.WriteString(GetSweepStopReasonName(stopReason));
+                    stopReasonFile.WriteChar('\n');
+                    if (stopReason < NB_STOP_REASONS) {
+                        nbStopReasons[stopReason]++;
+                    }
+                }
+                if (hasBudget) {
+                    truncatedFile.WriteString(truncated ? "1\n" : "0\n");
+                    nbTruncated += truncated;
+                }
+            }
+            nextToWrite = range.rangeEnd;
+            ranges.erase(it);
+            communityFile.Flush();
+            DisplayProgress(((double) nextToWrite) / (double) nbSeedSets, 100);
+        }
+        if (nextToWrite >= nbSeedSets) {
+            break;
+        }
+        // waits for the answers of the busy workers
+        pollFds.clear();
+        pollWorkers.clear();
+        for (uint32_t i = 0; i < nbWorkers; i++) {
+            if (workers[i].socketFd >= 0 && workers[i].busy) {
+                pollfd pollFd;
+                pollFd.fd = workers[i].socketFd;
+                pollFd.events = POLLIN;
+                pollFd.revents = 0;
+                pollFds.push_back(pollFd);
+                pollWorkers.push_back(i);
+            }
+        }
+        if (pollFds.empty()) {
+            if (nextRange >= nbSeedSets) {
+                break;
+            }
+            // no worker left: the seed sets not handed out yet are lost
+            printf("\nNo worker left\n");
+            CoordinatorRange& range = ranges[nextRange];
+            range.rangeEnd = nbSeedSets;
+            range.lost = true;
+            nextRange = nbSeedSets;
+            continue;
+        }
+        if (poll(&pollFds[0], pollFds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // the answers in flight cannot be received: the ranges not written yet are all lost, and written as such
+            printf("\nCannot wait for the workers: %s\n", strerror(errno));
+            for (uint32_t i = 0; i < nbWorkers; i++) {
+                if (workers[i].socketFd >= 0) {
+                    StopWorker(workers[i], i, ranges);
+                }
+            }
+            if (nextRange < nbSeedSets) {
+                CoordinatorRange& range = ranges[nextRange];
+                range.rangeEnd = nbSeedSets;
+                range.lost = true;
+                nextRange = nbSeedSets;
+            }
+            continue;
+        }
+        for (size_t j = 0; j < pollFds.size(); j++) {
+            if (pollFds[j].revents == 0) {
+                continue;
+            }
+            uint32_t workerId = pollWorkers[j];
+            CoordinatorWorker& worker = workers[workerId];
+            ssize_t nbBytes = recv(worker.socketFd, buffer, sizeof(buffer), 0);
+            if (nbBytes < 0 && errno == EINTR) {
+                continue;
+            }
+            if (nbBytes <= 0) {
+                // the worker crashed: a new one takes its place, without its range
+                StopWorker(worker, workerId, ranges);
+                StartWorker(worker, workers, algorithmId, nodeNeighbors, seeds, maxNodeId, graphVolume, settings);
+                continue;
+            }
+            worker.pending.append(buffer, nbBytes);
+            size_t lineStart = 0;
+            size_t lineEnd;
+            while ((lineEnd = worker.pending.find('\n', lineStart)) != std::string::npos) {
+                worker.answers.push_back(worker.pending.substr(lineStart, lineEnd - lineStart));
+                lineStart = lineEnd + 1;
+            }
+            worker.pending.erase(0, lineStart);
+            if (worker.answers.size() >= worker.rangeEnd - worker.rangeBegin) {
+                CoordinatorRange& range = ranges[worker.rangeBegin];
+                range.rangeEnd = worker.rangeEnd;
+                range.lost = false;
+                range.answers.swap(worker.answers);
+                worker.answers.clear();
+                worker.busy = false;
+            }
+        }
+    }
+    std::cout << std::endl;
+    for (std::vector< CoordinatorWorker >::iterator it = workers.begin(); it != workers.end(); ++it) {
+        if (it->socketFd >= 0) {
+            close(it->socketFd);
+            while (waitpid(it->pid, NULL, 0) < 0 && errno == EINTR) {}
+        }
+    }
+    int status = communityFile.Close();
+    printf("%lu seed sets processed (%.1f seed sets/s)\n", nextToWrite - nbLost, (nextToWrite - nbLost) / (omp_get_wtime() - startTime));
+    if (hasStopReasons) {
+        status |= stopReasonFile.Close();
+        for (uint32_t stopReason = 0; stopReason < NB_STOP_REASONS; stopReason++) {
+            printf("Sweeps stopped by %s: %lu\n", GetSweepStopReasonName(stopReason), nbStopReasons[stopReason]);
+        }
+    }
+    if (hasBudget) {
+        status |= truncatedFile.Close();
+        printf("Seed sets truncated by their budget: %lu\n", nbTruncated);
+    }
+    if (nbLost > 0) {
+        lostFile.Close();
+        printf("Seed sets lost: %lu (ranges in %s)\n", nbLost, lostOutputFileName.c_str());
+        return 1;
+    }
+    return status;
+}
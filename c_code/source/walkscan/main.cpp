@@ -2,18 +2,42 @@
 #include "../include/benchmark.h"
 #include "../include/benchmark_random_seeds.h"
 #include "../include/benchmark_locally_random_seeds.h"
+#include "../include/metrics.h"
+#include "../include/server.h"
+#include "../include/stream.h"
+#include "../include/coordinator.h"
+#include "../include/binary_communities.h"
+#include <omp.h>
 
 static void PrintUsage() {
     printf("Usage: walkscan <flags>\n");
     printf("Availaible flags:\n");
     printf("\t-i [graph file name] : Specifies the graph file (tab-separated list of edges).\n");
     printf("\t-o [output path/prefix] : Specifies the prefix for output files.\n");
-    printf("\t-s [seed file name] : Specifies a file with the seed sets.\n");
+    printf("\t-s [seed file name] : Specifies a file with the seed sets (\"-\" for the standard input).\n");
     printf("\t-t [walk length] : Specifies the length of the random walks (default value: 2).\n");
     printf("\t-a [algorithm] : Specifies the algorithm (default value: 0).\n");
     printf("\t\t0: PageRank with conductance\n");
     printf("\t\t1: LexRank with conductance\n");
     printf("\t\t2: WalkScan (use flags --epsilon and --min-elems to change parameter values)\n");
+    printf("\t--max-volume [ratio] : Stops the conductance sweep when the community volume exceeds this fraction of the graph volume (default value: 1).\n");
+    printf("\t--patience [number of nodes] : Stops the conductance sweep after this number of nodes without improvement (default value: 0, no limit).\n");
+    printf("\t--max-frontier [number of nodes] : Stops the random walk of a seed set at the last step whose support has at most this number of nodes (default value: 0, no limit).\n");
+    printf("\t--max-edges [number of edges] : Stops the random walk of a seed set at the last step completed within this number of edge traversals (default value: 0, no limit).\n");
+    printf("\t--deadline [milliseconds] : Stops the random walk, the conductance sweep or DBSCAN of a seed set after this time and keeps the best community found so far (default value: 0, no limit).\n");
+    printf("\t--pipeline : Processes each seed set from the random walk to its community before the next one, in parallel (only the communities are kept in memory).\n");
+    printf("\t--threads [number of threads] : Specifies the number of threads of the pipelined mode, of the server, of DBSCAN on large walk supports and of the metrics (default value: number of cores).\n");
+    printf("\t--metrics : Writes the size, volume, cut, internal edges, conductance and density of each community in a -metrics.tsv file.\n");
+    printf("\t--binary : Writes the communities in a binary -communities.bin file indexed by seed set (with their conductance as scores if --metrics is set) instead of the -communities.txt file (not with --stream, --workers or --server; see the communities tool).\n");
+    printf("\t--dbscan-memory [megabytes] : WalkScan only. Runs DBSCAN in bounded memory, recomputing the distances block by block within this budget instead of keeping the eps-neighbor lists (slower, quadratic time).\n");
+    printf("\t--rho [tolerance] : WalkScan only. Runs rho-approximate DBSCAN: nodes within epsilon are always neighbors, nodes beyond (1 + rho) epsilon never are (default value: 0, exact DBSCAN).\n");
+    printf("\t--quantize : WalkScan only. Runs DBSCAN on the embedding rounded to 16-bit fixed point, with integer SIMD distances (faster; only the node pairs whose distance is within (t + 1) / 65535 of epsilon can be classified differently, but one such pair can split or merge clusters, and when many distances are equal to epsilon a large share of the nodes can change cluster).\n");
+    printf("\t--stream [chunk size] : Reads the seed sets by chunks of this size and writes each community as soon as it is computed, in input order (bounded memory; not with --metrics or --neighbor-histogram).\n");
+    printf("\t--workers [number of processes] : Forks this number of worker processes sharing the graph, hands out ranges of seed sets to them and writes the communities in input order (a crashed worker only loses its range; not with --metrics or --neighbor-histogram).\n");
+    printf("\t--range [number of seed sets] : Number of seed sets handed out at a time to a worker process (default value: 1000).\n");
+    printf("\t--cache [megabytes] : Only with --server or --stream. Keeps the communities of the previous seed sets within this memory budget and reuses them for repeated seed sets.\n");
+    printf("\t--server [socket path] : Loads the graph once and answers seed-set queries on this Unix domain socket (see README; -s, -a and -o are not needed).\n");
+    printf("\t--neighbor-histogram : WalkScan only. Writes the histogram of the number of eps-neighbors of the nodes in a -neighbor-histogram.txt file (to tune --min-elems).\n");
 }
 
 int main(int argc, char ** argv) {
@@ -24,6 +48,31 @@ int main(int argc, char ** argv) {
     bool algorithmIdSet = false;
     bool epsilonSet = false;
     bool minElemsSet = false;
+    bool maxVolumeRatioSet = false;
+    bool patienceSet = false;
+    bool pipelineSet = false;
+    bool nbThreadsSet = false;
+    bool metricsSet = false;
+    bool neighborHistogramSet = false;
+    bool dbscanMemorySet = false;
+    bool rhoSet = false;
+    bool quantizeSet = false;
+    bool serverSet = false;
+    bool streamSet = false;
+    bool cacheSet = false;
+    bool maxFrontierSet = false;
+    bool maxEdgesSet = false;
+    bool deadlineSet = false;
+    bool workersSet = false;
+    bool rangeSizeSet = false;
+    bool binarySet = false;
+    uint32_t nbWorkers = 0;
+    uint32_t rangeSize = 1000;
+    double maxEdges = 0.0;
+    double deadline = 0.0;
+    uint32_t cacheSize = 0;
+    uint32_t chunkSize = 10000;
+    char * socketPath = NULL;
     char * graphFileName = NULL;
     char * outputFileName = NULL;
     char * seedSetFileName = NULL;
@@ -31,6 +80,11 @@ int main(int argc, char ** argv) {
     uint32_t algorithmId = 0;
     double epsilon = 0.01;
     uint32_t minElems = 2;
+    SweepLimits sweepLimits;
+    uint32_t nbThreads = 0;
+    uint32_t dbscanMemory = 0;
+    DbscanSettings dbscanSettings;
+    QueryBudget budget;
 
     for(int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
@@ -44,6 +98,24 @@ int main(int argc, char ** argv) {
         CHECK_ARGUMENT_INT(i, "-a", algorithmId, algorithmIdSet);
         CHECK_ARGUMENT_FLOAT(i, "--epsilon", epsilon, epsilonSet);
         CHECK_ARGUMENT_FLOAT(i, "--min-elems", minElems, minElemsSet);
+        CHECK_ARGUMENT_FLOAT(i, "--max-volume", sweepLimits.maxVolumeRatio, maxVolumeRatioSet);
+        CHECK_ARGUMENT_INT(i, "--patience", sweepLimits.patience, patienceSet);
+        CHECK_FLAG(i, "--pipeline", pipelineSet);
+        CHECK_ARGUMENT_INT(i, "--threads", nbThreads, nbThreadsSet);
+        CHECK_FLAG(i, "--metrics", metricsSet);
+        CHECK_FLAG(i, "--binary", binarySet);
+        CHECK_FLAG(i, "--neighbor-histogram", neighborHistogramSet);
+        CHECK_ARGUMENT_INT(i, "--dbscan-memory", dbscanMemory, dbscanMemorySet);
+        CHECK_ARGUMENT_FLOAT(i, "--rho", dbscanSettings.rho, rhoSet);
+        CHECK_FLAG(i, "--quantize", quantizeSet);
+        CHECK_ARGUMENT_STRING(i, "--server", socketPath, serverSet);
+        CHECK_ARGUMENT_INT(i, "--stream", chunkSize, streamSet);
+        CHECK_ARGUMENT_INT(i, "--cache", cacheSize, cacheSet);
+        CHECK_ARGUMENT_INT(i, "--workers", nbWorkers, workersSet);
+        CHECK_ARGUMENT_INT(i, "--range", rangeSize, rangeSizeSet);
+        CHECK_ARGUMENT_INT(i, "--max-frontier", budget.maxFrontierSize, maxFrontierSet);
+        CHECK_ARGUMENT_FLOAT(i, "--max-edges", maxEdges, maxEdgesSet);
+        CHECK_ARGUMENT_FLOAT(i, "--deadline", deadline, deadlineSet);
     }
 
     if (!graphFileNameSet) {
@@ -52,13 +124,13 @@ int main(int argc, char ** argv) {
         return 1;
     }
 
-    if (!outputFileNameSet) {
+    if (!outputFileNameSet && !serverSet) {
         printf("Output filename not set\n");
         PrintUsage();
         return 1;
     }
 
-    if (!seedSetFileNameSet) {
+    if (!seedSetFileNameSet && !serverSet) {
         printf("Seed set file name not set\n");
         PrintUsage();
         return 1;
@@ -80,7 +152,7 @@ int main(int argc, char ** argv) {
                 PrintUsage();
                 return 1;
         }
-    } else {
+    } else if (!serverSet) {
         printf("Algorithm not specified\n");
         PrintUsage();
         return 1;
@@ -92,6 +164,35 @@ int main(int argc, char ** argv) {
         printf("Length of random walks unspecified. Default value used: %i\n", walkLength);
     }
 
+    if (maxVolumeRatioSet) {
+        printf("Volume cap of the conductance sweep (fraction of the graph volume): %f\n", sweepLimits.maxVolumeRatio);
+    }
+    if (patienceSet) {
+        printf("Patience of the conductance sweep: %i nodes\n", sweepLimits.patience);
+    }
+    if (nbThreadsSet && nbThreads > 0) {
+        omp_set_num_threads(nbThreads);
+    }
+    if (maxFrontierSet) {
+        printf("Largest walk support of a seed set: %u nodes (0: no limit)\n", budget.maxFrontierSize);
+    }
+    if (maxEdgesSet && maxEdges > 0.0) {
+        budget.maxPushedEdges = (uint64_t) maxEdges;
+        printf("Largest number of edge traversals of the walk of a seed set: %lu\n", budget.maxPushedEdges);
+    }
+    if (deadlineSet && deadline > 0.0) {
+        budget.timeLimit = deadline / 1000.0;
+        printf("Deadline of each seed set: %.1f ms\n", deadline);
+    }
+    if (pipelineSet) {
+        printf("Pipelined mode with %i threads\n", omp_get_max_threads());
+    }
+    // DBSCAN settings of WalkScan, shared by the batch, budgeted, streamed and served queries
+    if (dbscanMemorySet && dbscanMemory > 0) {
+        dbscanSettings.memoryBudget = ((uint64_t) dbscanMemory) << 20;
+    }
+    dbscanSettings.quantized = quantizeSet;
+
     //==================== LOAD THE GRAPH ==================================
     std::vector< Edge > edgeList;  // Allocating list for edges
     printf("Graph file: %s\n", graphFileName);
@@ -102,70 +203,230 @@ int main(int argc, char ** argv) {
     printf("Nb of edges: %lu\n", edgeList.size());
     //======================================================================
 
+    QuerySettings querySettings;
+    querySettings.nbSteps = walkLength;
+    querySettings.epsilon = epsilon;
+    querySettings.minElems = minElems;
+    querySettings.sweepLimits = sweepLimits;
+    querySettings.dbscanSettings = dbscanSettings;
+    querySettings.budget = budget;
+    if (binarySet && (serverSet || streamSet || workersSet)) {
+        printf("The binary output is not available with --stream, --workers or --server\n");
+        return 1;
+    }
+    if (cacheSet && !serverSet && !streamSet) {
+        printf("The community cache is only available with --stream or --server\n");
+        return 1;
+    }
+    if (workersSet && !serverSet && !streamSet) {
+        std::vector< Edge >().swap(edgeList);
+        if (nbWorkers == 0 || (rangeSizeSet && rangeSize == 0)) {
+            printf("Invalid number of workers or range size\n");
+            return 1;
+        }
+        printf("Seed sets: %s\n", seedSetFileName);
+        return RunCoordinator(seedSetFileName, outputFileName, algorithmId, nodeNeighbors, maxNodeId, querySettings, nbWorkers, rangeSize);
+    }
+    if (serverSet || streamSet) {
+        std::vector< Edge >().swap(edgeList);
+        CommunityCache* cache = NULL;
+        if (cacheSet && cacheSize > 0) {
+            cache = new CommunityCache(((uint64_t) cacheSize) << 20);
+            printf("Community cache of %i MB\n", cacheSize);
+        }
+        int status;
+        if (serverSet) {
+            status = RunServer(socketPath, nodeNeighbors, maxNodeId, querySettings, 0, cache);
+        } else if (chunkSize == 0) {
+            printf("Invalid chunk size\n");
+            status = 1;
+        } else {
+            printf("Seed sets: %s\n", seedSetFileName);
+            status = RunStream(seedSetFileName, outputFileName, algorithmId, nodeNeighbors, maxNodeId, querySettings, chunkSize, cache);
+        }
+        delete cache;
+        return status;
+    }
+
     //====================== LOAD OR BUILD THE SEED SET ============================
     std::vector< NodeSet > seeds;    // Allocating vector for seeds
-    std::vector< NodeSet > nodeSeedSet (maxNodeId + 1);    // Allocating vector for seeds
     printf("Seed sets: %s\n", seedSetFileName);
-    LoadCommunity(seedSetFileName, seeds, nodeSeedSet);
+    if (strcmp(seedSetFileName, "-") == 0) {
+        ReadSeedSets(std::cin, seeds, UINT32_MAX);
+    } else {
+        std::ifstream seedSetFile(seedSetFileName);
+        if (!seedSetFile) {
+            printf("Cannot open the seed set file %s\n", seedSetFileName);
+            return 1;
+        }
+        ReadSeedSets(seedSetFile, seeds, UINT32_MAX);
+    }
     printf("Nb of seed sets: %lu\n", seeds.size());
+    // Each distinct seed set is processed once, the results are copied back to the input order
+    std::vector< uint32_t > seedSetIndex;
+    uint32_t nbSeedSets = seeds.size();
+    uint32_t nbDistinctSeedSets = DeduplicateSeedSets(seeds, seedSetIndex);
+    if (nbDistinctSeedSets < nbSeedSets) {
+        printf("Nb of distinct seed sets: %i\n", nbDistinctSeedSets);
+    }
     //======================================================================
 
     //=================== ALGORITHM  =======================================
     std::vector< NodeSet > communities(seeds.size());    // Allocating vector for communities
-    switch (algorithmId) {
-        // PAGERANK
-        case 0:
-        {
-            std::vector <std::vector <std::pair<uint32_t, double> > > pageRankResult;
-            printf("Computing PageRank...\n");
-            PageRank(nodeNeighbors, seeds, walkLength, 0.85, pageRankResult, maxNodeId);
-            printf("Computing Min Conductance communities...\n");
-            PageRankMinConductanceNoF1(nodeNeighbors, pageRankResult, seeds, communities);
-            break;
-        }
-        // LEXRANK
-        case 1:
-        {
-            std::vector <std::vector <std::pair<uint32_t, std::vector< double > > > > lexRankResult;
-            printf("Computing LexRank...\n");
-            LexRank(nodeNeighbors, seeds, walkLength, lexRankResult, maxNodeId);
-            LexRankMinConductanceNoF1(nodeNeighbors, lexRankResult, seeds, communities);
-            break;
-        }
-        // WALKSCAN
-        case 2:
-        {
-            if (epsilonSet) {
-                printf("Value of epsilon (parameter of DBSCAN): %f\n", epsilon);
-            } else {
-                printf("Value of epsilon (parameter of DBSCAN) unspecified. Default value is used: %f\n", epsilon);
+    std::vector< uint32_t > stopReasons;    // Why the conductance sweep stopped, for each seed set
+    std::vector< uint64_t > neighborCountHistogram;    // Number of nodes for each number of eps-neighbors (WalkScan)
+    std::vector< uint8_t > truncated;    // Whether the budget of each seed set was exhausted
+    if (budget.IsLimited()) {
+        // each seed set goes through its walk, sweep or DBSCAN within its budget, in parallel
+        printf("Computing communities within the budget of each seed set...\n");
+        ComputeCommunities(algorithmId, nodeNeighbors, seeds, communities, maxNodeId, querySettings, stopReasons, truncated);
+    } else {
+        switch (algorithmId) {
+            // PAGERANK
+            case 0:
+            {
+                if (pipelineSet) {
+                    printf("Computing PageRank and Min Conductance communities...\n");
+                    PageRankMinConductancePipeline(nodeNeighbors, seeds, walkLength, 0.85, communities, maxNodeId, sweepLimits, stopReasons);
+                    break;
+                }
+                std::vector <std::vector <std::pair<uint32_t, double> > > pageRankResult;
+                printf("Computing PageRank...\n");
+                PageRank(nodeNeighbors, seeds, walkLength, 0.85, pageRankResult, maxNodeId);
+                printf("Computing Min Conductance communities...\n");
+                PageRankMinConductanceNoF1(nodeNeighbors, pageRankResult, seeds, communities, sweepLimits, stopReasons);
+                break;
             }
-            if (minElemsSet) {
-                printf("Value of min elements (parameter of DBSCAN): %i\n", minElems);
-            } else {
-                printf("Value of min elements (parameter of DBSCAN) unspecified. Default value is used: %i\n", minElems);
+            // LEXRANK
+            case 1:
+            {
+                if (pipelineSet) {
+                    printf("Computing LexRank and Min Conductance communities...\n");
+                    LexRankMinConductancePipeline(nodeNeighbors, seeds, walkLength, communities, maxNodeId, sweepLimits, stopReasons);
+                    break;
+                }
+                std::vector <std::vector <std::pair<uint32_t, std::vector< double > > > > lexRankResult;
+                printf("Computing LexRank...\n");
+                LexRank(nodeNeighbors, seeds, walkLength, lexRankResult, maxNodeId);
+                printf("Computing Min Conductance communities...\n");
+                LexRankMinConductanceNoF1(nodeNeighbors, lexRankResult, seeds, communities, sweepLimits, stopReasons);
+                break;
             }
-            std::vector <std::vector< NodeSet > > walkScanResult;
+            // WALKSCAN
+            case 2:
+            {
+                if (epsilonSet) {
+                    printf("Value of epsilon (parameter of DBSCAN): %f\n", epsilon);
+                } else {
+                    printf("Value of epsilon (parameter of DBSCAN) unspecified. Default value is used: %f\n", epsilon);
+                }
+                if (minElemsSet) {
+                    printf("Value of min elements (parameter of DBSCAN): %i\n", minElems);
+                } else {
+                    printf("Value of min elements (parameter of DBSCAN) unspecified. Default value is used: %i\n", minElems);
+                }
+                if (dbscanSettings.memoryBudget > 0) {
+                    printf("Memory budget of DBSCAN: %i MB\n", dbscanMemory);
+                }
+                if (rhoSet && dbscanSettings.rho > 0.0) {
+                    printf("Approximate DBSCAN with tolerance rho: %f\n", dbscanSettings.rho);
+                }
+                if (dbscanSettings.quantized) {
+                    printf("DBSCAN on the 16-bit quantized embedding\n");
+                }
+                std::vector< uint64_t >* histogram = neighborHistogramSet ? &neighborCountHistogram : NULL;
+                if (pipelineSet) {
+                    printf("Computing WalkScan communities...\n");
+                    WalkScanFirstCommunityPipeline(nodeNeighbors, seeds, walkLength, communities, maxNodeId, epsilon, minElems, dbscanSettings, histogram);
+                    break;
+                }
+                std::vector <std::vector< NodeSet > > walkScanResult;
 
-            printf("Computing WalkScan...\n");
-            WalkScanNoGroundTruth(nodeNeighbors, seeds, walkLength, walkScanResult, maxNodeId, epsilon, minElems);
-            WalkScanFirstCommunity(walkScanResult, seeds, communities);
+                printf("Computing WalkScan...\n");
+                WalkScanNoGroundTruth(nodeNeighbors, seeds, walkLength, walkScanResult, maxNodeId, epsilon, minElems, dbscanSettings, histogram);
+                WalkScanFirstCommunity(walkScanResult, seeds, communities);
 
-            break;
+                break;
+            }
+            default:
+                printf("Incorrect algorithm ID.\n");
+                PrintUsage();
+                return 1;
         }
-        default:
-            printf("Incorrect algorithm ID.\n");
-            PrintUsage();
-            return 1;
+    }
+    if (nbDistinctSeedSets < nbSeedSets) {
+        // backwards, so that each distinct result is read before its slot is overwritten (seedSetIndex[i] <= i)
+        communities.resize(nbSeedSets);
+        for (int64_t i = nbSeedSets - 1; i >= 0; i--) {
+            if (seedSetIndex[i] != i) {
+                communities[i] = communities[seedSetIndex[i]];
+            }
+        }
+        if (!stopReasons.empty()) {
+            stopReasons.resize(nbSeedSets);
+            for (int64_t i = nbSeedSets - 1; i >= 0; i--) {
+                stopReasons[i] = stopReasons[seedSetIndex[i]];
+            }
+        }
+        if (!truncated.empty()) {
+            truncated.resize(nbSeedSets);
+            for (int64_t i = nbSeedSets - 1; i >= 0; i--) {
+                truncated[i] = truncated[seedSetIndex[i]];
+            }
+        }
+    }
+    if (!stopReasons.empty()) {
+        PrintStopReasonSummary(stopReasons);
     }
     //======================================================================
 
     //======================== PRINT RESULTS ===============================
+    int status = 0;    // 1 if an output file could not be written
+    std::vector< CommunityMetrics > metrics;
+    if (metricsSet) {
+        printf("Computing community metrics...\n");
+        ComputeCommunityMetrics(nodeNeighbors, communities, metrics);
+    }
     std::string communityOutputFileName(outputFileName);
-    communityOutputFileName += "-communities.txt";
-    printf("Printing communities in %s...\n", communityOutputFileName.c_str());
-    PrintPartition(communityOutputFileName.c_str(), communities);
+    if (binarySet) {
+        communityOutputFileName += "-communities.bin";
+        printf("Printing communities in %s...\n", communityOutputFileName.c_str());
+        std::vector< double > conductances;
+        for (uint32_t i = 0; i < metrics.size(); i++) {
+            conductances.push_back(metrics[i].conductance);
+        }
+        status |= PrintBinaryPartition(communityOutputFileName.c_str(), communities, metricsSet ? &conductances : NULL);
+    } else {
+        communityOutputFileName += "-communities.txt";
+        printf("Printing communities in %s...\n", communityOutputFileName.c_str());
+        status |= PrintPartition(communityOutputFileName.c_str(), communities);
+    }
+    if (metricsSet) {
+        std::string metricsOutputFileName(outputFileName);
+        metricsOutputFileName += "-metrics.tsv";
+        printf("Printing metrics in %s...\n", metricsOutputFileName.c_str());
+        status |= PrintCommunityMetrics(metricsOutputFileName.c_str(), metrics);
+    }
+    if (!stopReasons.empty()) {
+        std::string stopReasonOutputFileName(outputFileName);
+        stopReasonOutputFileName += "-stop-reasons.txt";
+        printf("Printing sweep stop reasons in %s...\n", stopReasonOutputFileName.c_str());
+        status |= PrintStopReasons(stopReasonOutputFileName.c_str(), stopReasons);
+    }
+    if (budget.IsLimited()) {
+        std::string truncatedOutputFileName(outputFileName);
+        truncatedOutputFileName += "-truncated.txt";
+        printf("Seed sets truncated by their budget: %lu\n", (uint64_t) std::count(truncated.begin(), truncated.end(), 1));
+        printf("Printing truncated flags in %s...\n", truncatedOutputFileName.c_str());
+        status |= PrintTruncatedFlags(truncatedOutputFileName.c_str(), truncated);
+    }
+    if (neighborHistogramSet && algorithmId == 2 && !budget.IsLimited()) {
+        std::string histogramOutputFileName(outputFileName);
+        histogramOutputFileName += "-neighbor-histogram.txt";
+        printf("Printing the eps-neighbor histogram in %s...\n", histogramOutputFileName.c_str());
+        status |= PrintNeighborCountHistogram(histogramOutputFileName.c_str(), neighborCountHistogram);
+    }
     //======================================================================
 
-    return 0;
+    return status;
 }
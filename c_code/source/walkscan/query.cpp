@@ -0,0 +1,133 @@
+#include "../include/query.h"
+#include "../include/scheduler.h"
+#include <omp.h>
+
+static const double pageRankAlpha = 0.85;
+
+static void AppendDouble(std::vector< uint32_t >& key, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    key.push_back((uint32_t) bits);
+    key.push_back((uint32_t) (bits >> 32));
+}
+
+// Key of the community of a seed set in the cache: the algorithm and the parameters that change its result
+// (the DBSCAN memory budget and threads do not), then the seed nodes in increasing order.
+void BuildCommunityCacheKey(uint32_t algorithmId,
+                            const NodeSet& seedSet,
+                            const QuerySettings& settings,
+                            std::vector< uint32_t >& key) {
+    key.clear();
+    key.push_back(algorithmId);
+    key.push_back(settings.nbSteps);
+    if (algorithmId == 2) {
+        AppendDouble(key, settings.epsilon);
+        key.push_back(settings.minElems);
+        AppendDouble(key, settings.dbscanSettings.rho);
+        key.push_back(settings.dbscanSettings.quantized);
+    } else {
+        AppendDouble(key, pageRankAlpha);
+        AppendDouble(key, settings.sweepLimits.maxVolumeRatio);
+        key.push_back(settings.sweepLimits.patience);
+        key.push_back(settings.sweepLimits.useConductanceBound);
+    }
+    key.insert(key.end(), seedSet.begin(), seedSet.end());
+}
+
+// Community of one seed set with the algorithm of the -a flag (0: PageRank, 1: LexRank, 2: WalkScan),
+// on the calling thread, with its buffers. graphVolume is ComputeGraphVolume(nodeNeighbors). Returns the reason why the
+// conductance sweep stopped (NB_STOP_REASONS for WalkScan, which has no sweep). With a cache, a community
+// computed before with the same parameters is reused (*cacheHit tells whether it was). The work is bounded by
+// settings.budget: *truncated tells whether it was exhausted, in which case the community is the best one found
+// within the budget (and is not cached).
+uint32_t ComputeSeedSetCommunity(uint32_t algorithmId,
+                                 std::vector< NodeSet >& nodeNeighbors,
+                                 NodeSet& seedSet,
+                                 NodeSet& community,
+                                 QueryBuffers& buffers,
+                                 uint64_t graphVolume,
+                                 const QuerySettings& settings,
+                                 CommunityCache* cache,
+                                 bool* cacheHit,
+                                 bool* truncated) {
+    std::vector< uint32_t > key;
+    uint32_t stopReason = NB_STOP_REASONS;
+    if (cacheHit != NULL) {
+        *cacheHit = false;
+    }
+    if (truncated != NULL) {
+        *truncated = false;
+    }
+    if (cache != NULL) {
+        BuildCommunityCacheKey(algorithmId, seedSet, settings, key);
+        if (cache->Lookup(key, community, stopReason)) {
+            if (cacheHit != NULL) {
+                *cacheHit = true;
+            }
+            return stopReason;
+        }
+    }
+    QueryBudgetTracker budgetTracker(settings.budget);
+    QueryBudgetTracker* tracker = settings.budget.IsLimited() ? &budgetTracker : NULL;
+    switch (algorithmId) {
+        case 0:
+            stopReason = PageRankMinConductanceSeedSet(nodeNeighbors, seedSet, settings.nbSteps, pageRankAlpha, community,
+                                                       buffers.walk, settings.sweepLimits, graphVolume, tracker);
+            break;
+        case 1:
+            stopReason = LexRankMinConductanceSeedSet(nodeNeighbors, seedSet, settings.nbSteps, community, buffers.walk,
+                                                      settings.sweepLimits, graphVolume, tracker);
+            break;
+        default:
+            WalkScanFirstCommunitySeedSet(nodeNeighbors, seedSet, settings.nbSteps, community, buffers.walk,
+                                          buffers.clusters, settings.epsilon, settings.minElems, settings.dbscanSettings, tracker);
+    }
+    if (budgetTracker.IsTruncated()) {
+        if (truncated != NULL) {
+            *truncated = true;
+        }
+    } else if (cache != NULL) {
+        cache->Insert(key, community, stopReason);
+    }
+    return stopReason;
+}
+
+// Communities of all the seed sets, processed in parallel with ComputeSeedSetCommunity (batch mode with
+// query budgets). stopReasons is filled for PageRank and LexRank only, truncated[i] is 1 if the budget of
+// seed set i was exhausted.
+int ComputeCommunities(uint32_t algorithmId,
+                       std::vector< NodeSet >& nodeNeighbors,
+                       std::vector< NodeSet >& seeds,
+                       std::vector< NodeSet >& communities,
+                       uint32_t maxNodeId,
+                       const QuerySettings& settings,
+                       std::vector< uint32_t >& stopReasons,
+                       std::vector< uint8_t >& truncated) {
+    int64_t nbCommunities = seeds.size();
+    uint64_t graphVolume = ComputeGraphVolume(nodeNeighbors);
+    communities.resize(nbCommunities);
+    stopReasons.assign(algorithmId != 2 ? nbCommunities : 0, NB_STOP_REASONS);
+    truncated.assign(nbCommunities, 0);
+    uint32_t counter = 0;
+    std::vector< QueryBuffers > threadBuffers (omp_get_max_threads());
+    SeedSetScheduler scheduler(nodeNeighbors, seeds);
+#pragma omp parallel
+    for (uint32_t i; scheduler.Next(i); ) {
+        bool seedSetTruncated;
+        uint32_t stopReason = ComputeSeedSetCommunity(algorithmId, nodeNeighbors, seeds[i], communities[i],
+                                                      threadBuffers[omp_get_thread_num()], graphVolume, settings, NULL, NULL, &seedSetTruncated);
+        if (algorithmId != 2) {
+            stopReasons[i] = stopReason;
+        }
+        truncated[i] = seedSetTruncated;
+        uint32_t done;
+#pragma omp atomic capture
+        done = ++counter;
+        if (omp_get_thread_num() == 0) {
+            DisplayProgress(((double) done) / (double) nbCommunities, 100);
+        }
+    }
+    std::cout << std::endl;
+    scheduler.PrintUtilization();
+    return 0;
+}
@@ -0,0 +1,271 @@
+#include "../include/server.h"
+#include <omp.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Line protocol of the server. A request is one line:
+//     <algorithm>[,<algorithm>...] <seed node> [<seed node> ...]
+// where the algorithms are those of the -a flag (0: PageRank, 1: LexRank, 2: WalkScan). The answer is one line
+// per requested algorithm, in the same order: the algorithm, a tab and the nodes of the community separated by spaces
+// (as in the -communities.txt files), followed by a tab and "truncated" if the query budget was exhausted (the community
+// is then the best one found within the budget). An invalid request gets a single "error <reason>" line instead. The request
+// "shutdown" stops the server once the open connections are closed, and the request "stats" gets the counters of the
+// community cache ("hits <n> misses <n> entries <n> bytes <n>", or "error no cache"). Each connection can send any
+// number of requests.
+
+static bool ParseRequest(const std::string& line,
+                         uint32_t maxNodeId,
+                         std::vector< uint32_t >& algorithms,
+                         NodeSet& seedSet,
+                         std::string& error) {
+    std::istringstream stream(line);
+    std::string algorithmList;
+    stream >> algorithmList;
+    std::istringstream algorithmStream(algorithmList);
+    std::string algorithm;
+    while (std::getline(algorithmStream, algorithm, ',')) {
+        if (algorithm != "0" && algorithm != "1" && algorithm != "2") {
+            error = "invalid algorithm " + algorithm;
+            return false;
+        }
+        algorithms.push_back(atoi(algorithm.c_str()));
+    }
+    if (algorithms.empty()) {
+        error = "no algorithm";
+        return false;
+    }
+    std::string node;
+    while (stream >> node) {
+        char* end = NULL;
+        unsigned long nodeId = strtoul(node.c_str(), &end, 10);
+        if (*end != '\0' || node[0] == '-' || nodeId > maxNodeId) {
+            error = "invalid seed node " + node;
+            return false;
+        }
+        seedSet.insert(nodeId);
+    }
+    if (seedSet.empty()) {
+        error = "empty seed set";
+        return false;
+    }
+    return true;
+}
+
+static bool SendAll(int socketFd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t nbBytes = send(socketFd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (nbBytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nbBytes <= 0) {
+            return false;
+        }
+        sent += nbBytes;
+    }
+    return true;
+}
+
+// Answer to one request line, and its log line, with the buffers of the worker
+static std::string AnswerRequest(const std::string& line,
+                                 std::vector< NodeSet >& nodeNeighbors,
+                                 uint32_t maxNodeId,
+                                 uint64_t graphVolume,
+                                 const QuerySettings& settings,
+                                 CommunityCache* cache,
+                                 QueryBuffers& buffers,
+                                 std::string& log) {
+    std::vector< uint32_t > algorithms;
+    NodeSet seedSet;
+    std::string error;
+    if (!ParseRequest(line, maxNodeId, algorithms, seedSet, error)) {
+        log = "error (" + error + ")";
+        return "error " + error + "\n";
+    }
+    std::ostringstream answer;
+    std::ostringstream logStream;
+    logStream << seedSet.size() << " seeds, communities of";
+    for (std::vector< uint32_t >::iterator it = algorithms.begin(); it != algorithms.end(); ++it) {
+        NodeSet community;
+        bool cacheHit;
+        bool truncated;
+        ComputeSeedSetCommunity(*it, nodeNeighbors, seedSet, community, buffers, graphVolume, settings, cache, &cacheHit,
+                                &truncated);
+        std::ostringstream line;
+        WriteCommunity(line, community);
+        std::string communityLine = line.str();
+        if (truncated) {
+            communityLine.insert(communityLine.size() - 1, "\ttruncated");
+        }
+        answer << *it << "\t" << communityLine;
+        logStream << " " << community.size() << " (algorithm " << *it << (cacheHit ? ", cached" : "")
+                  << (truncated ? ", truncated)" : ")");
+    }
+    log = logStream.str();
+    return answer.str();
+}
+
+// Serves the requests of one connection until it is closed. Returns true if the server must stop.
+static bool ServeConnection(int connectionFd,
+                            std::vector< NodeSet >& nodeNeighbors,
+                            uint32_t maxNodeId,
+                            uint64_t graphVolume,
+                            const QuerySettings& settings,
+                            CommunityCache* cache,
+                            QueryBuffers& buffers,
+                            uint64_t& nbRequests,
+                            double& totalLatency) {
+    std::string pending;
+    char buffer[4096];
+    bool stop = false;
+    bool open = true;
+    while (open && !stop) {
+        ssize_t nbBytes = recv(connectionFd, buffer, sizeof(buffer), 0);
+        if (nbBytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nbBytes <= 0) {
+            // a last request without end of line
+            open = false;
+            if (pending.empty()) {
+                break;
+            }
+            pending += '\n';
+        } else {
+            pending.append(buffer, nbBytes);
+        }
+        size_t lineStart = 0;
+        size_t lineEnd;
+        while (!stop && (lineEnd = pending.find('\n', lineStart)) != std::string::npos) {
+            std::string line = pending.substr(lineStart, lineEnd - lineStart);
+            lineStart = lineEnd + 1;
+            if (!line.empty() && line[line.size() - 1] == '\r') {
+                line.erase(line.size() - 1);
+            }
+            if (line.find_first_not_of(" \t") == std::string::npos) {
+                continue;
+            }
+            if (line == "shutdown") {
+                SendAll(connectionFd, "bye\n");
+                stop = true;
+                break;
+            }
+            double startTime = omp_get_wtime();
+            std::string log;
+            std::string answer;
+            if (line == "stats") {
+                log = "statistics";
+                if (cache == NULL) {
+                    answer = "error no cache\n";
+                } else {
+                    std::ostringstream stats;
+                    stats << "hits " << cache->GetNbHits() << " misses " << cache->GetNbMisses() << " entries "
+                          << cache->GetNbEntries() << " bytes " << cache->GetMemoryUsage() << "\n";
+                    answer = stats.str();
+                }
+            } else {
+                answer = AnswerRequest(line, nodeNeighbors, maxNodeId, graphVolume, settings, cache, buffers, log);
+            }
+            bool sent = SendAll(connectionFd, answer);
+            double latency = omp_get_wtime() - startTime;
+            uint64_t requestId;
+#pragma omp critical(serverLog)
+            {
+                requestId = ++nbRequests;
+                totalLatency += latency;
+                printf("Request %lu (worker %i): %s, %.3f ms\n", requestId, omp_get_thread_num(), log.c_str(), 1000.0 * latency);
+                fflush(stdout);
+            }
+            if (!sent) {
+                open = false;
+                break;
+            }
+        }
+        pending.erase(0, lineStart);
+    }
+    return stop;
+}
+
+// Server mode: the graph is loaded once by the caller, then seed-set queries are answered over the
+// Unix domain socket socketPath by a pool of workers, each serving one connection at a time. The workers
+// share the community cache when there is one.
+int RunServer(const char* socketPath,
+              std::vector< NodeSet >& nodeNeighbors,
+              uint32_t maxNodeId,
+              const QuerySettings& settings,
+              uint32_t nbWorkers,
+              CommunityCache* cache) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(socketPath) >= sizeof(address.sun_path)) {
+        printf("Socket path too long: %s\n", socketPath);
+        return 1;
+    }
+    strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 1);
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        printf("Cannot create the socket: %s\n", strerror(errno));
+        return 1;
+    }
+    unlink(socketPath);
+    if (bind(listenFd, (sockaddr*) &address, sizeof(address)) < 0 || listen(listenFd, SOMAXCONN) < 0) {
+        printf("Cannot listen on %s: %s\n", socketPath, strerror(errno));
+        close(listenFd);
+        return 1;
+    }
+    uint64_t graphVolume = ComputeGraphVolume(nodeNeighbors);
+    if (nbWorkers == 0) {
+        nbWorkers = omp_get_max_threads();
+    }
+    printf("Listening on %s with %i workers\n", socketPath, nbWorkers);
+    fflush(stdout);
+    uint64_t nbRequests = 0;
+    double totalLatency = 0.0;
+    bool stopping = false;
+#pragma omp parallel num_threads(nbWorkers)
+    {
+        // kept from one request to the next, so that a request only touches the memory of its walk support
+        QueryBuffers buffers;
+        while (true) {
+            int connectionFd = accept(listenFd, NULL, NULL);
+            bool stopped;
+#pragma omp atomic read
+            stopped = stopping;
+            if (connectionFd < 0) {
+                if (!stopped && (errno == EINTR || errno == ECONNABORTED)) {
+                    continue;
+                }
+                if (!stopped) {
+#pragma omp critical(serverLog)
+                    printf("Cannot accept connections: %s\n", strerror(errno));
+                }
+                break;
+            }
+            if (stopped) {
+                close(connectionFd);
+                break;
+            }
+            bool stop = ServeConnection(connectionFd, nodeNeighbors, maxNodeId, graphVolume, settings, cache, buffers, nbRequests,
+                                        totalLatency);
+            close(connectionFd);
+            if (stop) {
+#pragma omp atomic write
+                stopping = true;
+                // wakes up the workers blocked in accept
+                shutdown(listenFd, SHUT_RDWR);
+                break;
+            }
+        }
+    }
+    close(listenFd);
+    unlink(socketPath);
+    printf("Server stopped after %lu requests (average latency: %.3f ms)\n", nbRequests,
+           nbRequests > 0 ? 1000.0 * totalLatency / nbRequests : 0.0);
+    if (cache != NULL) {
+        cache->PrintStatistics();
+    }
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include "../include/stream.h"
+#include <omp.h>
+
+// Streaming mode: the seed sets are read chunkSize at a time from seedSetFileName ("-" for the standard input),
+// the seed sets of a chunk are processed in parallel, and each community is written (with its stop reason for
+// PageRank and LexRank) as soon as the communities of all the previous seed sets are written, so that the output
+// is in input order and grows while the job runs. Only one chunk of seed sets and communities is kept in memory.
+// With a cache, repeated seed sets are computed once. With a query budget, a -truncated.txt file flags the seed
+// sets whose budget was exhausted.
+int RunStream(const char* seedSetFileName,
+              const char* outputFileName,
+              uint32_t algorithmId,
+              std::vector< NodeSet >& nodeNeighbors,
+              uint32_t maxNodeId,
+              const QuerySettings& settings,
+              uint32_t chunkSize,
+              CommunityCache* cache) {
+    std::ifstream seedSetFile;
+    std::istream* seedSetStream = &std::cin;
+    if (strcmp(seedSetFileName, "-") != 0) {
+        seedSetFile.open(seedSetFileName);
+        if (!seedSetFile) {
+            printf("Cannot open the seed set file %s\n", seedSetFileName);
+            return 1;
+        }
+        seedSetStream = &seedSetFile;
+    }
+    std::string communityOutputFileName(outputFileName);
+    communityOutputFileName += "-communities.txt";
+    // the file writes overlap with the computation of the next communities
+    ResultWriter communityFile(communityOutputFileName.c_str(), true);
+    ResultWriter stopReasonFile;
+    bool hasStopReasons = algorithmId != 2;
+    if (hasStopReasons) {
+        std::string stopReasonOutputFileName(outputFileName);
+        stopReasonOutputFileName += "-stop-reasons.txt";
+        stopReasonFile.Open(stopReasonOutputFileName.c_str());
+    }
+    ResultWriter truncatedFile;
+    bool hasBudget = settings.budget.IsLimited();
+    if (hasBudget) {
+        std::string truncatedOutputFileName(outputFileName);
+        truncatedOutputFileName += "-truncated.txt";
+        truncatedFile.Open(truncatedOutputFileName.c_str());
+    }
+    printf("Streaming communities to %s (chunks of %i seed sets)...\n", communityOutputFileName.c_str(), chunkSize);
+    uint64_t graphVolume = ComputeGraphVolume(nodeNeighbors);
+    std::vector< QueryBuffers > threadBuffers (omp_get_max_threads());
+    std::vector< NodeSet > seeds;
+    std::vector< NodeSet > communities;
+    std::vector< uint32_t > stopReasons;
+    std::vector< uint8_t > completed;
+    std::vector< uint8_t > truncated;
+    uint64_t nbTruncated = 0;
+    std::vector< uint64_t > nbStopReasons (NB_STOP_REASONS, 0);
+    uint64_t nbSeedSets = 0;
+    double startTime = omp_get_wtime();
+    while (true) {
+        seeds.clear();
+        int64_t nbChunkSeedSets = ReadSeedSets(*seedSetStream, seeds, chunkSize);
+        if (nbChunkSeedSets == 0) {
+            break;
+        }
+        communities.assign(nbChunkSeedSets, NodeSet());
+        stopReasons.assign(nbChunkSeedSets, NB_STOP_REASONS);
+        completed.assign(nbChunkSeedSets, 0);
+        truncated.assign(nbChunkSeedSets, 0);
+        int64_t nextToWrite = 0;
+#pragma omp parallel for schedule(dynamic)
+        for (int64_t i = 0; i < nbChunkSeedSets; i++) {
+            bool seedSetTruncated;
+            stopReasons[i] = ComputeSeedSetCommunity(algorithmId, nodeNeighbors, seeds[i], communities[i],
+                                                     threadBuffers[omp_get_thread_num()], graphVolume, settings, cache,
+                                                     NULL, &seedSetTruncated);
+            truncated[i] = seedSetTruncated;
+            // reordering buffer: the completed communities that follow the last written one are written
+#pragma omp critical(streamWriter)
+            {
+                completed[i] = 1;
+                bool written = false;
+                while (nextToWrite < nbChunkSeedSets && completed[nextToWrite]) {
+                    communityFile.WriteCommunity(communities[nextToWrite]);
+                    NodeSet().swap(communities[nextToWrite]);
+                    NodeSet().swap(seeds[nextToWrite]);
+                    if (hasStopReasons) {
+                        stopReasonFile.WriteString(GetSweepStopReasonName(stopReasons[nextToWrite]));
+                        stopReasonFile.WriteChar('\n');
+                        nbStopReasons[stopReasons[nextToWrite]]++;
+                    }
+                    if (hasBudget) {
+                        truncatedFile.WriteString(truncated[nextToWrite] ? "1\n" : "0\n");
+                        nbTruncated += truncated[nextToWrite];
+                    }
+                    nextToWrite++;
+                    written = true;
+                }
+                if (written) {
+                    communityFile.Flush();
+                    if (hasBudget) {
+                        truncatedFile.Flush();
+                    }
+                }
+            }
+        }
+        nbSeedSets += nbChunkSeedSets;
+        printf("%lu seed sets processed (%.1f seed sets/s)\n", nbSeedSets, nbSeedSets / (omp_get_wtime() - startTime));
+        fflush(stdout);
+    }
+    int status = communityFile.Close();
+    if (hasStopReasons) {
+        status |= stopReasonFile.Close();
+        for (uint32_t stopReason = 0; stopReason < NB_STOP_REASONS; stopReason++) {
+            printf("Sweeps stopped by %s: %lu\n", GetSweepStopReasonName(stopReason), nbStopReasons[stopReason]);
+        }
+    }
+    if (hasBudget) {
+        status |= truncatedFile.Close();
+        printf("Seed sets truncated by their budget: %lu\n", nbTruncated);
+    }
+    if (cache != NULL) {
+        cache->PrintStatistics();
+    }
+    return status;
+}
@@ -0,0 +1,153 @@
+#include "../include/writer.h"
+#include <errno.h>
+
+ResultWriter::ResultWriter() : file(NULL), bufferSize(0), used(0), failed(false), background(false), closing(false) {}
+
+ResultWriter::ResultWriter(const char* fileName, bool background, size_t bufferSize)
+    : file(NULL), bufferSize(0), used(0), failed(false), background(false), closing(false) {
+    Open(fileName, background, bufferSize);
+}
+
+ResultWriter::~ResultWriter() {
+    Close();
+}
+
+bool ResultWriter::Open(const char* fileName, bool background, size_t bufferSize) {
+    Close();
+    file = fopen(fileName, "w");
+    if (file == NULL) {
+        printf("Cannot open %s: %s\n", fileName, strerror(errno));
+        // reported by Close
+        failed = true;
+        return false;
+    }
+    this->bufferSize = bufferSize;
+    buffer.resize(bufferSize);
+    used = 0;
+    failed = false;
+    closing = false;
+    this->background = background;
+    if (background) {
+        writerThread = std::thread(&ResultWriter::WriterLoop, this);
+    }
+    return true;
+}
+
+void ResultWriter::Write(const char* data, size_t size) {
+    if (size == 0) {
+        return;
+    }
+    Reserve(size);
+    memcpy(&buffer[used], data, size);
+    used += size;
+}
+
+void ResultWriter::WriteDouble(double value) {
+    Reserve(32);
+    used += snprintf(&buffer[used], 32, "%g", value);
+}
+
+void ResultWriter::WriteCommunity(const NodeSet& community) {
+    for (NodeSet::const_iterator it = community.begin(); it != community.end(); ++it) {
+        if (it != community.begin()) {
+            WriteChar(' ');
+        }
+        WriteUInt(*it);
+    }
+    WriteChar('\n');
+}
+
+// Writes the buffered bytes, or queues them for the thread of the writer
+void ResultWriter::Submit(bool flush) {
+    if (file == NULL) {
+        used = 0;
+        return;
+    }
+    if (!background) {
+        if (used > 0 && fwrite(&buffer[0], 1, used, file) != used) {
+            failed = true;
+        }
+        if (flush && fflush(file) != 0) {
+            failed = true;
+        }
+        used = 0;
+        return;
+    }
+    if (used == 0 && !flush) {
+        return;
+    }
+    std::vector< char > nextBuffer;
+    {
+        std::unique_lock< std::mutex > lock(mutex);
+        while (pendingBuffers.size() >= maxPendingBuffers) {
+            condition.wait(lock);
+        }
+        buffer.resize(used);
+        pendingBuffers.push_back(std::make_pair(std::vector< char >(), flush));
+        pendingBuffers.back().first.swap(buffer);
+        if (!freeBuffers.empty()) {
+            nextBuffer.swap(freeBuffers.back());
+            freeBuffers.pop_back();
+        }
+    }
+    condition.notify_all();
+    // the recycled buffers keep their capacity
+    nextBuffer.resize(bufferSize);
+    buffer.swap(nextBuffer);
+    used = 0;
+}
+
+void ResultWriter::WriterLoop() {
+    std::unique_lock< std::mutex > lock(mutex);
+    while (true) {
+        while (pendingBuffers.empty() && !closing) {
+            condition.wait(lock);
+        }
+        if (pendingBuffers.empty()) {
+            break;
+        }
+        std::vector< char > bytes;
+        bytes.swap(pendingBuffers.front().first);
+        bool flush = pendingBuffers.front().second;
+        pendingBuffers.pop_front();
+        lock.unlock();
+        bool writeFailed = !bytes.empty() && fwrite(&bytes[0], 1, bytes.size(), file) != bytes.size();
+        writeFailed = (flush && fflush(file) != 0) || writeFailed;
+        lock.lock();
+        failed = failed || writeFailed;
+        freeBuffers.push_back(std::vector< char >());
+        freeBuffers.back().swap(bytes);
+        condition.notify_all();
+    }
+}
+
+void ResultWriter::Flush() {
+    Submit(true);
+}
+
+int ResultWriter::Close() {
+    if (file == NULL) {
+        int status = failed ? 1 : 0;
+        failed = false;
+        return status;
+    }
+    Submit(false);
+    if (background) {
+        {
+            std::lock_guard< std::mutex > lock(mutex);
+            closing = true;
+        }
+        condition.notify_all();
+        writerThread.join();
+        freeBuffers.clear();
+        background = false;
+    }
+    if (fclose(file) != 0) {
+        failed = true;
+    }
+    file = NULL;
+    std::vector< char >().swap(buffer);
+    int status = failed ? 1 : 0;
+    failed = false;
+    return status;
+}
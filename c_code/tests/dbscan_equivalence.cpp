@@ -0,0 +1,330 @@
+// Equivalence of the DBSCAN engines: on random inputs and on lattices (many equal distances, and distances equal
+// to eps), every engine must give the labels of DBSCAN::fit, and with feature weights those of DBSCAN::wfit.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "dbscan.h"
+
+using namespace clustering;
+
+namespace {
+
+typedef void ( *FitFunction )( DBSCAN& dbs, const DBSCAN::ClusterData& C );
+
+struct Engine {
+    const char* name;
+    FitFunction fit;
+    int num_threads;
+};
+
+void fit_indexed( DBSCAN& dbs, const DBSCAN::ClusterData& C ) { dbs.fit_indexed( C ); }
+void fit_grid( DBSCAN& dbs, const DBSCAN::ClusterData& C ) { dbs.fit_grid( C ); }
+// the smallest budget: blocks of 64 points, several per input
+void fit_streaming( DBSCAN& dbs, const DBSCAN::ClusterData& C ) { dbs.fit_streaming( C, 1 ); }
+void fit_parallel( DBSCAN& dbs, const DBSCAN::ClusterData& C ) { dbs.fit_parallel( C ); }
+
+typedef void ( *WeightedFitFunction )( DBSCAN& dbs, const DBSCAN::ClusterData& C, const DBSCAN::FeaturesWeights& W );
+
+struct WeightedEngine {
+    const char* name;
+    WeightedFitFunction fit;
+    int num_threads;
+};
+
+void wfit_indexed( DBSCAN& dbs, const DBSCAN::ClusterData& C, const DBSCAN::FeaturesWeights& W ) { dbs.wfit_indexed( C, W ); }
+void wfit_grid( DBSCAN& dbs, const DBSCAN::ClusterData& C, const DBSCAN::FeaturesWeights& W ) { dbs.wfit_grid( C, W ); }
+void wfit_streaming( DBSCAN& dbs, const DBSCAN::ClusterData& C, const DBSCAN::FeaturesWeights& W ) { dbs.wfit_streaming( C, W, 1 ); }
+void wfit_parallel( DBSCAN& dbs, const DBSCAN::ClusterData& C, const DBSCAN::FeaturesWeights& W ) { dbs.wfit_parallel( C, W ); }
+
+const Engine engines[] = {
+    { "fit_indexed", fit_indexed, 1 },
+    { "fit_grid", fit_grid, 1 },
+    { "fit_streaming", fit_streaming, 1 },
+    // the labels do not depend on the order of the concurrent unions
+    { "fit_parallel", fit_parallel, 4 },
+};
+
+// wfit and wfit_streaming use the SIMD distance kernel, the others l1_distance: with non-unit weights, a fused
+// multiply-add in the kernel would round differently
+const WeightedEngine weighted_engines[] = {
+    { "wfit_indexed", wfit_indexed, 1 },
+    { "wfit_grid", wfit_grid, 1 },
+    { "wfit_streaming", wfit_streaming, 1 },
+    { "wfit_parallel", wfit_parallel, 4 },
+};
+
+double random_unit()
+{
+    return rand() / ( RAND_MAX + 1.0 );
+}
+
+DBSCAN::ClusterData uniform_data( size_t elements_num, size_t features_num )
+{
+    DBSCAN::ClusterData C( elements_num, features_num );
+    for ( size_t i = 0; i < elements_num; ++i ) {
+        for ( size_t j = 0; j < features_num; ++j ) {
+            C( i, j ) = random_unit();
+        }
+    }
+    return C;
+}
+
+// Integer coordinates in [0, side), with repeated points
+DBSCAN::ClusterData lattice_data( size_t elements_num, size_t features_num, int side )
+{
+    DBSCAN::ClusterData C( elements_num, features_num );
+    for ( size_t i = 0; i < elements_num; ++i ) {
+        for ( size_t j = 0; j < features_num; ++j ) {
+            C( i, j ) = rand() % side;
+        }
+    }
+    return C;
+}
+
+struct Input {
+    std::string name;
+    DBSCAN::ClusterData data;
+    DBSCAN::FeaturesWeights weights;
+    double eps;
+    size_t min_elems;
+};
+
+std::vector< Input > make_inputs()
+{
+    std::vector< Input > inputs;
+    srand( 12345 );
+    for ( int k = 0; k < 200; ++k ) {
+        size_t features_num = 2 + k % 3;
+        size_t elements_num = 20 + rand() % 300;
+        Input input;
+        if ( k % 2 == 0 ) {
+            input.name = "uniform";
+            input.data = uniform_data( elements_num, features_num );
+            input.eps = 0.02 + 0.2 * random_unit();
+        } else {
+            // eps is relative to the largest distance, features_num once two opposite corners are drawn: it is
+            // then a multiple of the lattice step, and many pairs are exactly at eps
+            int side = 3 + rand() % 6;
+            input.name = "lattice";
+            input.data = lattice_data( elements_num, features_num, side );
+            input.eps = ( 1 + rand() % 3 ) / double( ( side - 1 ) * features_num );
+        }
+        input.weights = DBSCAN::FeaturesWeights( features_num );
+        for ( size_t j = 0; j < features_num; ++j ) {
+            input.weights( j ) = 0.3 + 1.7 * random_unit();
+        }
+        input.min_elems = 2 + rand() % 5;
+        inputs.push_back( input );
+    }
+    return inputs;
+}
+
+int compare_labels( const char* engine, const Input& input, size_t index, const DBSCAN::Labels& expected,
+                    const DBSCAN::Labels& labels )
+{
+    if ( labels.size() != expected.size() ) {
+        printf( "%s: %lu labels instead of %lu on input %lu (%s)\n", engine, labels.size(), expected.size(), index,
+                input.name.c_str() );
+        return 1;
+    }
+    for ( size_t i = 0; i < labels.size(); ++i ) {
+        if ( labels[i] != expected[i] ) {
+            printf( "%s: label %d instead of %d for point %lu of input %lu (%s, %lu points, eps %g, min_elems %lu)\n",
+                    engine, labels[i], expected[i], i, index, input.name.c_str(), labels.size(), input.eps,
+                    input.min_elems );
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// fit_eps_sweep gives, for each eps of a list, the labels of fit at that eps
+int check_eps_sweep( const Input& input, size_t index )
+{
+    const double factors[] = { 0.5, 1.0, 0.75, 1.5, 1.0, 2.0 };    // unsorted, with a repeated eps
+    std::vector< double > eps_list;
+    for ( size_t i = 0; i < sizeof( factors ) / sizeof( factors[0] ); ++i ) {
+        eps_list.push_back( input.eps * factors[i] );
+    }
+    std::vector< DBSCAN::Labels > labels_list;
+    DBSCAN dbs( input.eps, input.min_elems, 1 );
+    dbs.fit_eps_sweep( input.data, eps_list, labels_list );
+    if ( labels_list.size() != eps_list.size() ) {
+        printf( "fit_eps_sweep: %lu labelings for %lu eps on input %lu\n", labels_list.size(), eps_list.size(), index );
+        return 1;
+    }
+    int nb_failures = 0;
+    for ( size_t i = 0; i < eps_list.size(); ++i ) {
+        DBSCAN reference( eps_list[i], input.min_elems, 1 );
+        reference.fit( input.data );
+        nb_failures += compare_labels( "fit_eps_sweep", input, index, reference.get_labels(), labels_list[i] );
+    }
+    return nb_failures;
+}
+
+// Smallest gap between eps and a pair distance, on the data normalized like fit does; near_eps flags the points with a
+// pair distance within tolerance of eps
+double eps_gap( const Input& input, double tolerance, std::vector< bool >& near_eps )
+{
+    DBSCAN::ClusterData C( input.data );
+    for ( size_t j = 0; j < C.size2(); ++j ) {
+        double data_min = C( 0, j );
+        double data_max = C( 0, j );
+        for ( size_t i = 0; i < C.size1(); ++i ) {
+            data_min = std::min( data_min, C( i, j ) );
+            data_max = std::max( data_max, C( i, j ) );
+        }
+        double data_range = data_max > data_min ? data_max - data_min : 1.0;
+        for ( size_t i = 0; i < C.size1(); ++i ) {
+            C( i, j ) = ( C( i, j ) - data_min ) / data_range;
+        }
+    }
+    DBSCAN::DistanceMatrix distances( C.size1(), C.size1() );
+    double dmax = 0.0;
+    for ( size_t p = 0; p < C.size1(); ++p ) {
+        for ( size_t q = 0; q < C.size1(); ++q ) {
+            double d = 0.0;
+            for ( size_t j = 0; j < C.size2(); ++j ) {
+                d += fabs( C( p, j ) - C( q, j ) );
+            }
+            distances( p, q ) = d;
+            dmax = std::max( dmax, d );
+        }
+    }
+    const double eps = input.eps * dmax;
+    double gap = INFINITY;
+    near_eps.assign( C.size1(), false );
+    for ( size_t p = 0; p < C.size1(); ++p ) {
+        for ( size_t q = 0; q < C.size1(); ++q ) {
+            if ( q != p ) {
+                gap = std::min( gap, fabs( distances( p, q ) - eps ) );
+                near_eps[p] = near_eps[p] || fabs( distances( p, q ) - eps ) <= tolerance;
+            }
+        }
+    }
+    return gap;
+}
+
+// Points whose label does not match up to a renumbering of the clusters: a point agrees when it is noise in both, or
+// when its cluster in labels is the one most of its cluster in expected went to, and the other way around
+size_t relabeled_disagreements( const DBSCAN::Labels& expected, const DBSCAN::Labels& labels, std::vector< bool >& disagrees )
+{
+    std::map< std::pair< int32_t, int32_t >, size_t > counts;
+    for ( size_t i = 0; i < labels.size(); ++i ) {
+        counts[std::make_pair( expected[i], labels[i] )]++;
+    }
+    std::map< int32_t, std::pair< size_t, int32_t > > to_labels;      // most frequent image, with its count
+    std::map< int32_t, std::pair< size_t, int32_t > > to_expected;
+    for ( std::map< std::pair< int32_t, int32_t >, size_t >::const_iterator it = counts.begin(); it != counts.end(); ++it ) {
+        std::pair< size_t, int32_t >& to_label = to_labels[it->first.first];
+        to_label = std::max( to_label, std::make_pair( it->second, it->first.second ) );
+        std::pair< size_t, int32_t >& to_expect = to_expected[it->first.second];
+        to_expect = std::max( to_expect, std::make_pair( it->second, it->first.first ) );
+    }
+    size_t nb_disagreements = 0;
+    disagrees.assign( labels.size(), false );
+    for ( size_t i = 0; i < labels.size(); ++i ) {
+        disagrees[i] = ( expected[i] >= 0 || labels[i] >= 0 )
+                       && ( to_labels[expected[i]].second != labels[i] || to_expected[labels[i]].second != expected[i] );
+        nb_disagreements += disagrees[i];
+    }
+    return nb_disagreements;
+}
+
+struct Agreement {
+    size_t nb_points;
+    size_t nb_disagreements;
+};
+
+// fit_quantized rounds each normalized feature to a multiple of 1 / 65535 (with eps < 1): only the pairs whose distance
+// is within ( features_num + 1 ) / 65535 of eps can be neighbors for one engine and not for the other. Without such
+// a pair the labels must be those of fit. Otherwise, every point labeled differently (up to a renumbering of the
+// clusters) must have such a pair, or be in a cluster of either labeling with a point that has one; the points of the
+// input and those labeled differently are counted in agreement.
+int check_quantized( const Input& input, size_t index, const DBSCAN::Labels& expected, Agreement& agreement )
+{
+    DBSCAN dbs( input.eps, input.min_elems, 1 );
+    dbs.fit_quantized( input.data );
+    const DBSCAN::Labels& labels = dbs.get_labels();
+    const double tolerance = ( input.data.size2() + 1 ) / 65535.0;
+    std::vector< bool > near_eps;
+    if ( eps_gap( input, tolerance, near_eps ) > tolerance || labels.size() != expected.size() ) {
+        return compare_labels( "fit_quantized", input, index, expected, labels );
+    }
+    std::set< int32_t > expected_near_clusters;
+    std::set< int32_t > near_clusters;
+    for ( size_t i = 0; i < labels.size(); ++i ) {
+        if ( near_eps[i] ) {
+            expected_near_clusters.insert( expected[i] );
+            near_clusters.insert( labels[i] );
+        }
+    }
+    std::vector< bool > disagrees;
+    agreement.nb_points += labels.size();
+    agreement.nb_disagreements += relabeled_disagreements( expected, labels, disagrees );
+    for ( size_t i = 0; i < labels.size(); ++i ) {
+        // the noise is not a cluster: a point near eps elsewhere does not explain it
+        bool explained = near_eps[i] || ( expected[i] >= 0 && expected_near_clusters.count( expected[i] ) > 0 )
+                         || ( labels[i] >= 0 && near_clusters.count( labels[i] ) > 0 );
+        if ( disagrees[i] && !explained ) {
+            printf( "fit_quantized: label %d instead of %d for point %lu of input %lu (%s), without a pair near eps\n",
+                    labels[i], expected[i], i, index, input.name.c_str() );
+            return 1;
+        }
+    }
+    return 0;
+}
+
+}
+
+int main()
+{
+    std::vector< Input > inputs = make_inputs();
+    int nb_failures = 0;
+    // fit_quantized on the inputs with pairs near eps: random ones, and lattices with pairs exactly at eps
+    Agreement uniform_agreement = { 0, 0 };
+    Agreement lattice_agreement = { 0, 0 };
+    for ( size_t k = 0; k < inputs.size(); ++k ) {
+        const Input& input = inputs[k];
+        DBSCAN reference( input.eps, input.min_elems, 1 );
+        reference.fit( input.data );
+        for ( size_t e = 0; e < sizeof( engines ) / sizeof( engines[0] ); ++e ) {
+            DBSCAN dbs( input.eps, input.min_elems, engines[e].num_threads );
+            engines[e].fit( dbs, input.data );
+            nb_failures += compare_labels( engines[e].name, input, k, reference.get_labels(), dbs.get_labels() );
+        }
+        DBSCAN weighted_reference( input.eps, input.min_elems, 1 );
+        weighted_reference.wfit( input.data, input.weights );
+        for ( size_t e = 0; e < sizeof( weighted_engines ) / sizeof( weighted_engines[0] ); ++e ) {
+            DBSCAN dbs( input.eps, input.min_elems, weighted_engines[e].num_threads );
+            weighted_engines[e].fit( dbs, input.data, input.weights );
+            nb_failures += compare_labels( weighted_engines[e].name, input, k, weighted_reference.get_labels(),
+                                           dbs.get_labels() );
+        }
+        nb_failures += check_eps_sweep( input, k );
+        Agreement& agreement = input.name == "uniform" ? uniform_agreement : lattice_agreement;
+        nb_failures += check_quantized( input, k, reference.get_labels(), agreement );
+    }
+    // a pair at eps may be on either side of the quantized eps, and one such pair can split or merge clusters: up to
+    // a renumbering of the clusters, the random inputs must agree on 99% of their points. The lattices have many pairs
+    // exactly at eps, which the rounding moves together (22% of their points change cluster): at most 25%.
+    printf( "fit_quantized near eps: %lu of %lu random points, %lu of %lu lattice points labeled differently\n",
+            uniform_agreement.nb_disagreements, uniform_agreement.nb_points, lattice_agreement.nb_disagreements,
+            lattice_agreement.nb_points );
+    if ( uniform_agreement.nb_disagreements * 100 > uniform_agreement.nb_points ) {
+        printf( "fit_quantized: label agreement below 99%% on the random inputs\n" );
+        nb_failures++;
+    }
+    if ( lattice_agreement.nb_disagreements * 4 > lattice_agreement.nb_points ) {
+        printf( "fit_quantized: label agreement below 75%% on the lattices\n" );
+        nb_failures++;
+    }
+    printf( "%lu inputs, %d failures\n", inputs.size(), nb_failures );
+    return nb_failures == 0 ? 0 : 1;
+}
@@ -3,14 +3,24 @@ import numpy as np
 import networkx as nx
 from sklearn.cluster import DBSCAN
 
+try:
+    import walkscan_engine
+except ImportError:
+    walkscan_engine = None
+
 
 class WalkSCAN:
 
-    def __init__(self, nb_steps=2, eps=0.1, min_samples=3):
+    def __init__(self, nb_steps=2, eps=0.1, min_samples=3, use_engine=False):
         self.nb_steps = nb_steps
         self.eps = eps
         self.min_samples = min_samples
         self.dbscan_ = DBSCAN(eps=self.eps, min_samples=self.min_samples)
+        # opt-in: the C++ engine computes other communities (see the README), with eps and min_samples read as its
+        # epsilon and min_elems
+        self.use_engine = use_engine
+        self.engine_ = None
+        self.engine_graph_ = None
 
     def load(self, graph, init_vector):
         self.graph = graph.copy()
@@ -75,7 +85,33 @@ class WalkSCAN:
                 community |= set(nx.neighbors(self.graph, node)) & self.outliers_
             self.communities_.append(community)
 
+    def engine_supports(self, graph, init_vector):
+        # the C++ engine starts the walk uniformly from the seeds and ignores edge weights
+        if not self.use_engine or walkscan_engine is None or len(init_vector) == 0:
+            return False
+        if len(set(init_vector.values())) > 1:
+            return False
+        if any('weight' in e_data for (_, _, e_data) in graph.edges(data=True)):
+            return False
+        try:
+            walkscan_engine._load_library()
+        except OSError:
+            return False
+        return True
+
+    def detect_communities_engine(self, graph, init_vector):
+        # the graph is loaded in the engine once, and reused while the same graph is given
+        if self.engine_graph_ is not graph:
+            self.engine_ = walkscan_engine.Engine.from_networkx(graph)
+            self.engine_graph_ = graph
+        clusters = self.engine_.query_clusters(list(init_vector.keys()), nb_steps=self.nb_steps,
+                                               epsilon=self.eps, min_elems=self.min_samples)
+        self.communities_ = [set(cluster) for cluster in clusters]
+
     def detect_communities(self, graph, init_vector):
+        if self.engine_supports(graph, init_vector):
+            self.detect_communities_engine(graph, init_vector)
+            return
         self.load(graph, init_vector)
         self.embed_nodes()
         self.find_cores()
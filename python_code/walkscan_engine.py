@@ -0,0 +1,360 @@
+"""Python bindings of the C++ engine (libwalkscan, see the c_code directory).
+
+The graph is given as a CSR adjacency (NumPy arrays, a SciPy sparse matrix or a NetworkX graph) and loaded once
+into an engine, then PageRank, LexRank and WalkSCAN communities are computed by the C++ code, one seed set or a
+batch at a time. The calls release the GIL (ctypes does for the foreign functions), so that other Python threads
+run during a batch, which is itself processed in parallel by the C++ code.
+
+The library is looked up in the WALKSCAN_LIBRARY environment variable, then in c_code/build, then in the system
+library path.
+"""
+import ctypes
+import ctypes.util
+import os
+
+import numpy as np
+
+PAGERANK = 0
+LEXRANK = 1
+WALKSCAN = 2
+
+_OK = 0
+_ERROR_INVALID_ARGUMENT = 1
+_ERROR_INVALID_NODE = 2
+_ERROR_BUFFER_TOO_SMALL = 3
+_ERROR_INTERNAL = 4
+
+# Seed sets of a batch call, and nodes per seed set of its first output buffer
+_BATCH_SIZE = 4096
+_BATCH_NODES_PER_SEED_SET = 4096
+
+
+class _Settings(ctypes.Structure):
+    _fields_ = [('nb_steps', ctypes.c_uint32),
+                ('epsilon', ctypes.c_double),
+                ('min_elems', ctypes.c_uint32),
+                ('max_volume_ratio', ctypes.c_double),
+                ('patience', ctypes.c_uint32),
+                ('max_frontier_size', ctypes.c_uint32),
+                ('max_pushed_edges', ctypes.c_uint64),
+                ('time_limit', ctypes.c_double),
+                ('rho', ctypes.c_double),
+                ('quantized', ctypes.c_int),
+                ('dbscan_memory_budget', ctypes.c_uint64),
+                ('nb_threads', ctypes.c_uint32)]
+
+
+_u32p = ctypes.POINTER(ctypes.c_uint32)
+_u64p = ctypes.POINTER(ctypes.c_uint64)
+_u8p = ctypes.POINTER(ctypes.c_uint8)
+_sizep = ctypes.POINTER(ctypes.c_size_t)
+_library = None
+
+
+def _load_library():
+    global _library
+    if _library is not None:
+        return _library
+    candidates = []
+    if os.environ.get('WALKSCAN_LIBRARY'):
+        candidates.append(os.environ['WALKSCAN_LIBRARY'])
+    here = os.path.dirname(os.path.abspath(__file__))
+    candidates.append(os.path.join(here, '..', 'c_code', 'build', 'libwalkscan.so'))
+    found = ctypes.util.find_library('walkscan')
+    if found:
+        candidates.append(found)
+    for candidate in candidates:
+        try:
+            library = ctypes.CDLL(candidate)
+            break
+        except OSError:
+            continue
+    else:
+        raise OSError('libwalkscan not found (build c_code or set WALKSCAN_LIBRARY)')
+    library.walkscan_default_settings.argtypes = [ctypes.POINTER(_Settings)]
+    library.walkscan_default_settings.restype = None
+    library.walkscan_engine_from_csr.argtypes = [ctypes.c_uint32, _u64p, _u32p, ctypes.c_uint64]
+    library.walkscan_engine_from_csr.restype = ctypes.c_void_p
+    library.walkscan_engine_load.argtypes = [ctypes.c_char_p]
+    library.walkscan_engine_load.restype = ctypes.c_void_p
+    library.walkscan_engine_free.argtypes = [ctypes.c_void_p]
+    library.walkscan_engine_free.restype = None
+    library.walkscan_engine_nb_nodes.argtypes = [ctypes.c_void_p]
+    library.walkscan_engine_nb_nodes.restype = ctypes.c_uint32
+    library.walkscan_engine_nb_edges.argtypes = [ctypes.c_void_p]
+    library.walkscan_engine_nb_edges.restype = ctypes.c_uint64
+    library.walkscan_query.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.POINTER(_Settings), _u32p, ctypes.c_size_t,
+                                       _u32p, ctypes.c_size_t, _sizep, _u32p, _u8p]
+    library.walkscan_query.restype = ctypes.c_int
+    library.walkscan_query_clusters.argtypes = [ctypes.c_void_p, ctypes.POINTER(_Settings), _u32p, ctypes.c_size_t,
+                                                _u64p, ctypes.c_size_t, _sizep, _u32p, ctypes.c_size_t, _sizep, _u8p]
+    library.walkscan_query_clusters.restype = ctypes.c_int
+    library.walkscan_query_batch.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.POINTER(_Settings), _u64p, _u32p,
+                                             ctypes.c_size_t, _u64p, _u32p, ctypes.c_size_t, _u32p, _u8p]
+    library.walkscan_query_batch.restype = ctypes.c_int
+    library.walkscan_stop_reason_name.argtypes = [ctypes.c_uint32]
+    library.walkscan_stop_reason_name.restype = ctypes.c_char_p
+    _library = library
+    return library
+
+
+def _as_array(values, dtype):
+    """values as a C-contiguous array of the unsigned integer type dtype, without copy when it already is one. Other
+    integer arrays are converted once their values are checked to fit in dtype (negative values are rejected)."""
+    array = np.asarray(values)
+    if array.dtype == dtype and array.flags['C_CONTIGUOUS']:
+        return array
+    if array.size > 0:
+        if array.dtype.kind not in 'iu':
+            raise ValueError('integer values expected, not %s' % array.dtype)
+        if array.min() < 0 or array.max() > np.iinfo(dtype).max:
+            raise ValueError('values out of the range of %s' % np.dtype(dtype).name)
+    return np.ascontiguousarray(array, dtype=dtype)
+
+
+def _pointer(array, pointer_type):
+    return array.ctypes.data_as(pointer_type)
+
+
+def _check(status):
+    if status == _ERROR_INVALID_NODE:
+        raise ValueError('seed node not in the graph')
+    if status == _ERROR_INVALID_ARGUMENT:
+        raise ValueError('invalid argument (unknown algorithm or empty seed set)')
+    if status == _ERROR_INTERNAL:
+        raise MemoryError('libwalkscan query failed (out of memory)')
+    if status != _OK:
+        raise RuntimeError('libwalkscan error %d' % status)
+
+
+def stop_reason_name(stop_reason):
+    """Name of a stop reason of the conductance sweep, as in the -stop-reasons.txt files"""
+    return _load_library().walkscan_stop_reason_name(int(stop_reason)).decode('ascii')
+
+
+class Engine(object):
+    """Graph loaded once in the C++ engine, and the queries against it.
+
+    The keyword arguments of the queries are the parameters of the walkscan command line: nb_steps (-t), epsilon,
+    min_elems, max_volume_ratio, patience, max_frontier_size, max_pushed_edges, time_limit (in seconds), rho,
+    quantized, dbscan_memory_budget (in bytes) and nb_threads (threads of query_batch only). Nodes are the indices
+    of the CSR adjacency, or the NetworkX labels for an engine built by from_networkx.
+    """
+
+    def __init__(self, handle, nodes=None):
+        # set first, so that close (and __del__) work even if the constructor raises
+        self._handle = None
+        self._library = _load_library()
+        if not handle:
+            raise ValueError('invalid graph')
+        self._handle = handle
+        # labels of the nodes (NetworkX graphs), None for CSR indices
+        self.nodes = nodes
+        self._node_index = None if nodes is None else dict((node, i) for (i, node) in enumerate(nodes))
+
+    @classmethod
+    def from_csr(cls, indptr, indices):
+        """Engine of the adjacency whose neighbors of node u are indices[indptr[u]:indptr[u + 1]] (the graph is
+        made undirected). The engine converts the adjacency once into its own structure (one std::set of neighbors
+        per node, about 48 bytes per edge in each direction and 48 bytes per node), so the arrays can be freed once it
+        is built; indptr and indices of other integer types than uint64 and uint32 are converted first."""
+        indptr = _as_array(indptr, np.uint64)
+        indices = _as_array(indices, np.uint32)
+        if indptr.ndim != 1 or indices.ndim != 1:
+            raise ValueError('indptr and indices must be 1-dimensional')
+        if len(indptr) < 2 or len(indptr) - 1 > np.iinfo(np.uint32).max:
+            raise ValueError('indptr must have between 2 and 2^32 entries')
+        if indptr[0] != 0 or np.any(indptr[1:] < indptr[:-1]) or indptr[-1] > len(indices):
+            raise ValueError('indptr must start at 0, not decrease and end at most at len(indices)')
+        library = _load_library()
+        handle = library.walkscan_engine_from_csr(len(indptr) - 1, _pointer(indptr, _u64p), _pointer(indices, _u32p),
+                                                  len(indices))
+        return cls(handle)
+
+    @classmethod
+    def from_scipy(cls, matrix):
+        """Engine of the adjacency matrix of a SciPy sparse matrix, converted to CSR first if needed (see from_csr:
+        the 32-bit indptr of the smaller CSR matrices is widened before the conversion to the engine structure)"""
+        if matrix.format != 'csr':
+            matrix = matrix.tocsr()
+        return cls.from_csr(matrix.indptr, matrix.indices)
+
+    @classmethod
+    def from_networkx(cls, graph):
+        """Engine of a NetworkX graph (unweighted), whose queries take and return node labels"""
+        nodes = list(graph.nodes())
+        node_index = dict((node, i) for (i, node) in enumerate(nodes))
+        indptr = np.zeros(len(nodes) + 1, dtype=np.uint64)
+        indices = []
+        for (i, node) in enumerate(nodes):
+            neighbors = [node_index[neighbor] for neighbor in graph.neighbors(node)]
+            indices.extend(neighbors)
+            indptr[i + 1] = indptr[i] + len(neighbors)
+        engine = cls.from_csr(indptr, np.array(indices, dtype=np.uint32))
+        engine.nodes = nodes
+        engine._node_index = node_index
+        return engine
+
+    @classmethod
+    def load(cls, graph_file_name):
+        """Engine of a graph file of the -i flag of walkscan (tab-separated list of edges)"""
+        handle = _load_library().walkscan_engine_load(graph_file_name.encode('utf-8'))
+        return cls(handle)
+
+    def close(self):
+        if self._handle:
+            self._library.walkscan_engine_free(self._handle)
+            self._handle = None
+
+    def __del__(self):
+        self.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    @property
+    def nb_nodes(self):
+        return self._library.walkscan_engine_nb_nodes(self._handle)
+
+    @property
+    def nb_edges(self):
+        return self._library.walkscan_engine_nb_edges(self._handle)
+
+    def _settings(self, parameters):
+        settings = _Settings()
+        self._library.walkscan_default_settings(ctypes.byref(settings))
+        for (name, value) in parameters.items():
+            if not hasattr(settings, name):
+                raise TypeError('unknown parameter %s' % name)
+            setattr(settings, name, value)
+        return settings
+
+    def _seed_array(self, seeds):
+        if self._node_index is not None:
+            try:
+                seeds = [self._node_index[node] for node in seeds]
+            except KeyError as error:
+                raise ValueError('seed node %r not in the graph' % (error.args[0],))
+        return _as_array(list(seeds) if not hasattr(seeds, 'dtype') else seeds, np.uint32)
+
+    def _labels(self, community):
+        if self.nodes is None:
+            return community
+        return [self.nodes[i] for i in community]
+
+    def query(self, seeds, algorithm=WALKSCAN, **parameters):
+        """Community of one seed set (the seeds included), as a uint32 array (a list of labels for NetworkX graphs)"""
+        settings = self._settings(parameters)
+        seeds = self._seed_array(seeds)
+        capacity = min(self.nb_nodes, 1024)
+        size = ctypes.c_size_t(0)
+        while True:
+            community = np.empty(capacity, dtype=np.uint32)
+            status = self._library.walkscan_query(self._handle, algorithm, ctypes.byref(settings),
+                                                  _pointer(seeds, _u32p), len(seeds), _pointer(community, _u32p),
+                                                  capacity, ctypes.byref(size), None, None)
+            if status != _ERROR_BUFFER_TOO_SMALL:
+                break
+            capacity = size.value
+        _check(status)
+        return self._labels(community[:size.value])
+
+    def query_clusters(self, seeds, **parameters):
+        """All the WalkSCAN communities of one seed set, ordered by decreasing closeness to the seeds (the seeds are
+        not added to them), as uint32 arrays (lists of labels for NetworkX graphs)"""
+        settings = self._settings(parameters)
+        seeds = self._seed_array(seeds)
+        max_clusters = 64
+        capacity = min(self.nb_nodes, 1024)
+        nb_clusters = ctypes.c_size_t(0)
+        nb_nodes = ctypes.c_size_t(0)
+        while True:
+            offsets = np.empty(max_clusters + 1, dtype=np.uint64)
+            nodes = np.empty(max(capacity, 1), dtype=np.uint32)
+            status = self._library.walkscan_query_clusters(self._handle, ctypes.byref(settings),
+                                                           _pointer(seeds, _u32p), len(seeds),
+                                                           _pointer(offsets, _u64p), max_clusters,
+                                                           ctypes.byref(nb_clusters), _pointer(nodes, _u32p),
+                                                           capacity, ctypes.byref(nb_nodes), None)
+            if status != _ERROR_BUFFER_TOO_SMALL:
+                break
+            max_clusters = max(max_clusters, nb_clusters.value)
+            capacity = max(capacity, nb_nodes.value)
+        _check(status)
+        return [self._labels(nodes[offsets[i]:offsets[i + 1]]) for i in range(nb_clusters.value)]
+
+    def query_batch(self, seed_sets, algorithm=WALKSCAN, return_details=False, **parameters):
+        """Communities of a batch of seed sets (the seeds included), processed in parallel by the C++ code, as a list
+        of uint32 arrays (views of a single array; lists of labels for NetworkX graphs). seed_sets is a list of seed
+        sets, or a pair (offsets, nodes) of arrays in CSR form. With return_details, the stop reasons of the sweeps
+        and the truncated flags are returned as well (two arrays)."""
+        settings = self._settings(parameters)
+        if isinstance(seed_sets, tuple):
+            seed_offsets = _as_array(seed_sets[0], np.uint64)
+            seed_nodes = _as_array(seed_sets[1], np.uint32)
+            if self._node_index is not None:
+                seed_nodes = np.array([self._node_index[node] for node in seed_sets[1]], dtype=np.uint32)
+        else:
+            arrays = [self._seed_array(seeds) for seeds in seed_sets]
+            seed_offsets = np.zeros(len(arrays) + 1, dtype=np.uint64)
+            seed_offsets[1:] = np.cumsum([len(array) for array in arrays])
+            seed_nodes = np.concatenate(arrays) if arrays else np.empty(0, dtype=np.uint32)
+        nb_seed_sets = len(seed_offsets) - 1
+        communities = []
+        stop_reasons = np.empty(nb_seed_sets, dtype=np.uint32)
+        truncated = np.empty(nb_seed_sets, dtype=np.uint8)
+        for first in range(0, nb_seed_sets, _BATCH_SIZE):
+            last = min(first + _BATCH_SIZE, nb_seed_sets)
+            # the seed sets of the chunk, rebased on their first node
+            offsets = seed_offsets[first:last + 1] - seed_offsets[first]
+            nodes = seed_nodes[int(seed_offsets[first]):]
+            community_offsets = np.empty(last - first + 1, dtype=np.uint64)
+            capacity = (last - first) * min(self.nb_nodes, _BATCH_NODES_PER_SEED_SET)
+            while True:
+                community_nodes = np.empty(max(capacity, 1), dtype=np.uint32)
+                status = self._library.walkscan_query_batch(self._handle, algorithm, ctypes.byref(settings),
+                                                            _pointer(offsets, _u64p), _pointer(nodes, _u32p),
+                                                            last - first, _pointer(community_offsets, _u64p),
+                                                            _pointer(community_nodes, _u32p), capacity,
+                                                            _pointer(stop_reasons[first:last], _u32p),
+                                                            _pointer(truncated[first:last], _u8p))
+                if status != _ERROR_BUFFER_TOO_SMALL:
+                    break
+                # computed again with the exact size, only for the chunks whose communities are that large
+                capacity = int(community_offsets[-1])
+            _check(status)
+            for i in range(last - first):
+                communities.append(self._labels(community_nodes[community_offsets[i]:community_offsets[i + 1]]))
+        if return_details:
+            return communities, stop_reasons, truncated
+        return communities
+
+
+class BinaryCommunities(object):
+    """-communities.bin file of walkscan --binary (see the README), mapped with numpy: communities[i] is the
+    community of seed set i (NumPy array of node IDs), read without parsing the other ones."""
+
+    _HEADER = np.dtype([('magic', 'S8'), ('version', '<u4'), ('flags', '<u4'), ('nb_communities', '<u8'),
+                        ('nb_nodes', '<u8')])
+
+    def __init__(self, file_name):
+        data = np.memmap(file_name, dtype=np.uint8, mode='r')
+        header = data[:self._HEADER.itemsize].view(self._HEADER)[0] if len(data) >= self._HEADER.itemsize else None
+        if header is None or header['magic'] != b'WSCOMMS' or header['version'] != 1:
+            raise ValueError('%s is not a binary community file' % file_name)
+        n, m = int(header['nb_communities']), int(header['nb_nodes'])
+        start = self._HEADER.itemsize
+        self.offsets = data[start:start + 8 * (n + 1)].view('<u8')
+        start += 8 * (n + 1)
+        self.nodes = data[start:start + 4 * m].view('<u4')
+        start += (4 * m + 7) // 8 * 8
+        self.scores = data[start:start + 8 * n].view('<f8') if header['flags'] & 1 else None
+
+    def __len__(self):
+        return len(self.offsets) - 1
+
+    def __getitem__(self, index):
+        return self.nodes[int(self.offsets[index]):int(self.offsets[index + 1])]